@@ -0,0 +1,499 @@
+/*
+ *  booleanQuery.cpp
+ *  Harrison Tun and Jonah Pflaster
+ *
+ *  COMP 15 Proj Gerp
+ *
+ *  Purpose: This implementation file provides the function definitions for
+ *          the BooleanQuery class. The query is parsed into a tree with the
+ *          usual precedence (NOT, then AND, then OR). An AND walks all of its
+ *          operands together, rarest first: the rarest one proposes a line
+ *          and every other operand seeks to it, and a line any of them is
+ *          missing moves the proposal forward to where that operand is.
+ *          Words are read straight from their posting cursors, whose seeks
+ *          skip whole blocks, and worked out lists are searched by
+ *          galloping, so a rare word ANDed with a common one costs about as
+ *          much as the rare word alone.
+ *
+ *          Postings only hold lines, so a phrase is its words ANDed, and
+ *          each line found is then split again to check that the words are
+ *          next to each other, in order.
+ *
+ */
+
+#include "booleanQuery.h"
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <stdexcept>
+
+/*
+ * name:        BooleanQuery (constructor)
+ * purpose:     Parse a query
+ * arguments:
+ *     expression: the query, for example: "hash table" AND (insert OR find)
+ *     sensitive: whether the case of every word must match exactly
+ * returns:     Nothing
+ * effects:     Throws a runtime_error saying what is wrong if the query
+ *              can't be parsed
+ */
+BooleanQuery::BooleanQuery(const string &expression, bool sensitive)
+    : caseSens(sensitive)
+{
+    tokenize(expression);
+    if (tokens.empty()) {
+        throw runtime_error("nothing to search for");
+    }
+    root = parseOr();
+    if (nextToken < tokens.size()) {
+        throw runtime_error("unexpected " + tokens[nextToken]);
+    }
+    check(root);
+}
+
+/*
+ * name:        evaluate (member function)
+ * purpose:     Find every line the query matches
+ * arguments:
+ *     index: the index to search
+ * returns:     vector of (file number, line number) pairs, sorted and
+ *              without duplicates
+ * effects:     None
+ */
+vector<pair<int, int>> BooleanQuery::evaluate(IndexSet &index)
+{
+    return run(root, index);
+}
+
+/*
+ * name:        tokenize (member function)
+ * purpose:     Split a query into words, phrases, operators and parentheses
+ * arguments:
+ *     expression: the query
+ * returns:     Nothing
+ * effects:     Fills tokens. A phrase keeps its opening quote, so it can't be
+ *              mistaken for an operator. Throws a runtime_error if a quote
+ *              is never closed
+ */
+void BooleanQuery::tokenize(const string &expression)
+{
+    size_t pos = 0;
+    while (pos < expression.size()) {
+        char c = expression[pos];
+        if (isspace((unsigned char)c)) {
+            pos++;
+        } else if (c == '"') {
+            size_t close = expression.find('"', pos + 1);
+            if (close == string::npos) {
+                throw runtime_error("missing closing \"");
+            }
+            tokens.push_back(expression.substr(pos, close - pos));
+            pos = close + 1;
+        } else if (c == '(' or c == ')') {
+            tokens.push_back(string(1, c));
+            pos++;
+        } else {
+            size_t start = pos;
+            while (pos < expression.size() and
+                   not isspace((unsigned char)expression[pos]) and
+                   expression[pos] != '(' and expression[pos] != ')' and
+                   expression[pos] != '"') {
+                pos++;
+            }
+            tokens.push_back(expression.substr(start, pos - start));
+        }
+    }
+}
+
+/*
+ * name:        isToken (member function)
+ * purpose:     Tell whether the next token is a given one
+ * arguments:
+ *     token: the token to look for
+ * returns:     true if there is a next token and it is token
+ * effects:     None
+ */
+bool BooleanQuery::isToken(const char *token)
+{
+    return nextToken < tokens.size() and tokens[nextToken] == token;
+}
+
+/*
+ * name:        parseOr (member function)
+ * purpose:     Parse operands joined by OR
+ * arguments:   None
+ * returns:     the node, an OR only if there was more than one operand
+ * effects:     Consumes tokens
+ */
+BooleanQuery::Node BooleanQuery::parseOr()
+{
+    Node node = parseAnd();
+    if (not isToken("OR")) {
+        return node;
+    }
+    Node either{Node::OR, {}, {node}};
+    while (isToken("OR")) {
+        nextToken++;
+        either.children.push_back(parseAnd());
+    }
+    return either;
+}
+
+/*
+ * name:        parseAnd (member function)
+ * purpose:     Parse operands joined by AND, or by nothing at all
+ * arguments:   None
+ * returns:     the node, an AND only if there was more than one operand
+ * effects:     Consumes tokens
+ */
+BooleanQuery::Node BooleanQuery::parseAnd()
+{
+    Node node = parseUnary();
+    Node both{Node::AND, {}, {node}};
+    while (nextToken < tokens.size() and not isToken(")") and
+           not isToken("OR")) {
+        if (isToken("AND")) {
+            nextToken++;
+        }
+        both.children.push_back(parseUnary());
+    }
+    return both.children.size() == 1 ? node : both;
+}
+
+/*
+ * name:        parseUnary (member function)
+ * purpose:     Parse an operand, which NOT may come before
+ * arguments:   None
+ * returns:     the node
+ * effects:     Consumes tokens
+ */
+BooleanQuery::Node BooleanQuery::parseUnary()
+{
+    if (isToken("NOT")) {
+        nextToken++;
+        return Node{Node::NOT, {}, {parsePrimary()}};
+    }
+    return parsePrimary();
+}
+
+/*
+ * name:        parsePrimary (member function)
+ * purpose:     Parse a word, a phrase or a query in parentheses
+ * arguments:   None
+ * returns:     the node
+ * effects:     Consumes tokens. Throws a runtime_error if the next token
+ *              can't start an operand
+ */
+BooleanQuery::Node BooleanQuery::parsePrimary()
+{
+    if (nextToken >= tokens.size()) {
+        throw runtime_error("query ends too early");
+    }
+    string &token = tokens[nextToken];
+    if (token == ")" or token == "AND" or token == "OR" or token == "NOT") {
+        throw runtime_error("unexpected " + token);
+    }
+    nextToken++;
+    if (token == "(") {
+        Node node = parseOr();
+        if (not isToken(")")) {
+            throw runtime_error("missing )");
+        }
+        nextToken++;
+        return node;
+    }
+    if (token[0] == '"') {
+        vector<string_view> words;
+        splitWords(string_view(token).substr(1), words);
+        Node phrase{Node::PHRASE, {}, {}};
+        for (string_view word : words) {
+            phrase.words.push_back(string(word));
+        }
+        if (phrase.words.size() == 1) {
+            phrase.kind = Node::TERM;
+        } else if (phrase.words.empty()) {
+            throw runtime_error("empty phrase");
+        }
+        return phrase;
+    }
+    if (isPattern(token)) {
+        return Node{Node::PATTERN, {string(stripPattern(token))}, {}};
+    }
+    return Node{Node::TERM, {string(stripNonAlphaNum(token))}, {}};
+}
+
+/*
+ * name:        check (member function)
+ * purpose:     Make sure every NOT excludes from something
+ * arguments:
+ *     node: the root of the query, or of a part of it
+ * returns:     Nothing
+ * effects:     Throws a runtime_error if a NOT is alone, in an OR, in an
+ *              AND of nothing but NOTs, or right after another NOT
+ */
+void BooleanQuery::check(Node &node)
+{
+    if (node.kind == Node::NOT) {
+        throw runtime_error("NOT needs words to exclude from");
+    }
+    for (Node &child : node.children) {
+        if (child.kind == Node::NOT) {
+            if (node.kind != Node::AND) {
+                throw runtime_error("NOT needs words to exclude from");
+            }
+            check(child.children[0]);
+        } else {
+            check(child);
+        }
+    }
+    if (node.kind == Node::AND and
+        all_of(node.children.begin(), node.children.end(),
+               [](Node &child) { return child.kind == Node::NOT; })) {
+        throw runtime_error("NOT needs words to exclude from");
+    }
+}
+
+/*
+ * name:        run (member function)
+ * purpose:     Find the lines a part of the query matches
+ * arguments:
+ *     node: the part, which is not a NOT
+ *     index: the index to search
+ * returns:     sorted (file number, line number) pairs without duplicates
+ * effects:     None
+ */
+vector<pair<int, int>> BooleanQuery::run(Node &node, IndexSet &index)
+{
+    vector<pair<int, int>> result;
+    if (node.kind == Node::TERM) {
+        for (IndexSet::Cursor cursor = index.getCursor(node.words[0],
+                                                       caseSens);
+             not cursor.done(); cursor.next()) {
+            result.push_back(cursor.current());
+        }
+    } else if (node.kind == Node::PATTERN) {
+        result = index.getMatches(node.words[0], caseSens);
+    } else if (node.kind == Node::OR) {
+        for (Node &child : node.children) {
+            vector<pair<int, int>> lines = run(child, index), both;
+            both.reserve(result.size() + lines.size());
+            set_union(result.begin(), result.end(), lines.begin(),
+                      lines.end(), back_inserter(both));
+            result.swap(both);
+        }
+    } else {
+        result = runAnd(node, index);
+    }
+    return result;
+}
+
+/*
+ * name:        runAnd (member function)
+ * purpose:     Find the lines an AND or a phrase matches
+ * arguments:
+ *     node: the AND or PHRASE
+ *     index: the index to search
+ * returns:     sorted (file number, line number) pairs without duplicates
+ * effects:     None
+ */
+vector<pair<int, int>> BooleanQuery::runAnd(Node &node, IndexSet &index)
+{
+    vector<Stream> wanted, unwanted;
+    vector<const vector<string> *> phrases;
+    auto want = [&](Node &operand) {
+        if (operand.kind == Node::PHRASE) {
+            for (const string &word : operand.words) {
+                wanted.push_back(Stream(index.getCursor(word, caseSens)));
+            }
+            phrases.push_back(&operand.words);
+        } else {
+            wanted.push_back(open(operand, index));
+        }
+    };
+    if (node.kind == Node::PHRASE) {
+        want(node);
+    }
+    for (Node &child : node.children) {
+        if (child.kind == Node::NOT) {
+            unwanted.push_back(open(child.children[0], index));
+        } else {
+            want(child);
+        }
+    }
+    sort(wanted.begin(), wanted.end(),
+         [](Stream &a, Stream &b) { return a.size() < b.size(); });
+
+    vector<pair<int, int>> result;
+    Stream &rarest = wanted[0];
+    while (not rarest.done()) {
+        pair<int, int> line = rarest.current();
+        bool everywhere = true;
+        for (size_t i = 1; i < wanted.size() and everywhere; i++) {
+            wanted[i].seek(line);
+            if (wanted[i].done()) {
+                return result;
+            }
+            if (wanted[i].current() != line) {
+                rarest.seek(wanted[i].current()); //nothing can match before
+                everywhere = false;
+            }
+        }
+        if (not everywhere) {
+            continue;
+        }
+        bool excluded = false;
+        for (Stream &stream : unwanted) {
+            stream.seek(line);
+            excluded = excluded or
+                       (not stream.done() and stream.current() == line);
+        }
+        for (size_t p = 0; p < phrases.size() and not excluded; p++) {
+            excluded = not hasPhrase(index, line, *phrases[p]);
+        }
+        if (not excluded) {
+            result.push_back(line);
+        }
+        rarest.next();
+    }
+    return result;
+}
+
+/*
+ * name:        open (member function)
+ * purpose:     Get a part of the query as a sorted stream of lines
+ * arguments:
+ *     node: the part
+ *     index: the index to search
+ * returns:     the word's cursor for a single word, so nothing is decoded
+ *              ahead of time; the worked out lines otherwise
+ * effects:     None
+ */
+BooleanQuery::Stream BooleanQuery::open(Node &node, IndexSet &index)
+{
+    if (node.kind == Node::TERM) {
+        return Stream(index.getCursor(node.words[0], caseSens));
+    }
+    return Stream(run(node, index));
+}
+
+/*
+ * name:        hasPhrase (member function)
+ * purpose:     Tell whether a line holds some words one after another
+ * arguments:
+ *     index: the index the line is in
+ *     line: the (file number, line number) of the line
+ *     words: the words of the phrase
+ * returns:     true if the words appear next to each other, in order
+ * effects:     None
+ */
+bool BooleanQuery::hasPhrase(IndexSet &index, pair<int, int> line,
+                             const vector<string> &words)
+{
+    splitWords(index.getLine(line.first, line.second), lineWords);
+    for (size_t start = 0; start + words.size() <= lineWords.size();
+         start++) {
+        size_t matched = 0;
+        while (matched < words.size()) {
+            string_view word = lineWords[start + matched];
+            if (caseSens ? word != words[matched]
+                         : not foldedEquals(word, words[matched])) {
+                break;
+            }
+            matched++;
+        }
+        if (matched == words.size()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Constructors for the Stream class, over a word's cursor or a list
+ */
+BooleanQuery::Stream::Stream(IndexSet::Cursor words)
+    : isList(false), cursor(std::move(words)) {}
+
+BooleanQuery::Stream::Stream(vector<pair<int, int>> lines)
+    : isList(true), list(std::move(lines)) {}
+
+/*
+ * name:        done (Stream member function)
+ * purpose:     Tell whether the stream has passed its last line
+ * arguments:   None
+ * returns:     true if there is no current line
+ * effects:     None
+ */
+bool BooleanQuery::Stream::done()
+{
+    return isList ? pos >= list.size() : cursor.done();
+}
+
+/*
+ * name:        current (Stream member function)
+ * purpose:     Get the line the stream is on
+ * arguments:   None
+ * returns:     its (file number, line number); only valid if not done
+ * effects:     None
+ */
+pair<int, int> BooleanQuery::Stream::current()
+{
+    return isList ? list[pos] : cursor.current();
+}
+
+/*
+ * name:        next (Stream member function)
+ * purpose:     Move to the next line
+ * arguments:   None
+ * returns:     Nothing
+ * effects:     None
+ */
+void BooleanQuery::Stream::next()
+{
+    if (isList) {
+        pos++;
+    } else {
+        cursor.next();
+    }
+}
+
+/*
+ * name:        seek (Stream member function)
+ * purpose:     Move to the first line at or after a given one
+ * arguments:
+ *     target: the (file number, line number) to reach
+ * returns:     Nothing
+ * effects:     Never moves backwards. A list is searched by galloping:
+ *              steps that double until one passes the target, then a binary
+ *              search of the last step, so a short skip stays cheap
+ */
+void BooleanQuery::Stream::seek(pair<int, int> target)
+{
+    if (not isList) {
+        cursor.seek(target);
+        return;
+    }
+    if (pos >= list.size() or list[pos] >= target) {
+        return;
+    }
+    size_t low = pos, step = 1; //list[low] is before the target
+    while (low + step < list.size() and list[low + step] < target) {
+        low += step;
+        step *= 2;
+    }
+    size_t high = min(low + step, list.size());
+    pos = lower_bound(list.begin() + low + 1, list.begin() + high, target) -
+          list.begin();
+}
+
+/*
+ * name:        size (Stream member function)
+ * purpose:     Estimate how many lines the stream holds, to plan an AND
+ * arguments:   None
+ * returns:     the list's length, or the cursor's estimate
+ * effects:     None
+ */
+uint64_t BooleanQuery::Stream::size()
+{
+    return isList ? list.size() : cursor.size();
+}
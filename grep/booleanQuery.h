@@ -0,0 +1,78 @@
+/*
+ *  booleanQuery.h
+ *  Harrison Tun and Jonah Pflaster
+ *  {htun01}         {jpflas01}
+ *
+ *  COMP 15 Proj Gerp
+ *
+ *  Purpose: This header file defines the interface for the BooleanQuery
+ *          class, which parses a query of several words joined by AND, OR
+ *          and NOT, with parentheses and quoted phrases, and finds the lines
+ *          that match it in an IndexSet. Words next to each other with no
+ *          operator are ANDed. NOT excludes lines from the words it follows,
+ *          so it can't stand on its own or inside an OR. A word with '*' or
+ *          '?' in it is a wildcard pattern and matches every word it fits.
+ *
+ */
+
+#ifndef __BOOLEANQUERY_H
+#define __BOOLEANQUERY_H
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "indexSet.h"
+using namespace std;
+
+class BooleanQuery
+{
+    public:
+        BooleanQuery(const string &expression, bool sensitive);
+        vector<pair<int, int>> evaluate(IndexSet &index);
+    private:
+        struct Node {
+            enum Kind { TERM, PATTERN, PHRASE, AND, OR, NOT };
+            Kind kind;
+            vector<string> words;  //the word of a TERM or PATTERN, the words
+                                   //of a PHRASE
+            vector<Node> children; //the operands of AND, OR and NOT
+        };
+        //a sorted run of (file, line): a word's cursor or a list worked out
+        //from a part of the query
+        class Stream {
+            public:
+                Stream(IndexSet::Cursor words);
+                Stream(vector<pair<int, int>> lines);
+                bool done();
+                pair<int, int> current();
+                void next();
+                void seek(pair<int, int> target);
+                uint64_t size();
+            private:
+                bool isList;
+                IndexSet::Cursor cursor;
+                vector<pair<int, int>> list;
+                size_t pos = 0;
+        };
+
+        bool caseSens;
+        vector<string> tokens;     //a phrase token starts with its '"'
+        size_t nextToken = 0;
+        Node root;
+        vector<string_view> lineWords;
+
+        void tokenize(const string &expression);
+        bool isToken(const char *token);
+        Node parseOr();
+        Node parseAnd();
+        Node parseUnary();
+        Node parsePrimary();
+        void check(Node &node);
+        vector<pair<int, int>> run(Node &node, IndexSet &index);
+        vector<pair<int, int>> runAnd(Node &node, IndexSet &index);
+        Stream open(Node &node, IndexSet &index);
+        bool hasPhrase(IndexSet &index, pair<int, int> line,
+                       const vector<string> &words);
+};
+
+#endif
@@ -0,0 +1,1423 @@
+/*
+ *  gerpProcessor.cpp
+ *  Harrison Tun and Jonah Pflaster
+ *  {htun01}         {jpflas01}
+ *  11/30/24
+ *
+ *  COMP 15 Proj Gerp
+ *
+ *  Purpose: This implementation file provides the function definitions for
+ *          the IndexBuilder class. It walks the FSTree of the input
+ *          directory, reads every file line by line into the file table,
+ *          strips each word of leading and trailing non alphanumeric
+ *          characters and inserts it into the hash table. The finished
+ *          table is frozen into an IndexFile, which answers the queries
+ *          read by the query loop.
+ *
+ *          Reading and tokenizing run on a pool of threads, each claiming
+ *          the next unread file. Every file becomes a small partial index
+ *          (its words and the lines they are on), and the main thread
+ *          merges the partial indexes in traversal order, so file indices
+ *          and posting order are the same as a single threaded build.
+ *
+ *          Updating a saved index lists the directory again and compares
+ *          each file's time and size with what the index recorded. Only new
+ *          files and files that changed are read; if just the time changed
+ *          and the contents hash the same, the file is not tokenized again.
+ *          Changed and deleted files are marked dead in the IndexSet and
+ *          changed and new ones go into a new segment. When segments or
+ *          dead files pile up, compact rebuilds one segment from the text
+ *          the index already holds, without reading the files again.
+ *
+ *          With a memory budget, the merge keeps a rough count of what the
+ *          hash table holds, and each time it passes the budget the table
+ *          is frozen and written to a temporary file as a run (the single
+ *          pass in memory indexing of SPIMI). At the end the runs are
+ *          merged k ways into one segment on disk, which is mapped, so the
+ *          index of a tree bigger than memory is paged in as it is read.
+ *
+ */
+
+#include "gerpProcessor.h"
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <mutex>
+#include <poll.h>
+#include <sstream>
+#include <stdexcept>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+
+/*
+ * name:        nanosSince
+ * purpose:     Time a phase of a build
+ * arguments:
+ *     start: when the phase began
+ * returns:     nanoseconds since start
+ * effects:     None
+ */
+static uint64_t nanosSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration_cast<chrono::nanoseconds>(
+               chrono::steady_clock::now() - start).count();
+}
+
+/*
+ * Destructor for IndexBuilder class, stops watching if it was
+ */
+IndexBuilder::~IndexBuilder()
+{
+    if (watchFd >= 0) {
+        close(watchFd);
+    }
+}
+
+/*
+ * name:        run (member function)
+ * purpose:     Build the index of a directory and answer queries on it
+ * arguments:
+ *     inputDirectory: the directory to index
+ *     outputFile: the file query results are written to
+ * returns:     Nothing
+ * effects:     Exits the program if the directory can't be indexed
+ */
+void IndexBuilder::run(string inputDirectory, string &outputFile)
+{
+    build(inputDirectory);
+    query(outputFile);
+}
+
+/*
+ * name:        build (member function)
+ * purpose:     Index every file under a directory and freeze the result
+ * arguments:
+ *     inputDirectory: the directory to index
+ * returns:     Nothing
+ * effects:     Exits the program if the directory can't be indexed. The
+ *              hash table is emptied once the image is built, and the new
+ *              index replaces the old one for queries started after
+ */
+void IndexBuilder::build(string inputDirectory)
+{
+    auto start = chrono::steady_clock::now();
+    try {
+        buildIndex(inputDirectory);
+        freezeTable(pending->index); //the image has everything
+    } catch (const exception &e) {
+        cerr << "Could not build index: " << e.what() << ", exiting."
+             << endl;
+        exit(EXIT_FAILURE);
+    }
+    times.total = nanosSince(start);
+    publish();
+}
+
+/*
+ * name:        update (member function)
+ * purpose:     Bring the index up to date with a directory, reading only
+ *              the files that were added or changed
+ * arguments:
+ *     inputDirectory: the directory the index was built from
+ * returns:     Nothing
+ * effects:     Exits the program if the directory can't be indexed
+ */
+void IndexBuilder::update(string inputDirectory)
+{
+    try {
+        updateIndex(inputDirectory);
+    } catch (const exception &e) {
+        cerr << "Could not update index: " << e.what() << ", exiting."
+             << endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+/*
+ * name:        watch (member function)
+ * purpose:     Keep the index up to date with a directory while answering
+ *              queries
+ * arguments:
+ *     inputDirectory: the directory the index was built from
+ * returns:     Nothing
+ * effects:     Before each query, the index is updated if inotify reported
+ *              any change under the directory since the last one. Exits the
+ *              program if inotify is not available or the directory can't
+ *              be indexed
+ */
+void IndexBuilder::watch(string inputDirectory)
+{
+    watchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watchFd < 0) {
+        cerr << "Could not watch " << inputDirectory << ", exiting." << endl;
+        exit(EXIT_FAILURE);
+    }
+    watchDirectory = inputDirectory;
+    addWatches();
+    update(inputDirectory); //catch what changed before the watches began
+}
+
+/*
+ * name:        saveIndex (member function)
+ * purpose:     Write the built index to a file for loadIndex
+ * arguments:
+ *     indexFile: the file to write
+ * returns:     Nothing
+ * effects:     Exits the program if the file can't be written
+ */
+void IndexBuilder::saveIndex(const string &indexFile)
+{
+    try {
+        snapshot()->index.save(indexFile);
+    } catch (const runtime_error &e) {
+        cerr << e.what() << endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+/*
+ * name:        loadIndex (member function)
+ * purpose:     Use an index saved by saveIndex instead of building one
+ * arguments:
+ *     indexFile: the file to map
+ * returns:     Nothing
+ * effects:     Exits the program if the file is not a gerp index
+ */
+void IndexBuilder::loadIndex(const string &indexFile)
+{
+    pending = make_shared<Snapshot>();
+    try {
+        pending->index.load(indexFile);
+    } catch (const runtime_error &e) {
+        cerr << e.what() << endl;
+        exit(EXIT_FAILURE);
+    }
+    times = BuildTimes(); //nothing was built
+    publish();
+}
+
+/*
+ * name:        query (member function)
+ * purpose:     Answer queries on the built or loaded index
+ * arguments:
+ *     outputFile: the file query results are written to
+ * returns:     Nothing
+ * effects:     Reads queries from cin, or the query file if one was set,
+ *              until @q, @quit or end of input. Prints the stats first if
+ *              they were asked for
+ */
+void IndexBuilder::query(string &outputFile)
+{
+    if (showStats) {
+        cout << statsReport();
+    }
+    if (queries.empty()) {
+        queryLoop(outputFile);
+    } else {
+        queryBatch(outputFile);
+    }
+}
+
+/*
+ * name:        setAsyncOutput (member function)
+ * purpose:     Write results on a thread of their own
+ * arguments:
+ *     async: true to let the next query run while results are written
+ * returns:     Nothing
+ * effects:     Starts the writer's thread
+ */
+void IndexBuilder::setAsyncOutput(bool async)
+{
+    writer.setAsync(async);
+}
+
+/*
+ * name:        setStats (member function)
+ * purpose:     Print the index's stats before answering queries
+ * arguments:
+ *     show: true to print them, as @stats would
+ * returns:     Nothing
+ * effects:     None
+ */
+void IndexBuilder::setStats(bool show)
+{
+    showStats = show;
+}
+
+/*
+ * name:        setMemoryBudget (member function)
+ * purpose:     Bound the memory a build's hash table takes
+ * arguments:
+ *     bytes: about how much the table may hold before it is written to
+ *            disk as a run, 0 for no bound
+ * returns:     Nothing
+ * effects:     Builds and updates after this spill runs to the temporary
+ *              directory and merge them at the end
+ */
+void IndexBuilder::setMemoryBudget(size_t bytes)
+{
+    memoryBudget = bytes;
+}
+
+/*
+ * name:        setQueryFile (member function)
+ * purpose:     Answer the queries in a file instead of asking the user
+ * arguments:
+ *     queryFile: the file, written as a user would type the queries
+ * returns:     Nothing
+ * effects:     query will run the file as a batch
+ */
+void IndexBuilder::setQueryFile(const string &queryFile)
+{
+    queries = queryFile;
+}
+
+/*
+ * name:        serve (member function)
+ * purpose:     Answer queries from clients on a Unix socket until stopped
+ * arguments:
+ *     socketPath: where the socket is made
+ * returns:     Nothing
+ * effects:     Each client is answered on a thread of its own, reading the
+ *              snapshot current when its query began. When watching, a
+ *              thread updates the index as the directory changes and
+ *              publishes each new snapshot. Runs until SIGINT or SIGTERM.
+ *              Exits the program if the socket can't be made
+ */
+void IndexBuilder::serve(const string &socketPath)
+{
+    if (showStats) {
+        cout << statsReport();
+    }
+    QueryServer server;
+    try {
+        server.listen(socketPath);
+    } catch (const runtime_error &e) {
+        cerr << "Could not listen on " << socketPath << ": " << e.what()
+             << ", exiting." << endl;
+        exit(EXIT_FAILURE);
+    }
+    thread updater;
+    if (watchFd >= 0) {
+        updater = thread(&IndexBuilder::watchChanges, this, ref(server));
+    }
+    server.run([this](const string &request, string &reply) {
+        search(request, reply);
+    });
+    if (updater.joinable()) {
+        updater.join();
+    }
+}
+
+/*
+ * name:        search (member function)
+ * purpose:     Answer a line of commands, as typed at the query prompt
+ * arguments:
+ *     command: the commands, such as "@i fox" or "@b quick AND fox"
+ *     output: an empty string, set to the results as they would be written
+ * returns:     Nothing
+ * effects:     @stats adds the stats report to output; @f and commands
+ *              after @q are ignored. Searches go through the result cache
+ *              like any other query
+ */
+void IndexBuilder::search(const string &command, string &output)
+{
+    istringstream input(command);
+    QueryItem item;
+    string result;
+    while (readQuery(input, item) and item.kind != QueryItem::QUIT) {
+        if (item.kind == QueryItem::STATS) {
+            output += statsReport();
+        } else if (item.kind != QueryItem::OUTPUT) {
+            runQuery(item, result);
+            output += result;
+            result.clear();
+        }
+    }
+}
+
+/*
+ * name:        buildIndex (member function)
+ * purpose:     Build the file tree of a directory and index its files
+ * arguments:
+ *     directoryPath: the directory to index
+ * returns:     Nothing
+ * effects:     Starts the build's timings over. Throws if the directory
+ *              can't be read
+ */
+void IndexBuilder::buildIndex(string directoryPath)
+{
+    times = BuildTimes();
+    pending = make_shared<Snapshot>();
+    runs.clear(); //left by a build that failed
+    table = HashTable();
+    tableBytes = 0;
+    auto start = chrono::steady_clock::now();
+    vector<string> paths;
+    listFiles(directoryPath, paths);
+    times.traverse = nanosSince(start);
+    vector<FileResult> results(paths.size());
+    ingestFiles(paths, results);
+}
+
+/*
+ * name:        updateIndex (member function)
+ * purpose:     Index the files of a directory that the index doesn't have
+ *              as they are now, and drop the ones that are gone
+ * arguments:
+ *     directoryPath: the directory to index
+ * returns:     Nothing
+ * effects:     Works on a copy of the current snapshot, which queries keep
+ *              reading, and publishes it once done. Adds at most one segment,
+ *              then compacts if the set has too many segments or dead files.
+ *              Starts the timings over. Throws if the directory can't be read
+ */
+void IndexBuilder::updateIndex(string directoryPath)
+{
+    times = BuildTimes();
+    pending = make_shared<Snapshot>(*snapshot());
+    IndexSet &index = pending->index;
+    runs.clear(); //left by an update that failed
+    table = HashTable();
+    tableBytes = 0;
+    auto start = chrono::steady_clock::now();
+    vector<string> paths;
+    listFiles(directoryPath, paths);
+    times.traverse = nanosSince(start);
+    unordered_map<string_view, int> indexed; //path -> live file number
+    for (int file = 0; file < index.getFileSize(); file++) {
+        if (index.isLive(file)) {
+            indexed[index.getFile(file)] = file;
+        }
+    }
+    vector<string> changed;
+    vector<FileResult> results;
+    for (string &path : paths) {
+        FileResult result;
+        auto found = indexed.find(path);
+        if (found != indexed.end()) {
+            result.oldFile = found->second;
+            result.storedStamp = index.getStamp(found->second);
+            indexed.erase(found);
+            struct stat info;
+            if (stat(path.c_str(), &info) == 0) {
+                int64_t mtime = info.st_mtim.tv_sec * 1000000000LL +
+                                info.st_mtim.tv_nsec;
+                if (mtime == result.storedStamp.mtime and
+                    (uint64_t)info.st_size == result.storedStamp.size) {
+                    continue; //unchanged
+                }
+                result.checkHash =
+                    (uint64_t)info.st_size == result.storedStamp.size;
+            }
+        }
+        changed.push_back(path);
+        results.push_back(result);
+    }
+    for (auto &gone : indexed) {
+        index.removeFile(gone.second);
+    }
+    ingestFiles(changed, results);
+    if (table.getFileSize() > 0 or runs.getSegmentCount() > 0) {
+        freezeTable(index);
+    }
+    if (index.getSegmentCount() > MAX_SEGMENTS or
+        4 * index.getDeadCount() > index.getFileSize()) {
+        compact(paths);
+    }
+    times.total = nanosSince(start);
+    publish();
+}
+
+/*
+ * name:        compact (member function)
+ * purpose:     Replace every segment with one holding only the live files,
+ *              numbered in traversal order as a full build would
+ * arguments:
+ *     paths: the files of the directory, in traversal order
+ * returns:     Nothing
+ * effects:     Tokenizes the text the index already holds; no file is read
+ */
+void IndexBuilder::compact(vector<string> &paths)
+{
+    IndexSet &index = pending->index;
+    unordered_map<string_view, int> indexed;
+    for (int file = 0; file < index.getFileSize(); file++) {
+        if (index.isLive(file)) {
+            indexed[index.getFile(file)] = file;
+        }
+    }
+    vector<string> kept;
+    vector<FileResult> results;
+    for (string &path : paths) {
+        auto found = indexed.find(path);
+        if (found == indexed.end()) {
+            continue; //could not be read
+        }
+        FileResult result;
+        result.stored = index.getText(found->second);
+        result.storedStamp = index.getStamp(found->second);
+        kept.push_back(path);
+        results.push_back(result);
+    }
+    ingestFiles(kept, results);
+    index.clear(); //the stored text has been copied out by now
+    freezeTable(index);
+}
+
+/*
+ * name:        freezeTable (member function)
+ * purpose:     Add the files indexed since the last freeze to an index as
+ *              one segment
+ * arguments:
+ *     index: the index
+ * returns:     Nothing
+ * effects:     Empties the hash table. If runs were spilled, the table is
+ *              spilled too and the runs are merged into one segment on
+ *              disk, which the index maps. Throws a runtime_error if a run
+ *              or the merged segment can't be written
+ */
+void IndexBuilder::freezeTable(IndexSet &index)
+{
+    if (runs.getSegmentCount() == 0) {
+        auto start = chrono::steady_clock::now();
+        index.addSegment(table);
+        table = HashTable();
+        tableBytes = 0;
+        times.freeze += nanosSince(start);
+        return;
+    }
+    if (table.getFileSize() > 0) {
+        spillTable();
+    }
+    auto start = chrono::steady_clock::now();
+    string merged = spillPath("merged");
+    runs.saveMerged(merged);
+    runs.clear();
+    try {
+        index.append(merged);
+    } catch (const runtime_error &e) {
+        remove(merged.c_str());
+        throw;
+    }
+    remove(merged.c_str()); //the index maps it, so it lives on till then
+    times.merge += nanosSince(start);
+}
+
+/*
+ * name:        spillTable (member function)
+ * purpose:     Write the hash table to disk as a run, to be merged later
+ * arguments:   None
+ * returns:     Nothing
+ * effects:     Empties the table. The run is mapped back, so it costs
+ *              memory only as its pages are read. Throws a runtime_error
+ *              if it can't be written
+ */
+void IndexBuilder::spillTable()
+{
+    auto start = chrono::steady_clock::now();
+    runs.addSegment(table, spillPath("run" +
+                                     to_string(runs.getSegmentCount())));
+    table = HashTable();
+    tableBytes = 0;
+    times.spill += nanosSince(start);
+    times.spills++;
+}
+
+/*
+ * name:        spillPath (member function)
+ * purpose:     Name a temporary file for a build under a memory budget
+ * arguments:
+ *     name: what the file holds
+ * returns:     a path in $TMPDIR, or /tmp if it is not set, that no other
+ *              gerp running at the same time uses
+ * effects:     None
+ */
+string IndexBuilder::spillPath(const string &name)
+{
+    const char *directory = getenv("TMPDIR");
+    if (directory == nullptr or *directory == '\0') {
+        directory = "/tmp";
+    }
+    return string(directory) + "/gerp-" + to_string(getpid()) + "-" + name;
+}
+
+/*
+ * name:        snapshot (member function)
+ * purpose:     Get the index as queries should see it now
+ * arguments:   None
+ * returns:     the current snapshot, kept alive for as long as it is held
+ * effects:     None; safe to call while another thread publishes
+ */
+shared_ptr<IndexBuilder::Snapshot> IndexBuilder::snapshot()
+{
+    return atomic_load(&current);
+}
+
+/*
+ * name:        publish (member function)
+ * purpose:     Make the pending snapshot the one queries see
+ * arguments:   None
+ * returns:     Nothing
+ * effects:     Queries already running finish on the snapshot they began
+ *              with, which is freed once the last of them lets it go. The
+ *              result cache is emptied, as its results are now stale
+ */
+void IndexBuilder::publish()
+{
+    pending->version = snapshot()->version + 1;
+    pending->times = times;
+    atomic_store(&current, pending);
+    pending.reset();
+    cache.clear();
+}
+
+/*
+ * name:        listFiles (member function)
+ * purpose:     List every file under a directory
+ * arguments:
+ *     directoryPath: the directory
+ *     paths: the list to fill, in traversal order
+ * returns:     Nothing
+ * effects:     Also lists every directory, in directories. Throws if the
+ *              directory can't be read
+ */
+void IndexBuilder::listFiles(string directoryPath, vector<string> &paths)
+{
+    FSTree tree(directoryPath);
+    directories.clear();
+    traverseHelper(tree.getRoot(), directoryPath, paths);
+}
+
+/*
+ * name:        traverseHelper (member function)
+ * purpose:     Recursively list every file under a directory node
+ * arguments:
+ *     root: the directory node
+ *     currPath: the path of the directory, as files are reported
+ *     paths: the list to add file paths to
+ * returns:     Nothing
+ * effects:     Files are listed in the order the tree lists them, which is
+ *              the order they are indexed in. The directory is added to
+ *              directories
+ */
+void IndexBuilder::traverseHelper(DirNode *root, string currPath,
+                                  vector<string> &paths)
+{
+    if (root == nullptr) {
+        return;
+    }
+    directories.push_back(currPath);
+    for (int i = 0; i < root->numFiles(); i++) {
+        paths.push_back(currPath + "/" + root->getFile(i));
+    }
+    for (int i = 0; i < root->numSubDirs(); i++) {
+        DirNode *subDir = root->getSubDir(i);
+        traverseHelper(subDir, currPath + "/" + subDir->getName(), paths);
+    }
+}
+
+/*
+ * name:        ingestFiles (member function)
+ * purpose:     Read and tokenize files on every core and merge them into
+ *              the hash table in order
+ * arguments:
+ *     paths: the files to index, in the order they get file indices
+ *     results: one per path, with what is known of the file before it is
+ *              read
+ * returns:     Nothing
+ * effects:     Workers run at most a few files ahead of the merge, so only
+ *              a handful of partial indexes are held at once. Each result
+ *              is emptied once merged. If a merge throws, the workers are
+ *              stopped and joined before the exception goes on
+ */
+void IndexBuilder::ingestFiles(vector<string> &paths,
+                               vector<FileResult> &results)
+{
+    size_t workers = max(1u, thread::hardware_concurrency());
+    size_t window = 4 * workers; //files allowed to wait for the merge
+    mutex lock;
+    condition_variable readyCv, roomCv;
+    size_t next = 0, merged = 0;
+    auto worker = [&]() {
+        while (true) {
+            size_t i;
+            {
+                unique_lock<mutex> guard(lock);
+                roomCv.wait(guard, [&]() {
+                    return next >= paths.size() or next < merged + window;
+                });
+                if (next >= paths.size()) {
+                    return;
+                }
+                i = next++;
+            }
+            //the main thread leaves results[i] alone until it is ready
+            processFile(paths[i], results[i]);
+            {
+                lock_guard<mutex> guard(lock);
+                results[i].ready = true;
+            }
+            readyCv.notify_all();
+        }
+    };
+    vector<thread> pool;
+    for (size_t w = 0; w < workers; w++) {
+        pool.emplace_back(worker);
+    }
+    try {
+        for (size_t i = 0; i < paths.size(); i++) {
+            {
+                unique_lock<mutex> guard(lock);
+                readyCv.wait(guard, [&]() { return results[i].ready; });
+                merged = i + 1;
+            }
+            roomCv.notify_all();
+            times.read += results[i].readNanos;
+            times.tokenize += results[i].tokenizeNanos;
+            mergeFile(paths[i], results[i]);
+            results[i] = FileResult();
+        }
+    } catch (const exception &e) {
+        {
+            lock_guard<mutex> guard(lock);
+            next = paths.size(); //the workers take no more files
+        }
+        roomCv.notify_all();
+        for (thread &t : pool) {
+            t.join();
+        }
+        throw;
+    }
+    for (thread &t : pool) {
+        t.join();
+    }
+}
+
+/*
+ * name:        processFile (member function)
+ * purpose:     Read a file and build its partial index: its text and line
+ *              offsets, each distinct stripped word with the lines it is
+ *              on, and its trigrams
+ * arguments:
+ *     filePath: the path of the file
+ *     result: where to put the text and words
+ * returns:     Nothing
+ * effects:     Touches nothing shared, so it runs on any thread. Files that
+ *              can't be opened are left with opened false. The file is read
+ *              in one piece and split in place, so a line costs no allocation.
+ *              Text stored in the index is used instead of the file if given
+ */
+void IndexBuilder::processFile(const string &filePath, FileResult &result)
+{
+    auto start = chrono::steady_clock::now();
+    string &text = result.text;
+    if (result.stored.data() != nullptr) {
+        result.opened = true;
+        text = string(result.stored);
+        result.stamp = result.storedStamp;
+    } else {
+        //stat first: if the file changes while it is read, the time kept is
+        //the older one and the next update reads it again
+        struct stat info;
+        if (stat(filePath.c_str(), &info) != 0) {
+            return;
+        }
+        ifstream input(filePath, ios::binary);
+        if (not input) {
+            return;
+        }
+        result.opened = true;
+        result.stamp.mtime = info.st_mtim.tv_sec * 1000000000LL +
+                             info.st_mtim.tv_nsec;
+        result.stamp.size = info.st_size;
+        if (info.st_size > 0 and info.st_size < UINT32_MAX) {
+            text.reserve(info.st_size + 1);
+        }
+        char buffer[1 << 16];
+        while (input.read(buffer, sizeof(buffer)) or input.gcount() > 0) {
+            text.append(buffer, input.gcount());
+        }
+        result.stamp.hash = contentHash(text);
+        if (result.checkHash and result.stamp.hash == result.storedStamp.hash) {
+            result.same = true; //only touched, the index has it already
+            text.clear();
+            result.readNanos = nanosSince(start);
+            return;
+        }
+        if (not text.empty() and text.back() != '\n') {
+            text += '\n'; //as getline, a last line without newline counts
+        }
+    }
+    result.readNanos = nanosSince(start);
+    start = chrono::steady_clock::now();
+    if (text.size() > UINT32_MAX) {
+        result.tooLarge = true;
+        return;
+    }
+    for (size_t offset = 0; offset < text.size();
+         offset = text.find('\n', offset) + 1) {
+        result.lineOffsets.push_back(offset);
+    }
+    result.lineOffsets.push_back(text.size());
+    splitTrigrams(text, result.trigrams);
+
+    //the words of the whole text at once, in order, so their lines are
+    //found by walking the line offsets alongside
+    static thread_local vector<WordSpan> spans;
+    splitWordSpans(text, spans);
+    unordered_map<string_view, size_t> seen; //word -> index in result.words
+    int lineNum = 0;
+    for (WordSpan span : spans) {
+        while (span.offset >= result.lineOffsets[lineNum + 1]) {
+            lineNum++;
+        }
+        string_view stripped(text.data() + span.offset, span.length);
+        auto found = seen.find(stripped);
+        if (found == seen.end()) {
+            seen.emplace(stripped, result.words.size());
+            result.words.push_back({string(stripped), {lineNum}});
+        } else if (result.words[found->second].second.back() != lineNum) {
+            result.words[found->second].second.push_back(lineNum);
+        }
+    }
+    result.tokenizeNanos = nanosSince(start);
+}
+
+/*
+ * name:        mergeFile (member function)
+ * purpose:     Add one file's partial index to the file table and hash
+ *              table
+ * arguments:
+ *     filePath: the path of the file
+ *     result: the file's partial index, from processFile
+ * returns:     Nothing
+ * effects:     Files that couldn't be opened get no file index. A changed
+ *              file's old copy is marked dead in the index. The text is
+ *              moved out of result. Under a memory budget, spills the table
+ *              once it is full. Throws a runtime_error if the file is too
+ *              large to index or a run can't be written
+ */
+void IndexBuilder::mergeFile(string &filePath, FileResult &result)
+{
+    if (result.same) {
+        return; //keeps its number and postings
+    }
+    if (result.oldFile >= 0) {
+        pending->index.removeFile(result.oldFile);
+    }
+    if (not result.opened) {
+        return;
+    }
+    if (result.tooLarge) {
+        throw runtime_error(filePath + " is too large to index");
+    }
+    auto start = chrono::steady_clock::now();
+    uint64_t resizeBefore = table.getResizeNanos();
+    int resizesBefore = table.getResizeCount();
+    tableBytes += filePath.size() + result.text.size() +
+                  result.lineOffsets.size() * sizeof(uint32_t) +
+                  result.trigrams.size() * sizeof(int);
+    for (auto &word : result.words) {
+        tableBytes += WORD_OVERHEAD + word.first.size() +
+                      word.second.size() * sizeof(pair<int, int>);
+    }
+    int fileIndex = table.insertFile(filePath, result.text,
+                                     result.lineOffsets, result.stamp);
+    fileIndexCounter = fileIndex + 1;
+    for (auto &word : result.words) {
+        table.insertWordLines(word.first, fileIndex, word.second);
+    }
+    table.insertTrigrams(fileIndex, result.trigrams);
+    uint64_t resized = table.getResizeNanos() - resizeBefore;
+    times.resize += resized;
+    times.resizes += table.getResizeCount() - resizesBefore;
+    times.insert += nanosSince(start) - resized;
+    if (memoryBudget > 0 and tableBytes >= memoryBudget) {
+        spillTable();
+    }
+}
+
+/*
+ * name:        addWatches (member function)
+ * purpose:     Watch every listed directory for changes to its files
+ * arguments:   None
+ * returns:     Nothing
+ * effects:     Directories already watched keep their watch
+ */
+void IndexBuilder::addWatches()
+{
+    uint32_t events = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE |
+                      IN_MOVED_FROM | IN_MOVED_TO;
+    for (string &directory : directories) {
+        inotify_add_watch(watchFd, directory.c_str(), events);
+    }
+}
+
+/*
+ * name:        changesPending (member function)
+ * purpose:     Tell whether anything changed under the watched directory
+ * arguments:   None
+ * returns:     true if inotify reported any event since the last call
+ * effects:     Reads and drops every pending event
+ */
+bool IndexBuilder::changesPending()
+{
+    bool changed = false;
+    alignas(inotify_event) char buffer[4096];
+    while (read(watchFd, buffer, sizeof(buffer)) > 0) {
+        changed = true; //which file does not matter, the update rechecks all
+    }
+    return changed;
+}
+
+/*
+ * name:        watchChanges (member function)
+ * purpose:     The updater thread of a server: update the index whenever the
+ *              watched directory changes
+ * arguments:
+ *     server: the server, polled to know when to stop
+ * returns:     Nothing
+ * effects:     Waits on inotify a little at a time, so it stops soon after
+ *              the server does. Queries are never held up by an update
+ */
+void IndexBuilder::watchChanges(QueryServer &server)
+{
+    pollfd events = {watchFd, POLLIN, 0};
+    while (not server.isStopped()) {
+        if (poll(&events, 1, WATCH_POLL_MS) <= 0 or not changesPending()) {
+            continue;
+        }
+        try {
+            updateIndex(watchDirectory);
+        } catch (const exception &e) {
+            cerr << "Could not update index: " << e.what() << endl;
+        }
+        addWatches(); //new directories need their own watch
+    }
+}
+
+/*
+ * name:        queryLoop (member function)
+ * purpose:     Read queries from the user and write their results
+ * arguments:
+ *     output: the file results are written to
+ * returns:     Nothing
+ * effects:     Runs until @q, @quit or the end of input. When watching, the
+ *              index is updated first if the directory changed
+ */
+void IndexBuilder::queryLoop(string &output)
+{
+    writer.open(output);
+    QueryItem item;
+    string result;
+    cout << "Query? ";
+    while (readQuery(cin, item)) {
+        if (watchFd >= 0 and changesPending()) {
+            try {
+                updateIndex(watchDirectory);
+            } catch (const exception &e) {
+                cerr << "Could not update index: " << e.what() << endl;
+            }
+            addWatches(); //new directories need their own watch
+        }
+        if (item.kind == QueryItem::QUIT) {
+            break;
+        } else if (item.kind == QueryItem::OUTPUT) {
+            writer.open(item.text);
+        } else if (item.kind == QueryItem::STATS) {
+            cout << statsReport();
+        } else {
+            runQuery(item, result);
+            writer.write(result);
+            writer.flush(); //the user may look at the file now
+        }
+        cout << "Query? ";
+    }
+    writer.close();
+}
+
+/*
+ * name:        queryBatch (member function)
+ * purpose:     Answer every query in the query file on a pool of threads
+ * arguments:
+ *     output: the file results are written to
+ * returns:     Nothing
+ * effects:     Each query writes to its own buffer, and the buffers are
+ *              written out in the order of the file, so the output is the
+ *              same as typing the queries in. Workers run at most a few
+ *              queries ahead of the writer. Exits the program if the query
+ *              file can't be read
+ */
+void IndexBuilder::queryBatch(string &output)
+{
+    ifstream input(queries);
+    if (not input) {
+        cerr << "Could not open " << queries << ", exiting." << endl;
+        exit(EXIT_FAILURE);
+    }
+    vector<QueryItem> items;
+    QueryItem item;
+    while (readQuery(input, item) and item.kind != QueryItem::QUIT) {
+        items.push_back(item);
+    }
+
+    size_t workers = max(1u, thread::hardware_concurrency());
+    size_t window = 16 * workers; //answered queries allowed to wait
+    vector<QueryResult> results(items.size());
+    mutex lock;
+    condition_variable readyCv, roomCv;
+    size_t next = 0, written = 0;
+    auto worker = [&]() {
+        while (true) {
+            size_t i;
+            {
+                unique_lock<mutex> guard(lock);
+                roomCv.wait(guard, [&]() {
+                    return next >= items.size() or next < written + window;
+                });
+                if (next >= items.size()) {
+                    return;
+                }
+                i = next++;
+            }
+            //the index is only read, so queries need no lock
+            if (items[i].kind != QueryItem::OUTPUT) {
+                runQuery(items[i], results[i].output);
+            }
+            {
+                lock_guard<mutex> guard(lock);
+                results[i].ready = true;
+            }
+            readyCv.notify_all();
+        }
+    };
+    vector<thread> pool;
+    for (size_t w = 0; w < workers; w++) {
+        pool.emplace_back(worker);
+    }
+    writer.open(output);
+    for (size_t i = 0; i < items.size(); i++) {
+        {
+            unique_lock<mutex> guard(lock);
+            readyCv.wait(guard, [&]() { return results[i].ready; });
+            written = i + 1;
+        }
+        roomCv.notify_all();
+        if (items[i].kind == QueryItem::OUTPUT) {
+            writer.open(items[i].text);
+        } else if (items[i].kind == QueryItem::STATS) {
+            cout << statsReport(); //later queries may have run already
+        } else {
+            writer.write(results[i].output);
+        }
+    }
+    writer.close();
+    for (thread &t : pool) {
+        t.join();
+    }
+}
+
+/*
+ * name:        readQuery (member function)
+ * purpose:     Read the next command of the query language
+ * arguments:
+ *     input: where the commands are typed
+ *     item: filled with the command
+ * returns:     false at the end of input
+ * effects:     @q or @quit ends the queries, @i or @insensitive searches for
+ *              the next word ignoring case, @b or @boolean runs the rest of
+ *              the line as a BooleanQuery, @re or @regex runs the rest of
+ *              the line as a RegexQuery, @fuzzy K searches for the words
+ *              within K edits of the next word, @f switches the output file
+ *              to the next word, @stats prints the index's stats, anything
+ *              else is searched for with case. A command missing its word
+ *              reads as NOTHING
+ */
+bool IndexBuilder::readQuery(istream &input, QueryItem &item)
+{
+    string query;
+    if (not (input >> query)) {
+        return false;
+    }
+    item.text.clear();
+    if (query == "@q" or query == "@quit") {
+        item.kind = QueryItem::QUIT;
+    } else if (query == "@i" or query == "@insensitive") {
+        item.kind = (input >> item.text) ? QueryItem::INSENSITIVE
+                                         : QueryItem::NOTHING;
+    } else if (query == "@b" or query == "@boolean") {
+        item.kind = QueryItem::BOOLEAN;
+        getline(input, item.text);
+    } else if (query == "@re" or query == "@regex") {
+        item.kind = QueryItem::REGEX;
+        getline(input, item.text);
+    } else if (query == "@fuzzy") {
+        item.kind = (input >> item.distance >> item.text) ? QueryItem::FUZZY
+                                                          : QueryItem::NOTHING;
+    } else if (query == "@f") {
+        item.kind = (input >> item.text) ? QueryItem::OUTPUT
+                                         : QueryItem::NOTHING;
+    } else if (query == "@stats") {
+        item.kind = QueryItem::STATS;
+    } else {
+        item.kind = QueryItem::WORD;
+        item.text = query;
+    }
+    return true;
+}
+
+/*
+ * name:        runQuery (member function)
+ * purpose:     Answer one search command
+ * arguments:
+ *     item: the command, a WORD, INSENSITIVE, BOOLEAN, REGEX or FUZZY
+ *           search
+ *     output: an empty string, set to the results as written to the file
+ * returns:     Nothing
+ * effects:     Other commands are ignored. Results are taken from the cache
+ *              if the same query was answered on the same snapshot, and kept
+ *              in it otherwise. Only reads the snapshot it started on, so
+ *              several threads may run queries while an update publishes
+ */
+void IndexBuilder::runQuery(QueryItem &item, string &output)
+{
+    string key = cacheKey(item);
+    if (key.empty()) {
+        return;
+    }
+    shared_ptr<Snapshot> snap = snapshot(); //held until the results are out
+    IndexSet &index = snap->index;
+    key = to_string(snap->version) + " " + key;
+    if (cache.find(key, output)) {
+        return;
+    }
+    if (item.kind == QueryItem::WORD) {
+        findWord(index, item.text, output, true);
+    } else if (item.kind == QueryItem::INSENSITIVE) {
+        findWord(index, item.text, output, false);
+    } else if (item.kind == QueryItem::BOOLEAN) {
+        findQuery(index, item.text, output);
+    } else if (item.kind == QueryItem::REGEX) {
+        findRegex(index, item.text, output);
+    } else {
+        findFuzzy(index, item.distance, item.text, output);
+    }
+    cache.insert(key, output);
+}
+
+/*
+ * name:        cacheKey (member function)
+ * purpose:     Normalize a search command into its key in the result cache
+ * arguments:
+ *     item: the command
+ * returns:     a key that is the same for two commands exactly when their
+ *              results are written the same way, or "" if the command is
+ *              not a search
+ * effects:     Words are stripped and lines trimmed as the searches do, so
+ *              "fox." and "fox" share a key, but case is kept because
+ *              not found messages repeat the query as typed
+ */
+string IndexBuilder::cacheKey(QueryItem &item)
+{
+    string expression = item.text;
+    if (item.kind == QueryItem::WORD) {
+        return "w " + string(stripPattern(expression));
+    } else if (item.kind == QueryItem::INSENSITIVE) {
+        return "i " + string(stripPattern(expression));
+    } else if (item.kind == QueryItem::BOOLEAN) {
+        return (readCaseFlag(expression) ? "b " : "B ") + expression;
+    } else if (item.kind == QueryItem::REGEX) {
+        return (readCaseFlag(expression) ? "r " : "R ") + expression;
+    } else if (item.kind == QueryItem::FUZZY) {
+        return "f " + item.distance + " " +
+               string(stripNonAlphaNum(expression));
+    }
+    return "";
+}
+
+/*
+ * name:        findWord (member function)
+ * purpose:     Write every line a word appears on
+ * arguments:
+ *     index: the snapshot of the index to search
+ *     input: the word as the user typed it
+ *     output: where the results are appended, as written to the file
+ *     caseSens: whether case must match exactly
+ * returns:     Nothing
+ * effects:     Writes a not found message if the word appears nowhere. A
+ *              word with '*' or '?' in it is searched for as a pattern,
+ *              unless its only '?' is at an end, where it is punctuation
+ */
+void IndexBuilder::findWord(IndexSet &index, string &input, string &output,
+                            bool caseSens)
+{
+    if (isPattern(input)) {
+        findPattern(index, input, output, caseSens);
+        return;
+    }
+    string word(stripNonAlphaNum(input));
+    IndexSet::Cursor found = index.getCursor(word, caseSens);
+    if (found.done()) {
+        if (caseSens) {
+            output += word + " Not Found. Try with @insensitive or @i.\n";
+        } else {
+            output += word + " Not Found.\n";
+        }
+        return;
+    }
+    for (; not found.done(); found.next()) {
+        readWords(index, found.current(), output);
+    }
+}
+
+/*
+ * name:        findPattern (member function)
+ * purpose:     Write every line a word matching a wildcard pattern appears
+ *              on, where '*' stands for any run of characters and '?' for
+ *              any one character
+ * arguments:
+ *     index: the snapshot of the index to search
+ *     input: the pattern as the user typed it, for example conn*
+ *     output: where the results are appended, as written to the file
+ *     caseSens: whether case must match exactly
+ * returns:     Nothing
+ * effects:     Writes a not found message if no word matches. A line is
+ *              written once however many of its words match
+ */
+void IndexBuilder::findPattern(IndexSet &index, string &input,
+                               string &output, bool caseSens)
+{
+    string pattern(stripPattern(input));
+    vector<pair<int, int>> found = index.getMatches(pattern, caseSens);
+    if (found.empty()) {
+        if (caseSens) {
+            output += pattern + " Not Found. Try with @insensitive or @i.\n";
+        } else {
+            output += pattern + " Not Found.\n";
+        }
+        return;
+    }
+    for (pair<int, int> &node : found) {
+        readWords(index, node, output);
+    }
+}
+
+/*
+ * name:        findQuery (member function)
+ * purpose:     Write every line a query of several words matches
+ * arguments:
+ *     index: the snapshot of the index to search
+ *     expression: the query, which may start with @i or @insensitive to
+ *                 ignore case for every word in it
+ *     output: where the results are appended, as written to the file
+ * returns:     Nothing
+ * effects:     Writes why the query is wrong if it can't be parsed, and a
+ *              not found message if nothing matches
+ */
+void IndexBuilder::findQuery(IndexSet &index, string expression,
+                             string &output)
+{
+    bool caseSens = readCaseFlag(expression);
+    vector<pair<int, int>> found;
+    try {
+        BooleanQuery query(expression, caseSens);
+        found = query.evaluate(index);
+    } catch (const runtime_error &e) {
+        output += "Invalid query " + expression + ": " + e.what() + "\n";
+        return;
+    }
+    if (found.empty()) {
+        output += expression + " Not Found.\n";
+        return;
+    }
+    for (pair<int, int> &node : found) {
+        readWords(index, node, output);
+    }
+}
+
+/*
+ * name:        findRegex (member function)
+ * purpose:     Write every line a regular expression matches
+ * arguments:
+ *     index: the snapshot of the index to search
+ *     expression: the expression, which may start with @i or @insensitive
+ *                 to ignore case
+ *     output: where the results are appended, as written to the file
+ * returns:     Nothing
+ * effects:     Writes why the expression is wrong if it can't be compiled,
+ *              and a not found message if nothing matches
+ */
+void IndexBuilder::findRegex(IndexSet &index, string expression,
+                             string &output)
+{
+    bool caseSens = readCaseFlag(expression);
+    vector<pair<int, int>> found;
+    try {
+        RegexQuery query(expression, caseSens);
+        found = query.evaluate(index);
+    } catch (const runtime_error &e) {
+        output += "Invalid regex " + expression + ": " + e.what() + "\n";
+        return;
+    }
+    if (found.empty()) {
+        output += expression + " Not Found.\n";
+        return;
+    }
+    for (pair<int, int> &node : found) {
+        readWords(index, node, output);
+    }
+}
+
+/*
+ * name:        findFuzzy (member function)
+ * purpose:     Write every line a word close to the given one appears on,
+ *              for words typed with a mistake or two
+ * arguments:
+ *     index: the snapshot of the index to search
+ *     distance: how many edits (a character inserted, removed or changed)
+ *               a word may be from the given one, as the user typed it
+ *     input: the word as the user typed it
+ *     output: where the results are appended, as written to the file
+ * returns:     Nothing
+ * effects:     Case is ignored. Writes why the distance is wrong if it isn't
+ *              a number from 0 to MAX_FUZZY, and a not found message if no
+ *              word is close enough
+ */
+void IndexBuilder::findFuzzy(IndexSet &index, string &distance,
+                             string &input, string &output)
+{
+    string word(stripNonAlphaNum(input));
+    if (distance.size() != 1 or distance[0] < '0' or
+        distance[0] > '0' + MAX_FUZZY) {
+        output += "Invalid query @fuzzy " + distance + " " + word +
+                  ": distance must be 0 to " + to_string(MAX_FUZZY) + "\n";
+        return;
+    }
+    vector<pair<int, int>> found = index.getFuzzy(word, distance[0] - '0');
+    if (found.empty()) {
+        output += word + " Not Found.\n";
+        return;
+    }
+    for (pair<int, int> &node : found) {
+        readWords(index, node, output);
+    }
+}
+
+/*
+ * name:        readCaseFlag (member function)
+ * purpose:     Trim the rest of a query line and take its case flag off
+ * arguments:
+ *     expression: the rest of the line, trimmed in place
+ * returns:     false if it started with @i or @insensitive, which is
+ *              removed, true otherwise
+ * effects:     None
+ */
+bool IndexBuilder::readCaseFlag(string &expression)
+{
+    size_t start = expression.find_first_not_of(" \t\r");
+    size_t end = expression.find_last_not_of(" \t\r");
+    expression = start == string::npos ? ""
+                 : expression.substr(start, end - start + 1);
+    bool caseSens = true;
+    for (string flag : {"@i ", "@insensitive "}) {
+        if (expression.compare(0, flag.size(), flag) == 0) {
+            caseSens = false;
+            expression = expression.substr(flag.size());
+        }
+    }
+    return caseSens;
+}
+
+/*
+ * name:        readWords (member function)
+ * purpose:     Write one result line
+ * arguments:
+ *     index: the snapshot of the index to search
+ *     node: the (file index, line number) of the result
+ *     output: where the results are appended, as written to the file
+ * returns:     Nothing
+ * effects:     Writes path:lineNumber: line, counting lines from 1
+ */
+void IndexBuilder::readWords(IndexSet &index, pair<int, int> node,
+                             string &output)
+{
+    char number[16];
+    char *end = to_chars(number, number + sizeof(number), node.second + 1).ptr;
+    output += index.getFile(node.first);
+    output += ':';
+    output.append(number, end);
+    output += ": ";
+    output += index.getLine(node.first, node.second);
+    output += '\n';
+}
+
+/*
+ * name:        statsReport (member function)
+ * purpose:     Describe the index: its counts, how full its word table is,
+ *              the memory each part takes, its largest posting lists, how
+ *              long the last build or update took and how the result cache
+ *              is doing
+ * arguments:   None
+ * returns:     the report, several lines of text
+ * effects:     Reads every segment of the current snapshot, so takes a
+ *              moment on a large index
+ */
+string IndexBuilder::statsReport()
+{
+    shared_ptr<Snapshot> snap = snapshot();
+    IndexStats stats = snap->index.getStats();
+    BuildTimes &built = snap->times;
+    ostringstream out;
+    out << fixed << setprecision(3);
+    auto megabytes = [](uint64_t bytes) { return bytes / 1048576.0; };
+    auto seconds = [](uint64_t nanos) { return nanos / 1e9; };
+    out << "Index: " << stats.segments << " segments, " << stats.files
+        << " files (" << stats.deadFiles << " dead), " << stats.lines
+        << " lines\n";
+    out << "Words: " << stats.terms << " terms, " << stats.groups
+        << " ignoring case, " << stats.postings << " postings, "
+        << stats.trigrams << " trigrams\n";
+    out << "Word table: " << stats.slots << " slots, load "
+        << (stats.slots == 0 ? 0.0 : (double)stats.groups / stats.slots)
+        << ", average probe "
+        << (stats.groups == 0 ? 0.0 : (double)stats.probes / stats.groups)
+        << ", longest probe " << stats.longestProbe << "\n";
+    out << "Memory (MB): paths " << megabytes(stats.pathTableBytes)
+        << ", lines " << megabytes(stats.lineStoreBytes) << ", words "
+        << megabytes(stats.wordTableBytes) << ", postings "
+        << megabytes(stats.postingBytes) << ", trigrams "
+        << megabytes(stats.trigramBytes) << ", total "
+        << megabytes(stats.imageBytes) << "\n";
+    out << "Largest posting lists:";
+    for (auto &list : stats.largest) {
+        out << " " << list.second << " " << list.first;
+    }
+    out << "\n";
+    if (built.total == 0) {
+        out << "Build (s): none, the index was loaded\n";
+    } else {
+        out << "Build (s): traverse " << seconds(built.traverse)
+            << ", read " << seconds(built.read) << ", tokenize "
+            << seconds(built.tokenize) << ", insert "
+            << seconds(built.insert) << ", resize " << seconds(built.resize)
+            << " (" << built.resizes << " resizes), freeze "
+            << seconds(built.freeze);
+        if (built.spills > 0) {
+            out << ", spill " << seconds(built.spill) << " ("
+                << built.spills << " runs), merge " << seconds(built.merge);
+        }
+        out << ", total " << seconds(built.total) << "\n";
+    }
+    out << "Cache: " << cache.getHits() << " hits, " << cache.getMisses()
+        << " misses, " << cache.getEvictions() << " evictions, "
+        << cache.getEntryCount() << " entries, "
+        << megabytes(cache.getBytes()) << " MB\n";
+    return out.str();
+}
@@ -10,7 +10,26 @@
  *          which is responsible for building the file tree and hash table. 
  *          The IndexBuilder includes methods for building a 
  *          FSTree tree, stripping words accordingly, and inserting data into 
- *          the hashtable.
+ *          the hashtable. Once built, the index is frozen into an IndexFile
+ *          image, which can be saved and loaded again instead of rebuilt.
+ *          Files are read and tokenized on several threads; their words are
+ *          merged into the hash table on one thread, in traversal order.
+ *          A saved index can be brought up to date by reading only the files
+ *          that changed, and a running gerp can watch its directory and do
+ *          the same before each query. Queries can also come from a file,
+ *          in which case they are answered on several threads at once.
+ *          The results of recent queries are cached until the index
+ *          changes, so a repeated query is only copied out. Results are
+ *          formatted straight into strings and written in large batches.
+ *          Each phase of a build is timed, and @stats reports the timings
+ *          along with the size and shape of every part of the index.
+ *          Queries read the index through a snapshot that is never changed:
+ *          an update builds the next snapshot from a copy and publishes it
+ *          when done, so a server can answer clients on many threads while
+ *          it keeps its index current on another. Given a memory budget,
+ *          a build writes the hash table to disk as a sorted segment each
+ *          time it fills the budget, and merges those runs into one
+ *          segment on disk at the end, so the tree need not fit in memory.
  *
  */
 
@@ -19,12 +38,23 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <cctype>
+#include <memory>
+#include <utility>
 #include "FSTree.h"
 #include "DirNode.h"
 #include "hashTable.h"
+#include "indexFile.h"
+#include "indexSet.h"
+#include "booleanQuery.h"
+#include "regexQuery.h"
+#include "resultCache.h"
+#include "resultWriter.h"
+#include "queryServer.h"
 using namespace std;
 
 
@@ -33,16 +63,143 @@ class IndexBuilder
 {
     public:
         void run(string inputDirectory, string &outputFile);
+        void build(string inputDirectory);
+        void saveIndex(const string &indexFile);
+        void loadIndex(const string &indexFile);
+        void update(string inputDirectory);
+        void watch(string inputDirectory);
+        void query(string &outputFile);
+        void setQueryFile(const string &queryFile);
+        void setAsyncOutput(bool async);
+        void setStats(bool show);
+        void setMemoryBudget(size_t bytes);
+        void search(const string &command, string &output);
+        void serve(const string &socketPath);
+        ~IndexBuilder();
     private:
+        //one file's text and words, tokenized off the main thread
+        struct FileResult {
+            //set before the file is read
+            int oldFile = -1;      //the file's number in the index, if any
+            string_view stored;    //its text in the index, to use, not read
+            fileStamp storedStamp;
+            bool checkHash = false; //same hash as storedStamp: don't redo it
+            //set by processFile
+            bool ready = false;
+            bool opened = false;
+            bool same = false;     //checkHash found the contents unchanged
+            bool tooLarge = false; //line offsets would not fit in uint32
+            fileStamp stamp;
+            string text; //every line, each followed by '\n'
+            vector<uint32_t> lineOffsets; //start of each line, then the end
+            //each distinct word with the lines it is on, in line order
+            vector<pair<string, vector<int>>> words;
+            vector<uint32_t> trigrams; //sorted, from splitTrigrams
+            uint64_t readNanos = 0;
+            uint64_t tokenizeNanos = 0;
+        };
+
+        //how long each phase of the last build or update took, in
+        //nanoseconds. Reading and tokenizing run on several threads at
+        //once, so theirs is the time of every thread added up
+        struct BuildTimes {
+            uint64_t traverse = 0; //listing the directory
+            uint64_t read = 0;
+            uint64_t tokenize = 0; //line offsets, words and trigrams
+            uint64_t insert = 0;   //merging into the hash table
+            uint64_t resize = 0;   //growing the hash table
+            uint64_t freeze = 0;   //building the image
+            uint64_t spill = 0;    //writing runs out under a memory budget
+            uint64_t merge = 0;    //merging the runs into one segment
+            uint64_t total = 0;
+            int resizes = 0;
+            int spills = 0;
+        };
+
+        //compact once there are this many segments, or a quarter of the
+        //files in them are dead
+        static const int MAX_SEGMENTS = 8;
+        //the most edits @fuzzy allows; past it nearly every word is close
+        static const int MAX_FUZZY = 3;
+        //memory for the results of recent queries
+        static const size_t CACHE_BYTES = 64 << 20;
+        //what a word costs the hash table beyond its text and lines, for
+        //keeping to a memory budget
+        static const size_t WORD_OVERHEAD = 64;
+        //longest a server's updater waits on inotify before checking
+        //whether the server stopped
+        static const int WATCH_POLL_MS = 250;
+
+        //one command of the query language, as read from the user
+        struct QueryItem {
+            enum Kind { WORD, INSENSITIVE, BOOLEAN, REGEX, FUZZY, OUTPUT,
+                        STATS, QUIT, NOTHING };
+            Kind kind = NOTHING;
+            string text;           //the word, query or file name
+            string distance;       //the edits a FUZZY word allows
+        };
+        //a query of a batch and its output, answered off the main thread
+        struct QueryResult {
+            bool ready = false;
+            string output;
+        };
+
+        //an index as queries see it. Never changed once published, so
+        //any number of threads can read it while the next one is built
+        struct Snapshot {
+            IndexSet index;
+            uint64_t version = 0;  //publications before it, keys the cache
+            BuildTimes times;      //of the build or update that made it
+        };
+
         HashTable table;
+        shared_ptr<Snapshot> current = make_shared<Snapshot>();
+        shared_ptr<Snapshot> pending; //the next snapshot, while it is built
+        string queries;             //file of queries to batch, if any
+        ResultCache cache{CACHE_BYTES};
+        ResultWriter writer;
+        BuildTimes times;
+        bool showStats = false;     //print the stats before the queries
+        size_t memoryBudget = 0;    //bytes the table may hold, 0 for any
+        size_t tableBytes = 0;      //about what the table holds now
+        IndexSet runs;              //the table as spilled to disk so far
         int fileIndexCounter = 0;
+        vector<string> directories; //every directory of the last listing
+        string watchDirectory;
+        int watchFd = -1;           //inotify, when watching
+        shared_ptr<Snapshot> snapshot();
+        void publish();
         void buildIndex(string directoryPath);
-        void processFile(string &filePath);
-        void traverseHelper(DirNode *root, string currPath);
-        string stripNonAlphaNum(string &input);
+        void updateIndex(string directoryPath);
+        void compact(vector<string> &paths);
+        void freezeTable(IndexSet &index);
+        void spillTable();
+        string spillPath(const string &name);
+        void listFiles(string directoryPath, vector<string> &paths);
+        void ingestFiles(vector<string> &paths, vector<FileResult> &results);
+        void processFile(const string &filePath, FileResult &result);
+        void mergeFile(string &filePath, FileResult &result);
+        void traverseHelper(DirNode *root, string currPath,
+                            vector<string> &paths);
+        void addWatches();
+        bool changesPending();
+        void watchChanges(QueryServer &server);
         void queryLoop(string& output);
-        void findWord(string &input, ofstream& output, bool caseSens);
-        void readWords(pair<int, int> node, ofstream &output);
+        void queryBatch(string &output);
+        bool readQuery(istream &input, QueryItem &item);
+        void runQuery(QueryItem &item, string &output);
+        string cacheKey(QueryItem &item);
+        void findWord(IndexSet &index, string &input, string &output,
+                      bool caseSens);
+        void findPattern(IndexSet &index, string &input, string &output,
+                         bool caseSens);
+        void findQuery(IndexSet &index, string expression, string &output);
+        void findRegex(IndexSet &index, string expression, string &output);
+        void findFuzzy(IndexSet &index, string &distance, string &input,
+                       string &output);
+        bool readCaseFlag(string &expression);
+        void readWords(IndexSet &index, pair<int, int> node, string &output);
+        string statsReport();
 };
 
 #endif
\ No newline at end of file
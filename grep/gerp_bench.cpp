@@ -0,0 +1,431 @@
+/*
+ *  gerp_bench.cpp
+ *  Harrison Tun and Jonah Pflaster
+ *
+ *  COMP 15 Proj Gerp
+ *
+ *  Purpose: Benchmark driver for gerp. Writes a synthetic directory tree
+ *          whose words follow a Zipf distribution over a made up
+ *          vocabulary, indexes it, then times queries for rare, common and
+ *          absent words, each with and without case, and prints one CSV row
+ *          per measurement:
+ *
+ *              corpus,phase,case,count,seconds,p50_us,p90_us,p99_us,max_us,
+ *              peak_rss_kb
+ *
+ *          The build row's seconds is the whole build and count the number
+ *          of files; a query row's count is the number of queries, seconds
+ *          their total and the percentiles are of single query latencies.
+ *          peak_rss_kb is the high water mark of resident memory during the
+ *          phase (the whole run on kernels that can't reset it).
+ *          The batch row asks every query again as one --queries file, on
+ *          a second build of the tree so no answer comes from the first
+ *          one's result cache; its output file must match the answers
+ *          search gave byte for byte, or the run fails.
+ *          --memory-budget MB builds as gerp --memory-budget does, and is
+ *          added to the corpus column so the rows are told apart.
+ *
+ *          The same options and --seed always write the same tree and ask
+ *          the same queries, so rows from two builds of gerp compare
+ *          directly. Every query is different and the batch has a build of
+ *          its own, so none is answered from the result cache.
+ *
+ *          Build it with optimization, e.g. make clean && make gerp_bench.
+ *
+ */
+
+#include "gerpProcessor.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <set>
+#include <sys/resource.h>
+using namespace std;
+
+//what to generate
+struct BenchCorpus {
+    int files = 2000;
+    int fileKb = 16;
+    int vocabulary = 50000;
+    double skew = 1.0;       //Zipf exponent: word i is drawn as 1/(i+1)^skew
+    uint64_t seed = 1;
+    int queries = 200;       //per kind of word and case mode
+};
+
+static vector<string> makeVocabulary(const BenchCorpus &corpus);
+static void writeCorpus(const BenchCorpus &corpus,
+                        const vector<string> &vocabulary,
+                        const string &directory);
+static vector<string> pickQueries(const BenchCorpus &corpus,
+                                  const vector<string> &vocabulary,
+                                  const string &kind, bool caseSens);
+static bool checkBatch(IndexBuilder &builder, const vector<string> &queries,
+                       const string &outputFile);
+static void printRow(const string &corpus, const string &phase,
+                     const string &mode, size_t count, double seconds,
+                     vector<double> latencies, long rssKb);
+static void resetPeakRss();
+static long peakRssKb();
+
+/*
+ * name:        main
+ * purpose:     Run the benchmark
+ * arguments:   argc, argv - the options, see the usage message
+ * returns:     0, or EXIT_FAILURE on a bad option or an unwritable directory
+ * effects:     Writes the tree under --dir (a new directory in /tmp by
+ *              default) and removes it afterwards unless --keep is given.
+ *              Prints CSV to cout
+ */
+int main(int argc, char *argv[])
+{
+    BenchCorpus corpus;
+    string directory;
+    bool keep = false;
+    int budgetMb = 0;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--files" and hasValue) {
+            corpus.files = max(1, atoi(argv[++i]));
+        } else if (arg == "--file-kb" and hasValue) {
+            corpus.fileKb = max(1, atoi(argv[++i]));
+        } else if (arg == "--vocabulary" and hasValue) {
+            corpus.vocabulary = max(100, atoi(argv[++i]));
+        } else if (arg == "--skew" and hasValue) {
+            corpus.skew = atof(argv[++i]);
+        } else if (arg == "--seed" and hasValue) {
+            corpus.seed = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--queries" and hasValue) {
+            corpus.queries = max(1, atoi(argv[++i]));
+        } else if (arg == "--dir" and hasValue) {
+            directory = argv[++i];
+        } else if (arg == "--memory-budget" and hasValue) {
+            budgetMb = max(1, atoi(argv[++i]));
+        } else if (arg == "--keep") {
+            keep = true;
+        } else {
+            cerr << "Usage: ./gerp_bench [--files N] [--file-kb KB] "
+                 << "[--vocabulary WORDS] [--skew S]\n"
+                 << "                    [--seed N] [--queries N] "
+                 << "[--dir DIRECTORY] [--keep]\n"
+                 << "                    [--memory-budget MB]" << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (directory.empty()) {
+        char name[] = "/tmp/gerp_bench.XXXXXX";
+        if (mkdtemp(name) == nullptr) {
+            cerr << "Could not make a directory in /tmp" << endl;
+            return EXIT_FAILURE;
+        }
+        directory = name;
+    }
+    //the name says how the corpus was made, so rows can be matched up
+    string name = "files" + to_string(corpus.files) + "_kb" +
+                  to_string(corpus.fileKb) + "_vocab" +
+                  to_string(corpus.vocabulary) + "_skew" +
+                  to_string(corpus.skew).substr(0, 4) + "_seed" +
+                  to_string(corpus.seed);
+    if (budgetMb > 0) {
+        name += "_budget" + to_string(budgetMb);
+    }
+
+    vector<string> vocabulary = makeVocabulary(corpus);
+    try {
+        writeCorpus(corpus, vocabulary, directory);
+    } catch (const exception &e) {
+        cerr << "Could not write " << directory << ": " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    cout << "corpus,phase,case,count,seconds,p50_us,p90_us,p99_us,max_us,"
+         << "peak_rss_kb" << endl;
+    IndexBuilder builder;
+    builder.setMemoryBudget((size_t)budgetMb << 20);
+    resetPeakRss();
+    auto start = chrono::steady_clock::now();
+    builder.build(directory);
+    chrono::duration<double> took = chrono::steady_clock::now() - start;
+    printRow(name, "build", "-", corpus.files, took.count(), {},
+             peakRssKb());
+
+    vector<string> asked; //every query, for the batch
+    for (string kind : {"rare", "common", "absent"}) {
+        for (bool caseSens : {true, false}) {
+            vector<string> queries = pickQueries(corpus, vocabulary, kind,
+                                                 caseSens);
+            asked.insert(asked.end(), queries.begin(), queries.end());
+            vector<double> latencies;
+            double total = 0;
+            string output;
+            resetPeakRss();
+            for (string &query : queries) {
+                output.clear();
+                auto begin = chrono::steady_clock::now();
+                builder.search(query, output);
+                chrono::duration<double> one =
+                    chrono::steady_clock::now() - begin;
+                latencies.push_back(one.count());
+                total += one.count();
+            }
+            printRow(name, kind, caseSens ? "sensitive" : "insensitive",
+                     queries.size(), total, latencies, peakRssKb());
+        }
+    }
+
+    //builder's cache holds every query by now, so the batch runs on a new
+    //build, made before the batch's files are written into the tree
+    IndexBuilder batchBuilder;
+    batchBuilder.setMemoryBudget((size_t)budgetMb << 20);
+    batchBuilder.build(directory);
+    string queryFile = directory + "/batch_queries.txt";
+    string outputFile = directory + "/batch_output.txt";
+    ofstream batch(queryFile);
+    for (string &query : asked) {
+        batch << query << "\n";
+    }
+    batch.close();
+    batchBuilder.setQueryFile(queryFile);
+    resetPeakRss();
+    start = chrono::steady_clock::now();
+    batchBuilder.query(outputFile);
+    took = chrono::steady_clock::now() - start;
+    printRow(name, "batch", "-", asked.size(), took.count(), {},
+             peakRssKb());
+    bool same = checkBatch(builder, asked, outputFile);
+
+    if (not keep) {
+        error_code ignored;
+        filesystem::remove_all(directory, ignored);
+    }
+    return same ? 0 : EXIT_FAILURE;
+}
+
+/*
+ * name:        makeVocabulary
+ * purpose:     Make up the distinct words of the corpus
+ * arguments:   corpus - how many words, and the seed
+ * returns:     the words, lowercase letters only, in order of how often
+ *              they will be drawn
+ * effects:     None
+ */
+static vector<string> makeVocabulary(const BenchCorpus &corpus)
+{
+    mt19937_64 rng(corpus.seed);
+    uniform_int_distribution<int> length(2, 12), letter('a', 'z');
+    set<string> seen;
+    vector<string> vocabulary;
+    while ((int)vocabulary.size() < corpus.vocabulary) {
+        string word;
+        for (int k = length(rng); k > 0; k--) {
+            word += (char)letter(rng);
+        }
+        if (seen.insert(word).second) {
+            vocabulary.push_back(word);
+        }
+    }
+    return vocabulary;
+}
+
+/*
+ * name:        writeCorpus
+ * purpose:     Write the synthetic directory tree
+ * arguments:   corpus - how many files of what size, and the seed
+ *              vocabulary - the words, most often drawn first
+ *              directory - where to write, made if missing
+ * returns:     Nothing
+ * effects:     Files go 100 to a subdirectory. Words are drawn with Zipf
+ *              weights; about one in eight is capitalized and some carry
+ *              punctuation, so stripping and case folding get exercised.
+ *              Throws a filesystem_error if the tree can't be written
+ */
+static void writeCorpus(const BenchCorpus &corpus,
+                        const vector<string> &vocabulary,
+                        const string &directory)
+{
+    mt19937_64 rng(corpus.seed + 1);
+    vector<double> weights;
+    for (size_t i = 0; i < vocabulary.size(); i++) {
+        weights.push_back(1.0 / pow(i + 1, corpus.skew));
+    }
+    discrete_distribution<int> pick(weights.begin(), weights.end());
+    uniform_int_distribution<int> style(0, 31), lineWords(4, 14);
+    size_t bytes = (size_t)corpus.fileKb * 1024;
+    for (int f = 0; f < corpus.files; f++) {
+        string subdirectory = directory + "/d" + to_string(f / 100);
+        filesystem::create_directories(subdirectory);
+        string text;
+        text.reserve(bytes + 64);
+        while (text.size() < bytes) {
+            for (int w = lineWords(rng); w > 0; w--) {
+                string word = vocabulary[pick(rng)];
+                int s = style(rng);
+                if (s < 4) {
+                    word[0] = toupper(word[0]);
+                } else if (s == 4) {
+                    word += ",";
+                } else if (s == 5) {
+                    word = "(" + word + ")";
+                }
+                text += word;
+                text += w > 1 ? ' ' : '\n';
+            }
+        }
+        string path = subdirectory + "/f" + to_string(f) + ".txt";
+        ofstream out(path, ios::binary);
+        if (not (out << text)) {
+            throw filesystem::filesystem_error(
+                "could not write", path,
+                make_error_code(errc::io_error));
+        }
+    }
+}
+
+/*
+ * name:        pickQueries
+ * purpose:     Choose the queries for one kind of word and case mode
+ * arguments:   corpus - how many queries, and the seed
+ *              vocabulary - the words, most often drawn first
+ *              kind - "rare" (from the least drawn half of the vocabulary),
+ *                     "common" (the most drawn words) or "absent" (words with
+ *                     a digit, which the corpus never has)
+ *              caseSens - false to ask with @i, in capitals
+ * returns:     the query commands, all different
+ * effects:     None
+ */
+static vector<string> pickQueries(const BenchCorpus &corpus,
+                                  const vector<string> &vocabulary,
+                                  const string &kind, bool caseSens)
+{
+    mt19937_64 rng(corpus.seed + (kind == "rare" ? 2 : kind == "common"
+                                                       ? 3 : 4));
+    int count = min(corpus.queries, (int)vocabulary.size() / 2);
+    vector<string> words;
+    if (kind == "common") {
+        words.assign(vocabulary.begin(), vocabulary.begin() + count);
+    } else if (kind == "rare") {
+        vector<string> tail(vocabulary.begin() + vocabulary.size() / 2,
+                            vocabulary.end());
+        shuffle(tail.begin(), tail.end(), rng);
+        words.assign(tail.begin(), tail.begin() + count);
+    } else {
+        for (int i = 0; i < count; i++) {
+            words.push_back(vocabulary[rng() % vocabulary.size()] +
+                            to_string(i));
+        }
+    }
+    vector<string> queries;
+    for (string &word : words) {
+        if (caseSens) {
+            queries.push_back(word);
+        } else {
+            transform(word.begin(), word.end(), word.begin(), ::toupper);
+            queries.push_back("@i " + word);
+        }
+    }
+    return queries;
+}
+
+/*
+ * name:        checkBatch
+ * purpose:     Check a batch's output against its queries asked one by one
+ * arguments:   builder - the index the queries were searched on, not the
+ *                        one the batch ran on
+ *              queries - the batch's queries, in order
+ *              outputFile - the file the batch wrote
+ * returns:     true if the file is every query's answer, in order
+ * effects:     Says on cerr where the file first goes wrong
+ */
+static bool checkBatch(IndexBuilder &builder, const vector<string> &queries,
+                       const string &outputFile)
+{
+    ifstream written(outputFile, ios::binary);
+    string expected, got;
+    for (size_t i = 0; i < queries.size(); i++) {
+        expected.clear();
+        builder.search(queries[i], expected);
+        got.assign(expected.size(), '\0');
+        written.read(&got[0], expected.size());
+        if (got != expected) {
+            cerr << "Batch output differs at query " << i + 1 << ", "
+                 << queries[i] << endl;
+            return false;
+        }
+    }
+    if (written.peek() != EOF) {
+        cerr << "Batch output has more than its queries' answers" << endl;
+        return false;
+    }
+    return true;
+}
+
+/*
+ * name:        printRow
+ * purpose:     Print one measurement as a CSV row
+ * arguments:   corpus, phase, mode - what was measured
+ *              count - how many files were built or queries asked
+ *              seconds - the total time
+ *              latencies - each query's time in seconds, or empty for a
+ *                          build, which leaves the percentiles blank
+ *              rssKb - the peak resident memory
+ * returns:     Nothing
+ * effects:     Writes to cout
+ */
+static void printRow(const string &corpus, const string &phase,
+                     const string &mode, size_t count, double seconds,
+                     vector<double> latencies, long rssKb)
+{
+    cout << corpus << "," << phase << "," << mode << "," << count << ","
+         << seconds;
+    sort(latencies.begin(), latencies.end());
+    for (double rank : {0.50, 0.90, 0.99, 1.0}) {
+        cout << ",";
+        if (not latencies.empty()) {
+            size_t at = min(latencies.size() - 1,
+                            (size_t)(rank * latencies.size()));
+            cout << latencies[at] * 1e6;
+        }
+    }
+    cout << "," << rssKb << endl;
+}
+
+/*
+ * name:        resetPeakRss
+ * purpose:     Start a new resident memory high water mark (Linux 4.0+), so
+ *              peakRssKb reports the peak of the phase that follows
+ * arguments:   None
+ * returns:     Nothing
+ * effects:     Writes to /proc/self/clear_refs, does nothing elsewhere
+ */
+static void resetPeakRss()
+{
+    ofstream clear("/proc/self/clear_refs");
+    if (clear) {
+        clear << "5" << endl;
+    }
+}
+
+/*
+ * name:        peakRssKb
+ * purpose:     Get the resident memory high water mark, from VmHWM when
+ *              /proc is available and getrusage otherwise
+ * arguments:   None
+ * returns:     the peak in kilobytes
+ * effects:     None
+ */
+static long peakRssKb()
+{
+    ifstream status("/proc/self/status");
+    string line;
+    while (getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return atol(line.c_str() + 6);
+        }
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
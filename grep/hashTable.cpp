@@ -22,14 +22,20 @@
 #include <fstream>
 #include <iostream>
 #include <cctype>
+#include <cstring>
 #include <algorithm>
+#include <chrono>
+#include <iterator>
+#if defined(__x86_64__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 /*
  * Default constructor for HashTable class
  */
 HashTable::HashTable () 
 {
-    wordTable.resize(tableCap);
+    wordTable.resize(tableCap, {0, 0});
     wordSize = 0; 
 }
 
@@ -61,31 +67,81 @@ string HashTable:: getFile(int key)
  * arguments:
  *     key: integer key to identify the file
  *     lineNum: line number to retrieve content from
- * returns:     string line content at the specified key and line number
+ * returns:     string_view of the line without its newline, valid until the
+ *              table is destroyed
+ * effects:     Throws a runtime_error if the key or line is not found
+ */
+string_view HashTable:: getLine(int key, int lineNum) 
+{
+    if (lineNum < 0 or lineNum >= getLineCount(key)) {
+        throw runtime_error("key not found");
+    }
+    const fileVars &file = fileTable[key];
+    uint32_t start = file.lineOffsets[lineNum];
+    return string_view(file.text.data() + start,
+                       file.lineOffsets[lineNum + 1] - start - 1);
+}
+
+/*
+ * name:        getText (member function)
+ * purpose:     Retrieve the whole text of a file
+ * arguments:
+ *     key: integer key to identify the file
+ * returns:     string_view of every line, each followed by '\n'
  * effects:     Throws a runtime_error if the key is not found
  */
-string HashTable:: getLine(int key, int lineNum) 
+string_view HashTable:: getText(int key) 
 {
     if (key < 0 or key >= int(fileTable.size())) {
         throw runtime_error("key not found");
     }
-    return fileTable[key].lineContent[lineNum];
+    return fileTable[key].text;
 }
 
 /*
- * name:        getLineContent (member function)
- * purpose:     Retrieve the line content associated with a given key
+ * name:        getLineOffsets (member function)
+ * purpose:     Retrieve where each line of a file starts in its text
  * arguments:
  *     key: integer key to identify the file
- * returns:     vector<string>& reference to the line content vector
+ * returns:     reference to the line count + 1 offsets, the last one being
+ *              the size of the text
  * effects:     Throws a runtime_error if the key is not found
  */
-vector<string>& HashTable:: getLineContent(int key) 
+const vector<uint32_t> &HashTable:: getLineOffsets(int key) 
 {
     if (key < 0 or key >= int(fileTable.size())) {
         throw runtime_error("key not found");
     }
-    return fileTable[key].lineContent;
+    return fileTable[key].lineOffsets;
+}
+
+/*
+ * name:        getStamp (member function)
+ * purpose:     Retrieve what a file looked like when it was read
+ * arguments:
+ *     key: integer key to identify the file
+ * returns:     the file's fileStamp
+ * effects:     Throws a runtime_error if the key is not found
+ */
+fileStamp HashTable:: getStamp(int key) 
+{
+    if (key < 0 or key >= int(fileTable.size())) {
+        throw runtime_error("key not found");
+    }
+    return fileTable[key].stamp;
+}
+
+/*
+ * name:        getLineCount (member function)
+ * purpose:     Get the number of lines in a file
+ * arguments:
+ *     key: integer key to identify the file
+ * returns:     int number of lines
+ * effects:     Throws a runtime_error if the key is not found
+ */
+int HashTable:: getLineCount(int key) 
+{
+    return getLineOffsets(key).size() - 1;
 }
 
 /*
@@ -94,23 +150,20 @@ vector<string>& HashTable:: getLineContent(int key)
  *              (case-insensitive)
  * arguments:
  *     key: string key to search for
- * returns:     set<pair<int, int>> vector of wordVars objects containing 
- *              matches
- * effects:     None
+ * returns:     reference to the sorted (file index, line number) pairs of
+ *              every case variant of the key, without duplicates; empty if
+ *              the key is not stored
+ * effects:     None. The merged list is kept up to date by insertion, so
+ *              this is one probe and no copying
  */
-set<pair<int, int>> HashTable:: getWord(string key) 
+const vector<pair<int, int>> &HashTable:: getWord(string key) 
 {
-    size_t bucketIndex = hashWord(toLowerCase(key)) % wordTable.size();
-    set<pair<int, int>> seenLines;
-    for (auto &node : wordTable[bucketIndex]) {
-        if (toLowerCase(node.key) == toLowerCase(key)) {
-            //if key matches, add node to set
-            for(auto &lines : node.values) { //making sure no duplicates
-                seenLines.insert(lines);
-            }
-        }
+    static const vector<pair<int, int>> notFound;
+    int fold = findFold(key, hashWord(key));
+    if (fold < 0) {
+        return notFound;
     }
-    return seenLines; //return set containing all matching wordVars
+    return getFoldValues(folds[fold]);
 }
 
 /*
@@ -124,10 +177,13 @@ set<pair<int, int>> HashTable:: getWord(string key)
  */
 wordVars* HashTable:: getCaseSensWord(string key) 
 {
-    size_t bucketIndex = hashWord(toLowerCase(key)) % wordTable.size();
-    for (auto &node : wordTable[bucketIndex]) {
-        if (node.key == key) { //check for caseSens key
-            return &node;
+    int fold = findFold(key, hashWord(key));
+    if (fold < 0) {
+        return nullptr;
+    }
+    for (wordVars *variant : folds[fold].variants) {
+        if (variant->key == key) { //check for caseSens key
+            return variant;
         }
     }
     return nullptr; //return nullptr, if no match is found
@@ -138,13 +194,17 @@ wordVars* HashTable:: getCaseSensWord(string key)
  * purpose:     Insert a new file entry into the hash table
  * arguments:
  *     file: string representing the file path
- *     lines: vector of strings containing the lines of the file
+ *     text: the file's lines, each followed by '\n'
+ *     lineOffsets: where each line starts in text, then text's size
+ *     stamp: the file's time, size and hash when it was read
  * returns:     int index of the inserted file
- * effects:     None
+ * effects:     text and lineOffsets are moved into the table and left empty
  */
-int HashTable:: insertFile(string &file, vector<string> &lines) 
+int HashTable:: insertFile(string &file, string &text,
+                           vector<uint32_t> &lineOffsets, fileStamp stamp) 
 {
-    fileTable.push_back({file, lines});
+    fileTable.push_back({file, std::move(text), std::move(lineOffsets),
+                         stamp});
     return (fileTable.size() - 1);
 }
 
@@ -160,27 +220,218 @@ int HashTable:: insertFile(string &file, vector<string> &lines)
  */
 void HashTable::insertWord(string key, int &index, int &value) 
 {
-    // Compute the bucket for the word
-    size_t bucket = hashWord(toLowerCase(key)) % wordTable.size();
-    // Iterate through the bucket to find a matching wordVars
-    for (auto& node : wordTable[bucket]) {
-        if (node.key == key) {
-            auto newPair = make_pair(index, value);
-            //pair is inserted correctly, don't continue
-            insertSorted(node.values, newPair);
-            return; //duplicate is found, do nothing
+    insertWordLines(key, index, {value});
+}
+
+/*
+ * name:        insertWordLines (member function)
+ * purpose:     Insert every line of one file a word appears on, with one
+ *              lookup instead of one per line
+ * arguments:
+ *     key: string key to insert
+ *     index: index of the file in the file table
+ *     lines: line numbers the word is on, in increasing order
+ * returns:     Nothing
+ * effects:     Resizes the hash table if the load factor exceeds 0.75
+ */
+void HashTable::insertWordLines(const string &key, int index,
+                                const vector<int> &lines)
+{
+    uint32_t hash = hashWord(key);
+    int fold = findFold(key, hash);
+    if (fold < 0) {
+        fold = addFold(hash); //may resize, never moves postings
+    }
+    foldVars &group = folds[fold];
+    wordVars *node = nullptr;
+    for (wordVars *variant : group.variants) {
+        if (variant->key == key) {
+            node = variant;
+            break;
+        }
+    }
+    if (node == nullptr) {
+        words.push_back({storeKey(key), {}});
+        node = &words.back();
+        wordSize++;
+        if (group.variants.size() == 1) {
+            //a second variant: the merged list can't borrow the first's
+            group.values = group.variants[0]->values;
         }
+        group.variants.push_back(node);
+    }
+    for (int line : lines) {
+        insertSorted(node->values, {index, line});
+    }
+    if (group.variants.size() > 1) {
+        mergeSorted(group.values, index, lines);
     }
-    // If no match is found, create a new wordVars entry
-    wordVars newNode = {key, {}};
-    insertSorted(newNode.values, {index, value});
-    wordTable[bucket].push_back(newNode);
-    // Increment the size of words tracked
-    wordSize++;
-    // Resize if the load factor exceeds 0.75
-    if (wordSize > 0.75 * wordTable.size()) {
+}
+
+/*
+ * name:        insertTrigrams (member function)
+ * purpose:     Record the trigrams of a file
+ * arguments:
+ *     index: index of the file in the file table, above every file
+ *            inserted before
+ *     fileTrigrams: the file's distinct trigrams, from splitTrigrams
+ * returns:     Nothing
+ * effects:     Files must come in increasing order, so each trigram's files
+ *              stay sorted by appending
+ */
+void HashTable::insertTrigrams(int index, const vector<uint32_t> &fileTrigrams)
+{
+    for (uint32_t trigram : fileTrigrams) {
+        trigrams[trigram].push_back(index);
+    }
+}
+
+/*
+ * name:        getTrigrams (member function)
+ * purpose:     Get every trigram with the files it is in
+ * arguments:   None
+ * returns:     reference to the map of trigram to sorted file indexes
+ * effects:     None
+ */
+const unordered_map<uint32_t, vector<int>> &HashTable::getTrigrams()
+{
+    return trigrams;
+}
+
+/*
+ * name:        findFold (member function)
+ * purpose:     Find the group of a word's case variants
+ * arguments:
+ *     key: the word, in any case
+ *     hash: hashWord(key)
+ * returns:     index of the group in folds, -1 if no variant is stored
+ * effects:     None
+ */
+int HashTable::findFold(string_view key, uint32_t hash)
+{
+    size_t mask = wordTable.size() - 1;
+    for (size_t pos = hash & mask, dist = 0; wordTable[pos].fold != 0;
+         pos = (pos + 1) & mask, dist++) {
+        wordSlot &slot = wordTable[pos];
+        if (((pos - slot.hash) & mask) < dist) {
+            return -1; //a stored group would have displaced this one
+        }
+        if (slot.hash == hash and
+            foldedEquals(folds[slot.fold - 1].variants[0]->key, key)) {
+            return slot.fold - 1;
+        }
+    }
+    return -1;
+}
+
+/*
+ * name:        addFold (member function)
+ * purpose:     Add an empty group for a word that has no variant stored
+ * arguments:
+ *     hash: hashWord of the word
+ * returns:     index of the new group, which the caller must give a
+ *              variant before the next lookup
+ * effects:     Resizes the slot table if the load factor exceeds 0.75
+ */
+int HashTable::addFold(uint32_t hash)
+{
+    folds.push_back({});
+    if (folds.size() > 0.75 * wordTable.size()) {
         wordResize();
-    }   
+    }
+    placeSlot({hash, (uint32_t)folds.size()});
+    return folds.size() - 1;
+}
+
+/*
+ * name:        mergeSorted (member function)
+ * purpose:     Add one file's lines to a sorted list without duplicates,
+ *              in one pass
+ * arguments:
+ *     values: the sorted list
+ *     index: index of the file in the file table
+ *     lines: line numbers to add, in increasing order
+ * returns:     Nothing
+ * effects:     Appends in the usual case; when another variant already
+ *              put lines of the same file at the end, that tail is merged
+ *              with the new lines in a scratch vector and put back
+ */
+void HashTable::mergeSorted(vector<pair<int, int>> &values, int index,
+                            const vector<int> &lines)
+{
+    vector<pair<int, int>> added;
+    added.reserve(lines.size());
+    for (int line : lines) {
+        added.push_back({index, line});
+    }
+    if (added.empty()) {
+        return;
+    }
+    auto tail = lower_bound(values.begin(), values.end(), added.front());
+    vector<pair<int, int>> merged;
+    merged.reserve((values.end() - tail) + added.size());
+    merge(tail, values.end(), added.begin(), added.end(),
+          back_inserter(merged));
+    merged.erase(unique(merged.begin(), merged.end()), merged.end());
+    values.erase(tail, values.end());
+    values.insert(values.end(), merged.begin(), merged.end());
+}
+
+/*
+ * name:        placeSlot (member function)
+ * purpose:     Robin hood insert of a slot: walking from the slot's home,
+ *              it takes the place of any slot closer to its own home and
+ *              carries that one on, which keeps probe runs short
+ * arguments:
+ *     slot: the slot to place
+ * returns:     Nothing
+ * effects:     Moves other slots along their runs
+ */
+void HashTable::placeSlot(wordSlot slot)
+{
+    size_t mask = wordTable.size() - 1;
+    size_t pos = slot.hash & mask;
+    for (size_t dist = 0; wordTable[pos].fold != 0; dist++) {
+        size_t theirs = (pos - wordTable[pos].hash) & mask;
+        if (theirs < dist) {
+            swap(slot, wordTable[pos]);
+            dist = theirs;
+        }
+        pos = (pos + 1) & mask;
+    }
+    wordTable[pos] = slot;
+}
+
+/*
+ * name:        storeKey (member function)
+ * purpose:     Copy a word's text into the key arena
+ * arguments:
+ *     key: the word
+ * returns:     string_view of the stored copy, valid for the table's life
+ * effects:     Starts a new arena block when the current one is full;
+ *              words longer than a quarter block get a block of their own
+ */
+string_view HashTable::storeKey(const string &key)
+{
+    if (key.size() > ARENA_BLOCK / 4) {
+        arena.emplace_back(new char[key.size()]);
+        key.copy(arena.back().get(), key.size());
+        //keep filling the previous block: swap the big one behind it
+        if (arena.size() > 1) {
+            swap(arena.back(), arena[arena.size() - 2]);
+            return string_view(arena[arena.size() - 2].get(), key.size());
+        }
+        arenaUsed = ARENA_BLOCK;
+        return string_view(arena.back().get(), key.size());
+    }
+    if (ARENA_BLOCK - arenaUsed < key.size()) {
+        arena.emplace_back(new char[ARENA_BLOCK]);
+        arenaUsed = 0;
+    }
+    char *start = arena.back().get() + arenaUsed;
+    key.copy(start, key.size());
+    arenaUsed += key.size();
+    return string_view(start, key.size());
 }
 
 /*
@@ -235,18 +486,22 @@ int HashTable:: getWordSize()
  * purpose:     Resize the hash table when the load factor exceeds 0.75
  * arguments:   None
  * returns:     Nothing
- * effects:     Rehashes the word table to a larger size
+ * effects:     Rehashes the word table to a larger size, and counts the
+ *              resize and its time
  */
 void HashTable:: wordResize() 
 {
-    vector<vector<wordVars>> temp(wordTable.size() * 2 + 1);
-    for (auto &bucket : wordTable) {
-        for (auto& node : bucket) {
-            size_t bucketIndex = hashWord(toLowerCase(node.key)) % temp.size();
-            temp[bucketIndex].push_back(node);
+    auto start = chrono::steady_clock::now();
+    vector<wordSlot> old = std::move(wordTable);
+    wordTable.assign(old.size() * 2, {0, 0});
+    for (wordSlot &slot : old) {
+        if (slot.fold != 0) {
+            placeSlot(slot); //stored hash: no word is rehashed or copied
         }
     }
-    wordTable = std::move(temp);
+    resizeCount++;
+    resizeNanos += chrono::duration_cast<chrono::nanoseconds>(
+                       chrono::steady_clock::now() - start).count();
 }
 
 /*
@@ -257,9 +512,9 @@ void HashTable:: wordResize()
  * returns:     size_t hash value of the key
  * effects:     None
  */
-size_t HashTable::hashWord(string key)
+size_t HashTable::hashWord(string_view key)
 {
-    return std::hash<string>{}(key);
+    return (uint32_t)foldedHash(key);
 }
 
 /*
@@ -271,7 +526,81 @@ size_t HashTable::hashWord(string key)
  */
 int HashTable:: getCapacity() 
 {
-    return wordTable.capacity();
+    return wordTable.size();
+}
+
+/*
+ * name:        getResizeCount (member function)
+ * purpose:     Get how many times the word table has grown
+ * arguments:   None
+ * returns:     int number of resizes since the table was made
+ * effects:     None
+ */
+int HashTable::getResizeCount()
+{
+    return resizeCount;
+}
+
+/*
+ * name:        getResizeNanos (member function)
+ * purpose:     Get the time spent growing the word table
+ * arguments:   None
+ * returns:     nanoseconds spent in every resize so far
+ * effects:     None
+ */
+uint64_t HashTable::getResizeNanos()
+{
+    return resizeNanos;
+}
+
+/*
+ * name:        getAllWords (member function)
+ * purpose:     Get every word stored in the hash table
+ * arguments:   None
+ * returns:     vector of pointers to each wordVars, in no particular order
+ * effects:     None. The pointers are valid until the next insertWord
+ */
+vector<wordVars *> HashTable:: getAllWords() 
+{
+    vector<wordVars *> all;
+    all.reserve(words.size());
+    for (wordVars &word : words) {
+        all.push_back(&word);
+    }
+    return all;
+}
+
+/*
+ * name:        getAllFolds (member function)
+ * purpose:     Get every group of case variants in the hash table
+ * arguments:   None
+ * returns:     vector of pointers to each foldVars, in no particular order
+ * effects:     None. The pointers are valid until the next insertion
+ */
+vector<foldVars *> HashTable:: getAllFolds() 
+{
+    vector<foldVars *> all;
+    all.reserve(folds.size());
+    for (foldVars &fold : folds) {
+        all.push_back(&fold);
+    }
+    return all;
+}
+
+/*
+ * name:        getFoldValues (member function)
+ * purpose:     Get the merged lines of a group of case variants
+ * arguments:
+ *     fold: the group
+ * returns:     reference to its sorted (file index, line number) pairs
+ * effects:     None
+ */
+const vector<pair<int, int>> &HashTable:: getFoldValues(foldVars &fold) 
+{
+    if (fold.variants.size() == 1) {
+        return fold.variants[0]->values;
+    }
+    return fold.values;
 }
 
 /*
@@ -285,4 +614,444 @@ string toLowerCase(string word)
 {
     transform(word.begin(), word.end(), word.begin(), ::tolower);
     return word;
-}
\ No newline at end of file
+}
+
+/*
+ * name:        foldedHash
+ * purpose:     64 bit FNV-1a hash of the lowercase form of a word, computed
+ *              without making a lowercase copy
+ * arguments:   key - the word
+ * returns:     the hash
+ * effects:     None
+ */
+uint64_t foldedHash(string_view key)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (char c : key) {
+        hash ^= (unsigned char)tolower((unsigned char)c);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/*
+ * name:        foldedEquals
+ * purpose:     Compare two words ignoring case
+ * arguments:   a, b - the words
+ * returns:     true if the words are equal ignoring case
+ * effects:     None
+ */
+bool foldedEquals(string_view a, string_view b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * name:        contentHash
+ * purpose:     64 bit hash of a file's contents, to tell whether a file whose
+ *              time changed was really edited. Mixes 8 bytes per step, so it
+ *              is much faster than a byte at a time hash on large files
+ * arguments:   data - the contents
+ * returns:     the hash
+ * effects:     None
+ */
+uint64_t contentHash(string_view data)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL ^ data.size();
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= data.size(); i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data.data() + i, sizeof(word));
+        hash = (hash ^ word) * 0x9e3779b97f4a7c15ULL;
+        hash ^= hash >> 32;
+    }
+    for (; i < data.size(); i++) {
+        hash = (hash ^ (unsigned char)data[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/*
+ * name:        stripNonAlphaNum
+ * purpose:     Remove leading and trailing non alphanumeric characters
+ * arguments:   input - the word to strip
+ * returns:     the stripped part of input, empty if it had no alphanumeric
+ *              characters
+ * effects:     None
+ */
+string_view stripNonAlphaNum(string_view input)
+{
+    size_t first = 0;
+    while (first < input.size() and not isalnum((unsigned char)input[first])) {
+        first++;
+    }
+    size_t last = input.size();
+    while (last > first and not isalnum((unsigned char)input[last - 1])) {
+        last--;
+    }
+    return input.substr(first, last - first);
+}
+
+/*
+ * name:        stripPattern
+ * purpose:     Remove leading and trailing characters that are neither
+ *              alphanumeric nor '*', as a word is stripped. A '?' at either
+ *              end is punctuation, as in what?, and only a '?' inside the
+ *              word is a wildcard
+ * arguments:   input - the pattern to strip
+ * returns:     the stripped part of input
+ * effects:     None
+ */
+string_view stripPattern(string_view input)
+{
+    auto kept = [](char c) {
+        return isalnum((unsigned char)c) or c == '*';
+    };
+    size_t first = 0;
+    while (first < input.size() and not kept(input[first])) {
+        first++;
+    }
+    size_t last = input.size();
+    while (last > first and not kept(input[last - 1])) {
+        last--;
+    }
+    return input.substr(first, last - first);
+}
+
+/*
+ * name:        isPattern
+ * purpose:     Tell whether a query word has wildcards in it
+ * arguments:   input - the query word
+ * returns:     true if it has a '*', or a '?' that stripPattern keeps
+ * effects:     None
+ */
+bool isPattern(string_view input)
+{
+    return stripPattern(input).find_first_of("*?") != string_view::npos;
+}
+
+/*
+ * name:        matchesPattern
+ * purpose:     Match a word against a wildcard pattern, where '*' stands for
+ *              any run of characters and '?' for any one character
+ * arguments:   pattern - the pattern
+ *              word - the word to match
+ *              caseSens - whether case must match exactly
+ * returns:     true if the whole word matches the whole pattern
+ * effects:     None. Only the last '*' is ever backtracked to, so this is
+ *              linear in the word for each '*'
+ */
+bool matchesPattern(string_view pattern, string_view word, bool caseSens)
+{
+    auto same = [caseSens](char a, char b) {
+        return caseSens ? a == b
+                        : tolower((unsigned char)a) == tolower((unsigned char)b);
+    };
+    size_t p = 0, w = 0;
+    size_t star = string_view::npos, resume = 0;
+    while (w < word.size()) {
+        if (p < pattern.size() and pattern[p] == '*') {
+            star = p++;
+            resume = w;
+        } else if (p < pattern.size() and
+                   (pattern[p] == '?' or same(pattern[p], word[w]))) {
+            p++;
+            w++;
+        } else if (star != string_view::npos) {
+            p = star + 1;
+            w = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() and pattern[p] == '*') {
+        p++;
+    }
+    return p == pattern.size();
+}
+
+/*
+ * name:        classifyScalar
+ * purpose:     Mark the whitespace and the alphanumeric bytes of some text,
+ *              a byte at a time
+ * arguments:   text - the text
+ *              from - the first byte to mark, a multiple of 64
+ *              spaces, alnums - bit i of word i / 64 is set for byte i
+ * returns:     Nothing
+ * effects:     Sets the words for bytes from on
+ */
+static void classifyScalar(string_view text, size_t from, uint64_t *spaces,
+                           uint64_t *alnums)
+{
+    //bit 0 for whitespace, bit 1 for alphanumeric, looked up per byte
+    static const vector<uint8_t> kinds = []() {
+        vector<uint8_t> table(256);
+        for (int c = 0; c < 256; c++) {
+            table[c] = (isspace(c) ? 1 : 0) | (isalnum(c) ? 2 : 0);
+        }
+        return table;
+    }();
+    for (size_t i = from; i < text.size(); i += 64) {
+        uint64_t space = 0, alnum = 0;
+        size_t end = min(text.size(), i + 64);
+        for (size_t j = i; j < end; j++) {
+            uint64_t kind = kinds[(unsigned char)text[j]];
+            space |= (kind & 1) << (j - i);
+            alnum |= (kind >> 1) << (j - i);
+        }
+        spaces[i >> 6] = space;
+        alnums[i >> 6] = alnum;
+    }
+}
+
+#if defined(__SSE2__)
+/*
+ * name:        classifySse2
+ * purpose:     Mark the whitespace and the alphanumeric bytes of some text,
+ *              16 bytes to a compare
+ * arguments:   as classifyScalar, from 0
+ * returns:     Nothing
+ * effects:     As classifyScalar. Bytes are compared as unsigned, so a byte
+ *              is in [lo, lo + span] when (byte - lo) == min(byte - lo, span)
+ */
+static void classifySse2(string_view text, uint64_t *spaces, uint64_t *alnums)
+{
+    auto within = [](__m128i bytes, char lo, char span) {
+        __m128i shifted = _mm_sub_epi8(bytes, _mm_set1_epi8(lo));
+        return _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(span)),
+                              shifted);
+    };
+    size_t i = 0;
+    for (; i + 64 <= text.size(); i += 64) {
+        uint64_t space = 0, alnum = 0;
+        for (int part = 0; part < 4; part++) {
+            __m128i bytes = _mm_loadu_si128(
+                (const __m128i *)(text.data() + i + part * 16));
+            __m128i isSpace = _mm_or_si128(
+                _mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')),
+                within(bytes, '\t', '\r' - '\t'));
+            __m128i lower = _mm_or_si128(bytes, _mm_set1_epi8(0x20));
+            __m128i isAlnum = _mm_or_si128(within(bytes, '0', 9),
+                                           within(lower, 'a', 25));
+            space |= (uint64_t)(uint16_t)_mm_movemask_epi8(isSpace)
+                     << (part * 16);
+            alnum |= (uint64_t)(uint16_t)_mm_movemask_epi8(isAlnum)
+                     << (part * 16);
+        }
+        spaces[i >> 6] = space;
+        alnums[i >> 6] = alnum;
+    }
+    classifyScalar(text, i, spaces, alnums);
+}
+#endif
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+/*
+ * name:        classifyAvx2
+ * purpose:     Mark the whitespace and the alphanumeric bytes of some text,
+ *              32 bytes to a compare
+ * arguments:   as classifyScalar, from 0
+ * returns:     Nothing
+ * effects:     As classifySse2. Built for AVX2 whatever the compiler flags,
+ *              and only called once the CPU is known to have it. within is
+ *              a function of its own, as a lambda would not be built for AVX2
+ */
+__attribute__((target("avx2")))
+static inline __m256i within(__m256i bytes, char lo, char span)
+{
+    __m256i shifted = _mm256_sub_epi8(bytes, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8(span)),
+                             shifted);
+}
+
+__attribute__((target("avx2")))
+static void classifyAvx2(string_view text, uint64_t *spaces, uint64_t *alnums)
+{
+    size_t i = 0;
+    for (; i + 64 <= text.size(); i += 64) {
+        uint64_t space = 0, alnum = 0;
+        for (int part = 0; part < 2; part++) {
+            __m256i bytes = _mm256_loadu_si256(
+                (const __m256i *)(text.data() + i + part * 32));
+            __m256i isSpace = _mm256_or_si256(
+                _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' ')),
+                within(bytes, '\t', '\r' - '\t'));
+            __m256i lower = _mm256_or_si256(bytes, _mm256_set1_epi8(0x20));
+            __m256i isAlnum = _mm256_or_si256(within(bytes, '0', 9),
+                                              within(lower, 'a', 25));
+            space |= (uint64_t)(uint32_t)_mm256_movemask_epi8(isSpace)
+                     << (part * 32);
+            alnum |= (uint64_t)(uint32_t)_mm256_movemask_epi8(isAlnum)
+                     << (part * 32);
+        }
+        spaces[i >> 6] = space;
+        alnums[i >> 6] = alnum;
+    }
+    classifyScalar(text, i, spaces, alnums);
+}
+#endif
+
+/*
+ * name:        classify
+ * purpose:     Mark the whitespace and the alphanumeric bytes of some text
+ *              with the widest compares the CPU has
+ * arguments:   as classifyScalar, from 0
+ * returns:     Nothing
+ * effects:     Checks the CPU the first time it is called
+ */
+static void classify(string_view text, uint64_t *spaces, uint64_t *alnums)
+{
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    if (avx2) {
+        classifyAvx2(text, spaces, alnums);
+        return;
+    }
+#endif
+#if defined(__SSE2__)
+    classifySse2(text, spaces, alnums);
+#else
+    classifyScalar(text, 0, spaces, alnums);
+#endif
+}
+
+/*
+ * name:        nextSet
+ * purpose:     Find the next set bit of a bitmap
+ * arguments:   bits - the bitmap, bit i of word i / 64 for byte i
+ *              from - where to start looking
+ *              size - how many bits the bitmap has
+ * returns:     the index of the first set bit at or after from, or size
+ * effects:     None
+ */
+static size_t nextSet(const uint64_t *bits, size_t from, size_t size)
+{
+    if (from >= size) {
+        return size;
+    }
+    size_t word = from >> 6;
+    uint64_t left = bits[word] & (~0ULL << (from & 63));
+    while (left == 0) {
+        if (++word << 6 >= size) {
+            return size;
+        }
+        left = bits[word];
+    }
+    return min(size, (word << 6) + __builtin_ctzll(left));
+}
+
+/*
+ * name:        lastSet
+ * purpose:     Find the last set bit of a bitmap before a place
+ * arguments:   bits - the bitmap
+ *              before - where to stop looking; a bit below it must be set
+ * returns:     the index of the last set bit below before
+ * effects:     None
+ */
+static size_t lastSet(const uint64_t *bits, size_t before)
+{
+    size_t word = (before - 1) >> 6;
+    uint64_t left = bits[word] & (~0ULL >> (63 - ((before - 1) & 63)));
+    while (left == 0) {
+        left = bits[--word];
+    }
+    return (word << 6) + 63 - __builtin_clzll(left);
+}
+
+/*
+ * name:        splitWordSpans
+ * purpose:     Find the words gerp indexes in some text: split on
+ *              whitespace, as >> does, then strip each piece, dropping the
+ *              ones left empty
+ * arguments:   text - the text, any number of lines, under 4GB
+ *              spans - filled with where each word is in text, in order
+ * returns:     Nothing
+ * effects:     None. Every byte is first marked as whitespace, alphanumeric
+ *              or neither in two bitmaps, in bulk, and the words are then
+ *              read off the bitmaps: a word runs from an alphanumeric byte
+ *              to the last alphanumeric byte before the next whitespace.
+ *              Nothing is copied; a newline is whitespace, so no word
+ *              crosses a line
+ */
+void splitWordSpans(string_view text, vector<WordSpan> &spans)
+{
+    //reused by each thread, so a file costs no allocation
+    static thread_local vector<uint64_t> spaces, alnums;
+    spans.clear();
+    size_t words = (text.size() + 63) / 64;
+    spaces.assign(words, 0);
+    alnums.assign(words, 0);
+    classify(text, spaces.data(), alnums.data());
+
+    size_t pos = 0;
+    while ((pos = nextSet(alnums.data(), pos, text.size())) < text.size()) {
+        size_t end = nextSet(spaces.data(), pos, text.size());
+        size_t last = lastSet(alnums.data(), end);
+        spans.push_back({(uint32_t)pos, (uint32_t)(last + 1 - pos)});
+        pos = end;
+    }
+}
+
+/*
+ * name:        splitWords
+ * purpose:     Split a line into the words gerp indexes, as splitWordSpans
+ * arguments:   line - the line, without its newline
+ *              words - filled with the words, in order, as views of line
+ * returns:     Nothing
+ * effects:     None
+ */
+void splitWords(string_view line, vector<string_view> &words)
+{
+    static thread_local vector<WordSpan> spans;
+    splitWordSpans(line, spans);
+    words.clear();
+    for (WordSpan span : spans) {
+        words.push_back(line.substr(span.offset, span.length));
+    }
+}
+
+/*
+ * name:        splitTrigrams
+ * purpose:     Get the distinct trigrams of some text: every three bytes in
+ *              a row within a line, lowercased and packed low byte first
+ * arguments:   text - the text
+ *              trigrams - filled with the trigrams, sorted, no duplicates
+ * returns:     Nothing
+ * effects:     None. Duplicates are caught with a bitmap per thread, so only
+ *              the distinct trigrams are sorted
+ */
+void splitTrigrams(string_view text, vector<uint32_t> &trigrams)
+{
+    //one bit per possible trigram, cleared again before returning
+    static thread_local vector<uint64_t> seen(1 << 18);
+    trigrams.clear();
+    uint32_t window = 0;
+    size_t run = 0; //bytes since the last newline
+    for (char c : text) {
+        if (c == '\n') {
+            run = 0;
+            continue;
+        }
+        window = (window >> 8) |
+                 ((uint32_t)(unsigned char)tolower((unsigned char)c) << 16);
+        if (++run >= 3) {
+            uint64_t bit = 1ULL << (window & 63);
+            if ((seen[window >> 6] & bit) == 0) {
+                seen[window >> 6] |= bit;
+                trigrams.push_back(window);
+            }
+        }
+    }
+    for (uint32_t trigram : trigrams) {
+        seen[trigram >> 6] = 0;
+    }
+    sort(trigrams.begin(), trigrams.end());
+}
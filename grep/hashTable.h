@@ -14,55 +14,145 @@
  *          words and being able to get those words with the corresponding
  *          file and line number.
  *
+ *          Words are grouped by their lowercase form: a group (foldVars)
+ *          holds every case variant of a word and the merged lines of all
+ *          of them, kept up to date as words are inserted. The groups are
+ *          found through a flat robin hood table of slots that keep each
+ *          group's hash, so a lookup in either case mode is one probe, and
+ *          resizing moves only slots, never rehashing a word or copying its
+ *          postings. Word text is kept in a block arena the keys point to.
+ *          A file's text is kept whole in one buffer, with the offset of
+ *          each line, rather than as one string per line. Alongside the
+ *          words, the table keeps which files hold each trigram (three
+ *          bytes in a row, lowercased), for substring and regex searches.
+ *
  */
 
 #ifndef __HASHTABLE_H
 #define __HASHTABLE_H
 #include <set>
 #include <vector>
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <list>
+#include <memory>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
 using namespace std;
 
 struct wordVars {
-    string key;
+    string_view key; //points into the owning table's key arena
+    vector<pair<int, int>> values;
+};
+
+//what a file looked like when it was read, to notice when it changes
+struct fileStamp {
+    int64_t mtime = 0;  //nanoseconds since the epoch
+    uint64_t size = 0;
+    uint64_t hash = 0;  //contentHash of the file
+};
+
+//where a word is in the text it was found in
+struct WordSpan {
+    uint32_t offset;
+    uint32_t length;
+};
+
+//all case variants of one word, and the lines any of them is on
+struct foldVars {
+    vector<wordVars *> variants;
+    //sorted without duplicates, but left empty while there is only one
+    //variant, whose own values are then the merged list
     vector<pair<int, int>> values;
 };
 
 string toLowerCase(string key);
+uint64_t foldedHash(string_view key);
+bool foldedEquals(string_view a, string_view b);
+uint64_t contentHash(string_view data);
+string_view stripNonAlphaNum(string_view input);
+string_view stripPattern(string_view input);
+bool isPattern(string_view input);
+bool matchesPattern(string_view pattern, string_view word, bool caseSens);
+void splitWordSpans(string_view text, vector<WordSpan> &spans);
+void splitWords(string_view line, vector<string_view> &words);
+void splitTrigrams(string_view text, vector<uint32_t> &trigrams);
 
 class HashTable 
 {
     public:
         HashTable();
         ~HashTable();
+        //keys point into the arena, so a table can move but not be copied
+        HashTable(const HashTable &other) = delete;
+        HashTable &operator=(const HashTable &other) = delete;
+        HashTable(HashTable &&other) = default;
+        HashTable &operator=(HashTable &&other) = default;
         string getFile(int key);
-        set<pair<int, int>> getWord(string key);
+        const vector<pair<int, int>> &getWord(string key);
         wordVars* getCaseSensWord(string key);
-        int insertFile(string &file, vector<string> &lines);
+        int insertFile(string &file, string &text,
+                       vector<uint32_t> &lineOffsets, fileStamp stamp);
         void insertWord(string key, int &index, int &value);
+        void insertWordLines(const string &key, int index,
+                             const vector<int> &lines);
+        void insertTrigrams(int index, const vector<uint32_t> &fileTrigrams);
+        const unordered_map<uint32_t, vector<int>> &getTrigrams();
         int getFileSize();
         int getWordSize();
         int getCapacity();
-        vector<string>& getLineContent(int key);
-        string getLine(int key, int lineNum);
+        int getResizeCount();
+        uint64_t getResizeNanos();
+        vector<wordVars *> getAllWords();
+        vector<foldVars *> getAllFolds();
+        const vector<pair<int, int>> &getFoldValues(foldVars &fold);
+        string_view getText(int key);
+        const vector<uint32_t> &getLineOffsets(int key);
+        int getLineCount(int key);
+        fileStamp getStamp(int key);
+        string_view getLine(int key, int lineNum);
         void insertSorted(vector<pair<int, int>>& values, 
                           const pair<int, int>& newPair);
     private:
         struct fileVars {
             string filePath;
-            vector<string> lineContent;
+            string text; //every line, each followed by '\n'
+            vector<uint32_t> lineOffsets; //start of each line, then the end
+            fileStamp stamp;
         };
         
-        int tableCap = 1001;
+        //hash is the low bits of the group's lowercase hash
+        struct wordSlot {
+            uint32_t hash;
+            uint32_t fold; //index into folds + 1, 0 if the slot is empty
+        };
+
+        static const size_t ARENA_BLOCK = 1 << 16;
+
+        int tableCap = 1024; //power of two
         vector<fileVars> fileTable;
-        //first elem in pair is key
-        vector<vector<wordVars>> wordTable; 
+        deque<wordVars> words; //a deque, so growing never moves a word
+        vector<foldVars> folds;
+        vector<wordSlot> wordTable; 
+        //trigram -> the files it is in, in increasing order
+        unordered_map<uint32_t, vector<int>> trigrams;
         size_t wordSize;
+        vector<unique_ptr<char[]>> arena;
+        size_t arenaUsed = ARENA_BLOCK;
+        int resizeCount = 0;
+        uint64_t resizeNanos = 0; //time spent resizing the word table
         void wordResize();
-        size_t hashWord(string key);
+        size_t hashWord(string_view key);
+        int findFold(string_view key, uint32_t hash);
+        int addFold(uint32_t hash);
+        void mergeSorted(vector<pair<int, int>> &values, int index,
+                         const vector<int> &lines);
+        void placeSlot(wordSlot slot);
+        string_view storeKey(const string &key);
 };
 
 #endif
\ No newline at end of file
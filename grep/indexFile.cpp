@@ -0,0 +1,1621 @@
+/*
+ *  indexFile.cpp
+ *  Harrison Tun and Jonah Pflaster
+ *
+ *  COMP 15 Proj Gerp
+ *
+ *  Purpose: This implementation file provides the function definitions for
+ *          the IndexFile class. An image is built once from the HashTable
+ *          after indexing, or viewed where an IndexSet mapped it. Lookups
+ *          hash the lowercase form of the query into the slot table, which
+ *          leads to the group of the query's case variants. A group keeps
+ *          the variants' postings merged into one sorted list, so a case
+ *          insensitive lookup is one probe plus a contiguous read; a case
+ *          sensitive one scans the group's few variants, which sit next to
+ *          each other in the sorted term table.
+ *
+ *          Image layout (little endian, each section 8 byte aligned):
+ *              Header
+ *              FileEntry[fileCount]
+ *              TermEntry[termCount]
+ *              Group[groupCount]
+ *              Slot[slotCount]
+ *              postings           (each term's list, then the merged
+ *                                  list of groups with several variants,
+ *                                  each sorted and compressed, then 8
+ *                                  zero bytes)
+ *              TrigramEntry[trigramCount]
+ *              trigram files      (each trigram's files as varint gaps)
+ *              uint32_t[...]      (each file's line offsets)
+ *              blob               (paths, terms, and file text, one '\n'
+ *                                  after every line)
+ *
+ *          merge writes the same layout from several images without
+ *          building a table: their term tables are already sorted, so the
+ *          terms are merged k ways through a heap, and each merged term's
+ *          postings are its lists in the images one after another, the
+ *          files renumbered. Nothing as large as the text or the postings
+ *          is held in memory at once.
+ *
+ */
+
+#include "indexFile.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <queue>
+#include <stdexcept>
+
+static const char INDEX_MAGIC[8] = {'G', 'E', 'R', 'P', 'I', 'D', 'X', '5'};
+
+/*
+ * Posting lists are cut into blocks of Cursor::BLOCK postings. A list of
+ * more than one block starts with a skip table of one entry per block: the
+ * block's first (file, line) and its byte offset after the table, as three
+ * uint32s. A block is its first file and line as varints, then, if it has
+ * more postings, the bit widths of the file and line fields and both fields
+ * bit packed, each at its own width: the file field is the change of file,
+ * the line field is the absolute line after a change of file and the gap to
+ * the previous line, less one, otherwise.
+ */
+
+/*
+ * name:        putVarint
+ * purpose:     Append a number 7 bits per byte, low bits first
+ * arguments:
+ *     out: where to append
+ *     value: the number
+ * returns:     Nothing
+ * effects:     None
+ */
+static void putVarint(string &out, uint32_t value)
+{
+    while (value >= 0x80) {
+        out += (char)(value | 0x80);
+        value >>= 7;
+    }
+    out += (char)value;
+}
+
+/*
+ * name:        getVarint
+ * purpose:     Read a number written by putVarint
+ * arguments:
+ *     p: the first byte, moved past the number
+ *     end: the end of the bytes it may take
+ * returns:     the number, cut short if it runs into end
+ * effects:     Never reads at or past end
+ */
+static uint32_t getVarint(const unsigned char *&p, const unsigned char *end)
+{
+    uint32_t value = 0;
+    for (int shift = 0; p < end; shift += 7) {
+        unsigned char byte = *p++;
+        value |= (uint32_t)(byte & 0x7f) << shift;
+        if (byte < 0x80 or shift >= 28) {
+            return value;
+        }
+    }
+    return value;
+}
+
+/*
+ * name:        bitWidth
+ * purpose:     Get the number of bits needed by the largest of some numbers
+ * arguments:
+ *     values: the numbers
+ *     n: how many there are
+ * returns:     0 to 32
+ * effects:     None
+ */
+static int bitWidth(const uint32_t *values, uint32_t n)
+{
+    uint32_t all = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        all |= values[i];
+    }
+    int bits = 0;
+    while (bits < 32 and (all >> bits) != 0) {
+        bits++;
+    }
+    return bits;
+}
+
+/*
+ * name:        packBits
+ * purpose:     Append numbers at a fixed bit width, low bits first
+ * arguments:
+ *     out: where to append
+ *     values: the numbers, each fitting in bits
+ *     n: how many there are
+ *     bits: the width
+ * returns:     Nothing
+ * effects:     Appends (n * bits + 7) / 8 bytes
+ */
+static void packBits(string &out, const uint32_t *values, uint32_t n,
+                     int bits)
+{
+    uint64_t buffer = 0;
+    int held = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        buffer |= (uint64_t)values[i] << held;
+        held += bits;
+        while (held >= 8) {
+            out += (char)buffer;
+            buffer >>= 8;
+            held -= 8;
+        }
+    }
+    if (held > 0) {
+        out += (char)buffer;
+    }
+}
+
+/*
+ * name:        unpackBits
+ * purpose:     Read numbers written by packBits at a width known when
+ *              compiling, so the shifts and mask are constants the compiler
+ *              can unroll and vectorize
+ * arguments:
+ *     in: the first packed byte; up to 7 bytes past the end are read, which
+ *         the padding after the posting section allows
+ *     n: how many numbers
+ *     out: where to put them
+ * returns:     Nothing
+ * effects:     None
+ */
+template <int BITS>
+static void unpackBits(const unsigned char *in, uint32_t n, uint32_t *out)
+{
+    const uint64_t mask = (BITS == 32) ? 0xffffffffull : (1ull << BITS) - 1;
+    for (uint32_t i = 0; i < n; i++) {
+        uint64_t bit = (uint64_t)i * BITS, word;
+        memcpy(&word, in + bit / 8, sizeof(word));
+        out[i] = (uint32_t)((word >> (bit % 8)) & mask);
+    }
+}
+
+/*
+ * name:        unpack
+ * purpose:     Read numbers written by packBits at any width
+ * arguments:
+ *     in: the first packed byte
+ *     n: how many numbers
+ *     bits: their width
+ *     out: where to put them
+ * returns:     Nothing
+ * effects:     None
+ */
+static void unpack(const unsigned char *in, uint32_t n, int bits,
+                   uint32_t *out)
+{
+    typedef void (*Unpacker)(const unsigned char *, uint32_t, uint32_t *);
+    static const Unpacker unpackers[33] = {
+        unpackBits<0>,  unpackBits<1>,  unpackBits<2>,  unpackBits<3>,
+        unpackBits<4>,  unpackBits<5>,  unpackBits<6>,  unpackBits<7>,
+        unpackBits<8>,  unpackBits<9>,  unpackBits<10>, unpackBits<11>,
+        unpackBits<12>, unpackBits<13>, unpackBits<14>, unpackBits<15>,
+        unpackBits<16>, unpackBits<17>, unpackBits<18>, unpackBits<19>,
+        unpackBits<20>, unpackBits<21>, unpackBits<22>, unpackBits<23>,
+        unpackBits<24>, unpackBits<25>, unpackBits<26>, unpackBits<27>,
+        unpackBits<28>, unpackBits<29>, unpackBits<30>, unpackBits<31>,
+        unpackBits<32>};
+    unpackers[bits > 32 ? 32 : bits](in, n, out);
+}
+
+/*
+ * name:        encodePostings
+ * purpose:     Append a sorted posting list in the block format above
+ * arguments:
+ *     out: where to append
+ *     values: the (file index, line number) pairs, sorted, no duplicates
+ * returns:     Nothing
+ * effects:     None
+ */
+static void encodePostings(string &out, const vector<pair<int, int>> &values)
+{
+    const uint32_t BLOCK = IndexFile::Cursor::BLOCK;
+    uint32_t count = values.size();
+    uint32_t blocks = (count + BLOCK - 1) / BLOCK;
+    size_t table = out.size();
+    if (blocks > 1) {
+        out.append(blocks * 3 * sizeof(uint32_t), '\0');
+    }
+    size_t data = out.size();
+    uint32_t fileField[BLOCK], lineField[BLOCK];
+    for (uint32_t b = 0; b < blocks; b++) {
+        uint32_t first = b * BLOCK, n = min(BLOCK, count - first);
+        uint32_t file = values[first].first, line = values[first].second;
+        if (blocks > 1) {
+            uint32_t entry[3] = {file, line, (uint32_t)(out.size() - data)};
+            memcpy(&out[table + b * sizeof(entry)], entry, sizeof(entry));
+        }
+        putVarint(out, file);
+        putVarint(out, line);
+        if (n == 1) {
+            continue;
+        }
+        for (uint32_t i = 1; i < n; i++) {
+            uint32_t nextFile = values[first + i].first;
+            uint32_t nextLine = values[first + i].second;
+            fileField[i - 1] = nextFile - file;
+            lineField[i - 1] = nextFile == file ? nextLine - line - 1
+                                                : nextLine;
+            file = nextFile;
+            line = nextLine;
+        }
+        int fileBits = bitWidth(fileField, n - 1);
+        int lineBits = bitWidth(lineField, n - 1);
+        out += (char)fileBits;
+        out += (char)lineBits;
+        packBits(out, fileField, n - 1, fileBits);
+        packBits(out, lineField, n - 1, lineBits);
+    }
+}
+
+/*
+ * Default constructor for IndexFile class, starts with no image
+ */
+IndexFile::IndexFile() {}
+
+/*
+ * Destructor for IndexFile class, frees the image if it was built
+ */
+IndexFile::~IndexFile()
+{
+    release();
+}
+
+/*
+ * name:        build (member function)
+ * purpose:     Freeze a finished HashTable into an image
+ * arguments:
+ *     table: the table built by indexing a directory
+ * returns:     Nothing
+ * effects:     Replaces any image already held
+ */
+void IndexFile::build(HashTable &table)
+{
+    vector<foldVars *> folds = table.getAllFolds();
+    vector<pair<string, foldVars *>> sorted;
+    sorted.reserve(folds.size());
+    for (foldVars *fold : folds) {
+        sorted.push_back({toLowerCase(string(fold->variants[0]->key)), fold});
+        sort(fold->variants.begin(), fold->variants.end(),
+             [](wordVars *a, wordVars *b) { return a->key < b->key; });
+    }
+    sort(sorted.begin(), sorted.end(),
+         [](const pair<string, foldVars *> &a,
+            const pair<string, foldVars *> &b) { return a.first < b.first; });
+
+    string blob;
+    size_t textBytes = 0;
+    for (int i = 0; i < table.getFileSize(); i++) {
+        textBytes += table.getFile(i).size() + table.getText(i).size();
+    }
+    blob.reserve(textBytes); //the text dwarfs the terms, grow it just once
+    vector<FileEntry> fileEntries(table.getFileSize());
+    vector<uint32_t> lineOffsets;
+    for (int i = 0; i < table.getFileSize(); i++) {
+        FileEntry &entry = fileEntries[i];
+        string path = table.getFile(i);
+        entry.pathOff = blob.size();
+        entry.pathLen = path.size();
+        blob += path;
+        //the table keeps text and offsets in the image's layout already
+        entry.textOff = blob.size();
+        entry.linesOff = lineOffsets.size();
+        entry.lineCount = table.getLineCount(i);
+        blob += table.getText(i);
+        const vector<uint32_t> &offsets = table.getLineOffsets(i);
+        lineOffsets.insert(lineOffsets.end(), offsets.begin(), offsets.end());
+        fileStamp stamp = table.getStamp(i);
+        entry.mtime = stamp.mtime;
+        entry.size = stamp.size;
+        entry.hash = stamp.hash;
+    }
+
+    vector<TermEntry> termEntries;
+    vector<Group> groupEntries(sorted.size());
+    string postingData;
+    for (size_t g = 0; g < sorted.size(); g++) {
+        foldVars *fold = sorted[g].second;
+        Group &group = groupEntries[g];
+        group.firstTerm = termEntries.size();
+        group.termCount = fold->variants.size();
+        group.unused = 0;
+        for (wordVars *word : fold->variants) {
+            TermEntry entry;
+            entry.keyOff = blob.size();
+            entry.keyLen = word->key.size();
+            blob += word->key;
+            entry.postingOff = postingData.size();
+            entry.postingCount = word->values.size();
+            encodePostings(postingData, word->values);
+            termEntries.push_back(entry);
+        }
+        if (group.termCount == 1) {
+            //one variant: its own list is already the merged list
+            group.postingOff = termEntries.back().postingOff;
+            group.postingCount = termEntries.back().postingCount;
+        } else {
+            const vector<pair<int, int>> &merged = table.getFoldValues(*fold);
+            group.postingOff = postingData.size();
+            group.postingCount = merged.size();
+            encodePostings(postingData, merged);
+        }
+    }
+    const unordered_map<uint32_t, vector<int>> &fileTrigrams =
+        table.getTrigrams();
+    vector<TrigramEntry> trigramEntries;
+    trigramEntries.reserve(fileTrigrams.size());
+    for (auto &trigram : fileTrigrams) {
+        trigramEntries.push_back({trigram.first,
+                                  (uint32_t)trigram.second.size(), 0});
+    }
+    sort(trigramEntries.begin(), trigramEntries.end(),
+         [](const TrigramEntry &a, const TrigramEntry &b) {
+             return a.trigram < b.trigram;
+         });
+    string trigramData;
+    for (TrigramEntry &entry : trigramEntries) {
+        entry.filesOff = trigramData.size();
+        int previous = 0;
+        for (int file : fileTrigrams.at(entry.trigram)) {
+            putVarint(trigramData, file - previous);
+            previous = file;
+        }
+    }
+
+    size_t slotCount = 16;
+    while (slotCount < 2 * sorted.size()) {
+        slotCount *= 2;
+    }
+    vector<Slot> slotTable(slotCount, {0, 0});
+    for (size_t g = 0; g < sorted.size(); g++) {
+        uint64_t hash = foldedHash(sorted[g].first);
+        size_t i = hash & (slotCount - 1);
+        while (slotTable[i].group != 0) {
+            i = (i + 1) & (slotCount - 1);
+        }
+        slotTable[i] = {(uint32_t)(hash >> 32), (uint32_t)(g + 1)};
+    }
+
+    string out(sizeof(Header), '\0');
+    auto section = [&out](const void *data, size_t bytes) {
+        out.resize((out.size() + 7) & ~(size_t)7, '\0');
+        uint64_t offset = out.size();
+        out.append((const char *)data, bytes);
+        return offset;
+    };
+    Header head;
+    memcpy(head.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    head.fileCount = fileEntries.size();
+    head.termCount = termEntries.size();
+    head.slotCount = slotCount;
+    head.groupCount = groupEntries.size();
+    head.trigramCount = trigramEntries.size();
+    head.unused = 0;
+    head.filesOff = section(fileEntries.data(),
+                            fileEntries.size() * sizeof(FileEntry));
+    head.termsOff = section(termEntries.data(),
+                            termEntries.size() * sizeof(TermEntry));
+    head.groupsOff = section(groupEntries.data(),
+                             groupEntries.size() * sizeof(Group));
+    head.slotsOff = section(slotTable.data(), slotCount * sizeof(Slot));
+    postingData.append(8, '\0'); //unpackBits reads whole words
+    head.postingsOff = section(postingData.data(), postingData.size());
+    head.trigramsOff = section(trigramEntries.data(),
+                               trigramEntries.size() * sizeof(TrigramEntry));
+    head.trigramFilesOff = section(trigramData.data(), trigramData.size());
+    head.lineOffsetsOff = section(lineOffsets.data(),
+                                  lineOffsets.size() * sizeof(uint32_t));
+    head.blobOff = section(blob.data(), blob.size());
+    head.imageSize = out.size();
+    memcpy(&out[0], &head, sizeof(Header));
+
+    release();
+    owned = std::move(out);
+    attach(owned.data(), owned.size());
+}
+
+/*
+ * name:        merge (static member function)
+ * purpose:     Write one image holding every file of several images, in
+ *              order, the same as build makes from one table of them all
+ * arguments:
+ *     parts: the images; each one's files are numbered after the last's
+ *     output: where the image goes, from its current position, which must
+ *             be a multiple of 8 bytes into the file
+ * returns:     Nothing
+ * effects:     Holds the merged dictionary and one posting list at a time.
+ *              The tables before the postings are written last, by seeking
+ *              back, and output is left at the end of the image. Throws a
+ *              runtime_error if output fails
+ */
+void IndexFile::merge(vector<IndexFile *> &parts, ofstream &output)
+{
+    //a term, group or trigram entry of one part
+    struct Source {
+        uint32_t part;
+        uint32_t index;
+    };
+    uint64_t base = output.tellp();
+    auto align = [](uint64_t offset) { return (offset + 7) & ~(uint64_t)7; };
+
+    vector<FileEntry> fileEntries;
+    vector<uint32_t> firstFile; //number of each part's first file
+    uint64_t blobBytes = 0, offsetCount = 0;
+    for (IndexFile *part : parts) {
+        firstFile.push_back(fileEntries.size());
+        for (int f = 0; f < part->getFileSize(); f++) {
+            FileEntry entry = part->files[f];
+            entry.pathOff = blobBytes;
+            entry.textOff = blobBytes + entry.pathLen;
+            entry.linesOff = offsetCount;
+            blobBytes = entry.textOff + part->getText(f).size();
+            offsetCount += entry.lineCount + 1;
+            fileEntries.push_back(entry);
+        }
+    }
+
+    //merge the groups by lowercase form, and each group's variants by key
+    vector<TermEntry> termEntries;
+    vector<Group> groupEntries;
+    vector<uint64_t> groupHashes;
+    vector<Source> termSources;   //the parts' terms, merged term by term
+    vector<uint32_t> termStarts;  //each merged term's first source
+    vector<Source> groupSources;  //the parts' groups, merged group by group
+    vector<uint32_t> groupStarts; //each merged group's first source
+    vector<uint32_t> next(parts.size(), 0); //each part's next group
+    vector<string> heads(parts.size());     //its lowercase form
+    auto later = [&heads](uint32_t a, uint32_t b) {
+        return heads[a] != heads[b] ? heads[a] > heads[b] : a > b;
+    };
+    priority_queue<uint32_t, vector<uint32_t>, decltype(later)> heap(later);
+    auto advance = [&](uint32_t p) {
+        IndexFile *part = parts[p];
+        for (; part->header != nullptr and
+               next[p] < part->header->groupCount; next[p]++) {
+            const Group &group = part->groups[next[p]];
+            if (group.termCount > 0 and
+                group.firstTerm + group.termCount <= part->header->termCount) {
+                heads[p] = toLowerCase(string(part->termKey(group.firstTerm)));
+                heap.push(p);
+                return;
+            }
+        }
+    };
+    for (uint32_t p = 0; p < parts.size(); p++) {
+        advance(p);
+    }
+    uint64_t keyBytes = 0;
+    vector<pair<string_view, Source>> variants;
+    while (not heap.empty()) {
+        string key = heads[heap.top()];
+        groupStarts.push_back(groupSources.size());
+        variants.clear();
+        while (not heap.empty() and heads[heap.top()] == key) {
+            uint32_t p = heap.top();
+            heap.pop();
+            const Group &group = parts[p]->groups[next[p]];
+            groupSources.push_back({p, next[p]});
+            for (uint32_t t = 0; t < group.termCount; t++) {
+                uint32_t term = group.firstTerm + t;
+                variants.push_back({parts[p]->termKey(term), {p, term}});
+            }
+            next[p]++;
+            advance(p);
+        }
+        //stable, so a term's sources stay in part order
+        stable_sort(variants.begin(), variants.end(),
+                    [](const pair<string_view, Source> &a,
+                       const pair<string_view, Source> &b) {
+                        return a.first < b.first;
+                    });
+        Group group;
+        group.firstTerm = termEntries.size();
+        group.unused = 0;
+        for (size_t v = 0; v < variants.size(); v++) {
+            if (v == 0 or variants[v].first != variants[v - 1].first) {
+                TermEntry term;
+                term.keyOff = blobBytes + keyBytes;
+                term.keyLen = variants[v].first.size();
+                keyBytes += term.keyLen;
+                termEntries.push_back(term);
+                termStarts.push_back(termSources.size());
+            }
+            termSources.push_back(variants[v].second);
+        }
+        group.termCount = termEntries.size() - group.firstTerm;
+        groupEntries.push_back(group);
+        groupHashes.push_back(foldedHash(key));
+    }
+    termStarts.push_back(termSources.size());
+    groupStarts.push_back(groupSources.size());
+
+    //each part's trigram table is sorted, so sorting by trigram alone,
+    //stably, keeps a trigram's files in order
+    vector<pair<uint32_t, Source>> trigramSources;
+    for (uint32_t p = 0; p < parts.size(); p++) {
+        if (parts[p]->header == nullptr) {
+            continue;
+        }
+        for (uint32_t i = 0; i < parts[p]->header->trigramCount; i++) {
+            trigramSources.push_back({parts[p]->trigrams[i].trigram, {p, i}});
+        }
+    }
+    stable_sort(trigramSources.begin(), trigramSources.end(),
+                [](const pair<uint32_t, Source> &a,
+                   const pair<uint32_t, Source> &b) {
+                    return a.first < b.first;
+                });
+
+    size_t slotCount = 16;
+    while (slotCount < 2 * groupEntries.size()) {
+        slotCount *= 2;
+    }
+    Header head;
+    memcpy(head.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    head.fileCount = fileEntries.size();
+    head.termCount = termEntries.size();
+    head.slotCount = slotCount;
+    head.groupCount = groupEntries.size();
+    head.unused = 0;
+    head.filesOff = align(sizeof(Header));
+    head.termsOff = align(head.filesOff +
+                          fileEntries.size() * sizeof(FileEntry));
+    head.groupsOff = align(head.termsOff +
+                           termEntries.size() * sizeof(TermEntry));
+    head.slotsOff = align(head.groupsOff +
+                          groupEntries.size() * sizeof(Group));
+    head.postingsOff = align(head.slotsOff + slotCount * sizeof(Slot));
+
+    //the sections are written in order, the tables as zeros for now
+    uint64_t at = 0;
+    string chunk;
+    auto write = [&](const char *data, size_t bytes) {
+        output.write(data, bytes);
+        at += bytes;
+    };
+    auto zeroTo = [&](uint64_t offset) {
+        chunk.assign(offset - at, '\0');
+        write(chunk.data(), chunk.size());
+    };
+    zeroTo(head.postingsOff);
+    vector<pair<int, int>> values;
+    auto gather = [&](Source source, uint64_t postingOff,
+                      uint32_t postingCount) {
+        Cursor cursor = parts[source.part]->openList(postingOff,
+                                                     postingCount);
+        for (; not cursor.done(); cursor.next()) {
+            pair<int, int> local = cursor.current();
+            values.push_back({local.first + (int)firstFile[source.part],
+                              local.second});
+        }
+    };
+    auto flushList = [&](uint64_t &postingOff, uint32_t &postingCount) {
+        postingOff = at - head.postingsOff;
+        postingCount = values.size();
+        chunk.clear();
+        encodePostings(chunk, values);
+        write(chunk.data(), chunk.size());
+        values.clear();
+    };
+    for (size_t g = 0; g < groupEntries.size(); g++) {
+        Group &group = groupEntries[g];
+        for (uint32_t t = group.firstTerm;
+             t < group.firstTerm + group.termCount; t++) {
+            for (uint32_t i = termStarts[t]; i < termStarts[t + 1]; i++) {
+                const TermEntry &from =
+                    parts[termSources[i].part]->terms[termSources[i].index];
+                gather(termSources[i], from.postingOff, from.postingCount);
+            }
+            flushList(termEntries[t].postingOff, termEntries[t].postingCount);
+        }
+        if (group.termCount == 1) {
+            group.postingOff = termEntries[group.firstTerm].postingOff;
+            group.postingCount = termEntries[group.firstTerm].postingCount;
+        } else {
+            for (uint32_t i = groupStarts[g]; i < groupStarts[g + 1]; i++) {
+                const Group &from =
+                    parts[groupSources[i].part]->groups[groupSources[i].index];
+                gather(groupSources[i], from.postingOff, from.postingCount);
+            }
+            uint64_t postingOff;
+            uint32_t postingCount;
+            flushList(postingOff, postingCount);
+            group.postingOff = postingOff;
+            group.postingCount = postingCount;
+        }
+    }
+    zeroTo(at + 8); //unpackBits reads whole words
+
+    vector<TrigramEntry> trigramEntries;
+    for (size_t i = 0; i < trigramSources.size(); i++) {
+        if (i == 0 or trigramSources[i].first != trigramSources[i - 1].first) {
+            trigramEntries.push_back({trigramSources[i].first, 0, 0});
+        }
+    }
+    head.trigramCount = trigramEntries.size();
+    head.trigramsOff = align(at);
+    head.trigramFilesOff = align(head.trigramsOff + trigramEntries.size() *
+                                                    sizeof(TrigramEntry));
+    zeroTo(head.trigramFilesOff);
+    size_t entry = 0;
+    int previous = 0;
+    for (size_t i = 0; i < trigramSources.size(); i++) {
+        if (i > 0 and trigramSources[i].first != trigramSources[i - 1].first) {
+            entry++;
+        }
+        TrigramEntry &to = trigramEntries[entry];
+        if (to.fileCount == 0) {
+            to.filesOff = at - head.trigramFilesOff;
+            previous = 0;
+        }
+        Source source = trigramSources[i].second;
+        IndexFile *part = parts[source.part];
+        const TrigramEntry &from = part->trigrams[source.index];
+        const unsigned char *p = (const unsigned char *)part->image +
+                                 part->header->trigramFilesOff + from.filesOff;
+        const unsigned char *end = (const unsigned char *)part->image +
+                                   part->header->lineOffsetsOff;
+        chunk.clear();
+        int file = 0;
+        for (uint32_t f = 0; f < from.fileCount; f++) {
+            file += getVarint(p, end);
+            int number = file + firstFile[source.part];
+            putVarint(chunk, number - previous);
+            previous = number;
+        }
+        to.fileCount += from.fileCount;
+        write(chunk.data(), chunk.size());
+    }
+
+    head.lineOffsetsOff = align(at);
+    zeroTo(head.lineOffsetsOff);
+    for (IndexFile *part : parts) {
+        for (int f = 0; f < part->getFileSize(); f++) {
+            const FileEntry &from = part->files[f];
+            const uint32_t *offsets = (const uint32_t *)(part->image +
+                                      part->header->lineOffsetsOff) +
+                                      from.linesOff;
+            write((const char *)offsets,
+                  (from.lineCount + 1) * sizeof(uint32_t));
+        }
+    }
+    head.blobOff = align(at);
+    zeroTo(head.blobOff);
+    for (IndexFile *part : parts) {
+        for (int f = 0; f < part->getFileSize(); f++) {
+            string_view path = part->getFile(f), text = part->getText(f);
+            write(path.data(), path.size());
+            write(text.data(), text.size());
+        }
+    }
+    for (size_t t = 0; t < termEntries.size(); t++) {
+        Source source = termSources[termStarts[t]];
+        string_view key = parts[source.part]->termKey(source.index);
+        write(key.data(), key.size());
+    }
+    head.imageSize = at;
+
+    vector<Slot> slotTable(slotCount, {0, 0});
+    for (size_t g = 0; g < groupHashes.size(); g++) {
+        size_t i = groupHashes[g] & (slotCount - 1);
+        while (slotTable[i].group != 0) {
+            i = (i + 1) & (slotCount - 1);
+        }
+        slotTable[i] = {(uint32_t)(groupHashes[g] >> 32), (uint32_t)(g + 1)};
+    }
+    auto writeAt = [&](uint64_t offset, const void *data, size_t bytes) {
+        output.seekp(base + offset);
+        output.write((const char *)data, bytes);
+    };
+    writeAt(0, &head, sizeof(Header));
+    writeAt(head.filesOff, fileEntries.data(),
+            fileEntries.size() * sizeof(FileEntry));
+    writeAt(head.termsOff, termEntries.data(),
+            termEntries.size() * sizeof(TermEntry));
+    writeAt(head.groupsOff, groupEntries.data(),
+            groupEntries.size() * sizeof(Group));
+    writeAt(head.slotsOff, slotTable.data(), slotCount * sizeof(Slot));
+    writeAt(head.trigramsOff, trigramEntries.data(),
+            trigramEntries.size() * sizeof(TrigramEntry));
+    output.seekp(base + head.imageSize);
+    if (not output) {
+        throw runtime_error("could not write merged index");
+    }
+}
+
+/*
+ * name:        view (member function)
+ * purpose:     Query an image held somewhere else, such as a mapped file
+ * arguments:
+ *     data: the first byte of the image, 8 byte aligned
+ *     size: number of bytes in the image
+ * returns:     Nothing
+ * effects:     Replaces any image already held. The data must outlive this
+ *              IndexFile. Throws a runtime_error if the image is damaged
+ */
+void IndexFile::view(const char *data, size_t size)
+{
+    release();
+    attach(data, size);
+}
+
+/*
+ * name:        getImage (member function)
+ * purpose:     Get the bytes of the image, to write it to disk
+ * arguments:   None
+ * returns:     string_view of the whole image, empty if there is none
+ * effects:     None
+ */
+string_view IndexFile::getImage()
+{
+    return string_view(image, imageSize);
+}
+
+/*
+ * name:        attach (member function)
+ * purpose:     Point the section pointers into an image after checking
+ *              that its header, sections and entries fit inside it
+ * arguments:
+ *     data: the first byte of the image
+ *     size: number of bytes in the image
+ * returns:     Nothing
+ * effects:     Throws a runtime_error if the image is damaged. Sections
+ *              must be in the order build writes them, 8 byte aligned, and
+ *              each table must end before the next section starts
+ */
+void IndexFile::attach(const char *data, size_t size)
+{
+    const Header *head = (const Header *)data;
+    if (size < sizeof(Header) or
+        memcmp(head->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 or
+        head->imageSize != size) {
+        throw runtime_error("damaged index");
+    }
+    const uint64_t starts[] = {sizeof(Header), head->filesOff,
+                               head->termsOff, head->groupsOff,
+                               head->slotsOff, head->postingsOff,
+                               head->trigramsOff, head->trigramFilesOff,
+                               head->lineOffsetsOff, head->blobOff, size};
+    for (size_t i = 1; i + 1 < sizeof(starts) / sizeof(starts[0]); i++) {
+        if (starts[i] % 8 != 0 or starts[i] < starts[i - 1] or
+            starts[i] > starts[i + 1]) {
+            throw runtime_error("damaged index");
+        }
+    }
+    auto fits = [](uint64_t offset, uint64_t count, uint64_t each,
+                   uint64_t limit) {
+        return count <= (limit - offset) / each;
+    };
+    if (not fits(head->filesOff, head->fileCount, sizeof(FileEntry),
+                 head->termsOff) or
+        not fits(head->termsOff, head->termCount, sizeof(TermEntry),
+                 head->groupsOff) or
+        not fits(head->groupsOff, head->groupCount, sizeof(Group),
+                 head->slotsOff) or
+        not fits(head->slotsOff, head->slotCount, sizeof(Slot),
+                 head->postingsOff) or
+        not fits(head->trigramsOff, head->trigramCount,
+                 sizeof(TrigramEntry), head->trigramFilesOff) or
+        head->trigramsOff - head->postingsOff < 8 or //unpackBits' padding
+        head->slotCount == 0 or
+        (head->slotCount & (head->slotCount - 1)) != 0) {
+        throw runtime_error("damaged index");
+    }
+    checkEntries(data, size);
+    image = data;
+    imageSize = size;
+    header = head;
+    files = (const FileEntry *)(data + head->filesOff);
+    terms = (const TermEntry *)(data + head->termsOff);
+    groups = (const Group *)(data + head->groupsOff);
+    slots = (const Slot *)(data + head->slotsOff);
+    postings = (const unsigned char *)(data + head->postingsOff);
+    trigrams = (const TrigramEntry *)(data + head->trigramsOff);
+}
+
+/*
+ * name:        checkEntries (member function)
+ * purpose:     Check that every entry of an image's tables stays inside the
+ *              sections it points into, so queries never read past them
+ * arguments:
+ *     data: the first byte of the image, whose sections attach checked
+ *     size: number of bytes in the image
+ * returns:     Nothing
+ * effects:     Throws a runtime_error if an entry is damaged. Reads every
+ *              table and line offset once and the last byte of each file,
+ *              but no other text and no posting list; Cursor checks the
+ *              postings as it decodes them
+ */
+void IndexFile::checkEntries(const char *data, size_t size)
+{
+    const Header *head = (const Header *)data;
+    uint64_t blobBytes = size - head->blobOff;
+    uint64_t offsetCount = (head->blobOff - head->lineOffsetsOff) /
+                           sizeof(uint32_t);
+    uint64_t postingBytes = head->trigramsOff - head->postingsOff - 8;
+    uint64_t trigramFileBytes = head->lineOffsetsOff - head->trigramFilesOff;
+    auto inBlob = [blobBytes](uint64_t offset, uint64_t length) {
+        return offset <= blobBytes and length <= blobBytes - offset;
+    };
+    //a list's first block, and its skip table if it has more than one
+    auto listFits = [postingBytes](uint64_t offset, uint32_t count) {
+        uint64_t blocks = (count + (uint64_t)Cursor::BLOCK - 1) /
+                          Cursor::BLOCK;
+        return count == 0 or
+               (offset < postingBytes and
+                (blocks == 1 or blocks < (postingBytes - offset) / 12));
+    };
+
+    const FileEntry *fileTable = (const FileEntry *)(data + head->filesOff);
+    const uint32_t *offsets = (const uint32_t *)(data + head->lineOffsetsOff);
+    for (uint32_t f = 0; f < head->fileCount; f++) {
+        const FileEntry &entry = fileTable[f];
+        if (not inBlob(entry.pathOff, entry.pathLen) or
+            entry.textOff > blobBytes or entry.linesOff > offsetCount or
+            entry.lineCount >= offsetCount - entry.linesOff) {
+            throw runtime_error("damaged index");
+        }
+        //every line ends in '\n', so line starts only go up
+        const uint32_t *lineStarts = offsets + entry.linesOff;
+        for (uint32_t l = 0; l < entry.lineCount; l++) {
+            if (lineStarts[l + 1] <= lineStarts[l]) {
+                throw runtime_error("damaged index");
+            }
+        }
+        //the text must end its last line, as searches stop on a '\n'
+        uint32_t textBytes = lineStarts[entry.lineCount];
+        if (not inBlob(entry.textOff, textBytes) or
+            (textBytes > 0 and
+             data[head->blobOff + entry.textOff + textBytes - 1] != '\n')) {
+            throw runtime_error("damaged index");
+        }
+    }
+    const TermEntry *termTable = (const TermEntry *)(data + head->termsOff);
+    for (uint32_t t = 0; t < head->termCount; t++) {
+        const TermEntry &entry = termTable[t];
+        if (not inBlob(entry.keyOff, entry.keyLen) or
+            not listFits(entry.postingOff, entry.postingCount)) {
+            throw runtime_error("damaged index");
+        }
+    }
+    const Group *groupTable = (const Group *)(data + head->groupsOff);
+    for (uint32_t g = 0; g < head->groupCount; g++) {
+        const Group &group = groupTable[g];
+        if (group.termCount == 0 or group.firstTerm > head->termCount or
+            group.termCount > head->termCount - group.firstTerm or
+            not listFits(group.postingOff, group.postingCount)) {
+            throw runtime_error("damaged index");
+        }
+    }
+    //a lookup probes until an empty slot, so there must be one
+    const Slot *slotTable = (const Slot *)(data + head->slotsOff);
+    bool anyEmpty = false;
+    for (uint32_t i = 0; i < head->slotCount; i++) {
+        if (slotTable[i].group > head->groupCount) {
+            throw runtime_error("damaged index");
+        }
+        anyEmpty = anyEmpty or slotTable[i].group == 0;
+    }
+    if (not anyEmpty) {
+        throw runtime_error("damaged index");
+    }
+    const TrigramEntry *trigramTable =
+        (const TrigramEntry *)(data + head->trigramsOff);
+    for (uint32_t i = 0; i < head->trigramCount; i++) {
+        const TrigramEntry &entry = trigramTable[i];
+        if (entry.filesOff > trigramFileBytes or
+            entry.fileCount > trigramFileBytes - entry.filesOff) {
+            throw runtime_error("damaged index");
+        }
+    }
+}
+
+/*
+ * name:        release (member function)
+ * purpose:     Drop the current image
+ * arguments:   None
+ * returns:     Nothing
+ * effects:     Frees a built image
+ */
+void IndexFile::release()
+{
+    owned.clear();
+    owned.shrink_to_fit();
+    image = nullptr;
+    imageSize = 0;
+    header = nullptr;
+}
+
+/*
+ * name:        isEmpty (member function)
+ * purpose:     Tell whether an image has been built or loaded
+ * arguments:   None
+ * returns:     true if there is no image
+ * effects:     None
+ */
+bool IndexFile::isEmpty()
+{
+    return image == nullptr;
+}
+
+/*
+ * name:        getFileSize (member function)
+ * purpose:     Get the number of files in the index
+ * arguments:   None
+ * returns:     int number of files
+ * effects:     None
+ */
+int IndexFile::getFileSize()
+{
+    return header == nullptr ? 0 : header->fileCount;
+}
+
+/*
+ * name:        getFile (member function)
+ * purpose:     Retrieve the path of a file
+ * arguments:
+ *     file: index of the file
+ * returns:     string_view of the path, valid while the image is held
+ * effects:     Throws a runtime_error if the file is not found
+ */
+string_view IndexFile::getFile(int file)
+{
+    if (file < 0 or file >= getFileSize()) {
+        throw runtime_error("key not found");
+    }
+    const FileEntry &entry = files[file];
+    return string_view(image + header->blobOff + entry.pathOff,
+                       entry.pathLen);
+}
+
+/*
+ * name:        getLine (member function)
+ * purpose:     Retrieve one line of a file
+ * arguments:
+ *     file: index of the file
+ *     lineNum: line number, counting from 0
+ * returns:     string_view of the line without its newline, valid while the
+ *              image is held
+ * effects:     Throws a runtime_error if the file or line is not found
+ */
+string_view IndexFile::getLine(int file, int lineNum)
+{
+    if (file < 0 or file >= getFileSize() or lineNum < 0 or
+        (uint32_t)lineNum >= files[file].lineCount) {
+        throw runtime_error("key not found");
+    }
+    const FileEntry &entry = files[file];
+    const uint32_t *offsets = (const uint32_t *)(image +
+                              header->lineOffsetsOff) + entry.linesOff;
+    const char *text = image + header->blobOff + entry.textOff;
+    return string_view(text + offsets[lineNum],
+                       offsets[lineNum + 1] - offsets[lineNum] - 1);
+}
+
+/*
+ * name:        getLineCount (member function)
+ * purpose:     Get the number of lines in a file
+ * arguments:
+ *     file: index of the file
+ * returns:     int number of lines
+ * effects:     Throws a runtime_error if the file is not found
+ */
+int IndexFile::getLineCount(int file)
+{
+    if (file < 0 or file >= getFileSize()) {
+        throw runtime_error("key not found");
+    }
+    return files[file].lineCount;
+}
+
+/*
+ * name:        getText (member function)
+ * purpose:     Retrieve the whole text of a file
+ * arguments:
+ *     file: index of the file
+ * returns:     string_view of every line, each followed by '\n', valid while
+ *              the image is held
+ * effects:     Throws a runtime_error if the file is not found
+ */
+string_view IndexFile::getText(int file)
+{
+    if (file < 0 or file >= getFileSize()) {
+        throw runtime_error("key not found");
+    }
+    const FileEntry &entry = files[file];
+    const uint32_t *offsets = (const uint32_t *)(image +
+                              header->lineOffsetsOff) + entry.linesOff;
+    return string_view(image + header->blobOff + entry.textOff,
+                       offsets[entry.lineCount]);
+}
+
+/*
+ * name:        getStamp (member function)
+ * purpose:     Retrieve what a file looked like when it was indexed
+ * arguments:
+ *     file: index of the file
+ * returns:     the file's fileStamp
+ * effects:     Throws a runtime_error if the file is not found
+ */
+fileStamp IndexFile::getStamp(int file)
+{
+    if (file < 0 or file >= getFileSize()) {
+        throw runtime_error("key not found");
+    }
+    const FileEntry &entry = files[file];
+    fileStamp stamp;
+    stamp.mtime = entry.mtime;
+    stamp.size = entry.size;
+    stamp.hash = entry.hash;
+    return stamp;
+}
+
+/*
+ * name:        getWord (member function)
+ * purpose:     Get every (file, line) a word appears on
+ * arguments:
+ *     key: the word to look up
+ *     caseSens: whether case must match exactly
+ * returns:     vector of (file index, line number) pairs, sorted and
+ *              without duplicates
+ * effects:     None
+ */
+vector<pair<int, int>> IndexFile::getWord(const string &key, bool caseSens)
+{
+    vector<pair<int, int>> result;
+    Cursor cursor = getCursor(key, caseSens);
+    result.reserve(cursor.size());
+    for (; not cursor.done(); cursor.next()) {
+        result.push_back(cursor.current());
+    }
+    return result;
+}
+
+/*
+ * name:        getCursor (member function)
+ * purpose:     Start walking the (file, line) pairs a word appears on
+ * arguments:
+ *     key: the word to look up
+ *     caseSens: whether case must match exactly
+ * returns:     a Cursor on the word's posting list, already done if the word
+ *              appears nowhere. Nothing is decoded until it is read
+ * effects:     None
+ */
+IndexFile::Cursor IndexFile::getCursor(const string &key, bool caseSens)
+{
+    int found = findGroup(key);
+    if (found < 0) {
+        return Cursor();
+    }
+    const Group &group = groups[found];
+    uint64_t first = group.postingOff;
+    uint32_t count = group.postingCount;
+    if (caseSens) {
+        count = 0;
+        for (uint32_t t = group.firstTerm;
+             t < group.firstTerm + group.termCount and
+             t < header->termCount; t++) {
+            if (termKey(t) == key) {
+                first = terms[t].postingOff;
+                count = terms[t].postingCount;
+                break;
+            }
+        }
+    }
+    return openList(first, count);
+}
+
+/*
+ * name:        getMatches (member function)
+ * purpose:     Start walking the lines of every word matching a wildcard
+ *              pattern, where '*' stands for any run of characters and '?'
+ *              for any one character
+ * arguments:
+ *     pattern: the pattern; the part before its first wildcard is a prefix
+ *              every match starts with
+ *     caseSens: whether case must match exactly
+ * returns:     a Cursor for each matching term, or for each matching group
+ *              of case variants when case is ignored. Their lines are not
+ *              merged and may overlap
+ * effects:     Only the run of terms starting with the prefix is read; a
+ *              pattern that starts with a wildcard reads every term
+ */
+vector<IndexFile::Cursor> IndexFile::getMatches(const string &pattern,
+                                                bool caseSens)
+{
+    vector<Cursor> found;
+    if (header == nullptr) {
+        return found;
+    }
+    string_view prefix(pattern);
+    prefix = prefix.substr(0, prefix.find_first_of("*?"));
+    for (uint32_t g = firstGroupFrom(prefix); g < header->groupCount; g++) {
+        const Group &group = groups[g];
+        if (group.termCount == 0 or group.firstTerm >= header->termCount) {
+            continue;
+        }
+        string_view key = termKey(group.firstTerm);
+        if (key.size() < prefix.size() or
+            not foldedEquals(key.substr(0, prefix.size()), prefix)) {
+            break; //past the run of the prefix
+        }
+        if (not caseSens) {
+            if (matchesPattern(pattern, key, false)) {
+                found.push_back(openList(group.postingOff,
+                                         group.postingCount));
+            }
+            continue;
+        }
+        for (uint32_t t = group.firstTerm;
+             t < group.firstTerm + group.termCount and
+             t < header->termCount; t++) {
+            if (matchesPattern(pattern, termKey(t), true)) {
+                found.push_back(openList(terms[t].postingOff,
+                                         terms[t].postingCount));
+            }
+        }
+    }
+    return found;
+}
+
+/*
+ * name:        done (Cursor member function)
+ * purpose:     Tell whether the cursor has passed the last posting
+ * arguments:   None
+ * returns:     true if there is no current posting
+ * effects:     None
+ */
+bool IndexFile::Cursor::done()
+{
+    return pos >= held;
+}
+
+/*
+ * name:        current (Cursor member function)
+ * purpose:     Get the posting the cursor is on
+ * arguments:   None
+ * returns:     its (file index, line number); only valid if not done
+ * effects:     None
+ */
+pair<int, int> IndexFile::Cursor::current()
+{
+    return {(int)files[pos], (int)lines[pos]};
+}
+
+/*
+ * name:        next (Cursor member function)
+ * purpose:     Move to the next posting
+ * arguments:   None
+ * returns:     Nothing
+ * effects:     Decodes the next block when the current one is used up
+ */
+void IndexFile::Cursor::next()
+{
+    if (++pos == held and block + 1 < blocks) {
+        decode(block + 1);
+    }
+}
+
+/*
+ * name:        seek (Cursor member function)
+ * purpose:     Move to the first posting at or after a (file, line)
+ * arguments:
+ *     target: the (file index, line number) to reach
+ * returns:     Nothing
+ * effects:     Never moves backwards. Blocks that end before the target are
+ *              skipped with the skip table, without being decoded
+ */
+void IndexFile::Cursor::seek(pair<int, int> target)
+{
+    if (done() or current() >= target) {
+        return;
+    }
+    pair<uint32_t, uint32_t> goal = {(uint32_t)target.first,
+                                     (uint32_t)target.second};
+    //the last block starting at or before the target holds it or ends
+    //right before the block that does
+    uint32_t low = block, high = blocks - 1;
+    while (low < high) {
+        uint32_t mid = low + (high - low + 1) / 2;
+        if (blockStart(mid) <= goal) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+    if (low != block) {
+        decode(low);
+    }
+    while (not done() and current() < target) {
+        next();
+    }
+}
+
+/*
+ * name:        size (Cursor member function)
+ * purpose:     Get the length of the whole posting list
+ * arguments:   None
+ * returns:     number of postings, read or not
+ * effects:     None
+ */
+uint32_t IndexFile::Cursor::size()
+{
+    return count;
+}
+
+/*
+ * name:        blockStart (Cursor member function)
+ * purpose:     Get the first posting of a block from the skip table
+ * arguments:
+ *     b: the block, which must not be the only one
+ * returns:     its (file index, line number)
+ * effects:     None
+ */
+pair<uint32_t, uint32_t> IndexFile::Cursor::blockStart(uint32_t b)
+{
+    uint32_t entry[3];
+    memcpy(entry, list + b * sizeof(entry), sizeof(entry));
+    return {entry[0], entry[1]};
+}
+
+/*
+ * name:        decode (Cursor member function)
+ * purpose:     Decode a block into files and lines and go to its start
+ * arguments:
+ *     b: the block
+ * returns:     Nothing
+ * effects:     Replaces the block held. A damaged list ends early: the
+ *              block is cut before the first posting that runs past the
+ *              list's bytes or names a file or line the index doesn't have,
+ *              and no block after it is decoded
+ */
+void IndexFile::Cursor::decode(uint32_t b)
+{
+    block = b;
+    pos = 0;
+    held = 0;
+    const unsigned char *p = list;
+    if (blocks > 1) {
+        uint32_t entry[3];
+        memcpy(entry, list + b * sizeof(entry), sizeof(entry));
+        p = list + blocks * sizeof(entry);
+        if (entry[2] >= (size_t)(end - p)) {
+            blocks = b + 1;
+            return;
+        }
+        p += entry[2];
+    }
+    uint32_t n = min((uint32_t)BLOCK, count - b * BLOCK);
+    uint32_t file = getVarint(p, end), line = getVarint(p, end);
+    files[0] = file;
+    lines[0] = line;
+    if (n > 1) {
+        int fileBits = p < end ? *p++ : 0xff;
+        int lineBits = p < end ? *p++ : 0xff;
+        size_t fileBytes = ((n - 1) * fileBits + 7) / 8;
+        size_t lineBytes = ((n - 1) * lineBits + 7) / 8;
+        if (fileBits > 32 or lineBits > 32 or
+            fileBytes + lineBytes > (size_t)(end - p)) {
+            blocks = b + 1;
+            return;
+        }
+        unpack(p, n - 1, fileBits, files + 1);
+        unpack(p + fileBytes, n - 1, lineBits, lines + 1);
+    }
+    const FileEntry *fileTable = owner->files;
+    uint32_t fileCount = owner->header->fileCount;
+    for (uint32_t i = 0; i < n; i++) {
+        if (i > 0) {
+            if (files[i] != 0) {
+                file += files[i];
+                line = lines[i];
+            } else {
+                line += lines[i] + 1;
+            }
+            files[i] = file;
+            lines[i] = line;
+        }
+        if (file >= fileCount or line >= fileTable[file].lineCount) {
+            blocks = b + 1;
+            return;
+        }
+        held = i + 1;
+    }
+}
+
+/*
+ * name:        termKey (member function)
+ * purpose:     Get the text of a term
+ * arguments:
+ *     term: index into the sorted term table
+ * returns:     string_view of the term
+ * effects:     None
+ */
+string_view IndexFile::termKey(int term)
+{
+    return string_view(image + header->blobOff + terms[term].keyOff,
+                       terms[term].keyLen);
+}
+
+/*
+ * name:        getFuzzy (member function)
+ * purpose:     Start walking the lines of every word within some edits of a
+ *              given word, ignoring case
+ * arguments:
+ *     word: the word, in any case
+ *     distance: the most characters that may be inserted, removed or
+ *               changed to turn a word into it
+ * returns:     a Cursor for each matching group of case variants. Their
+ *              lines are not merged and may overlap
+ * effects:     Walks the sorted groups keeping a row of edit distances per
+ *              character of the current term. A term's rows are reused for
+ *              the prefix it shares with the one before, and once a prefix
+ *              is more than distance edits from every prefix of the word,
+ *              all the terms starting with it are jumped over by binary
+ *              search, so only a thin band of the dictionary is read
+ */
+vector<IndexFile::Cursor> IndexFile::getFuzzy(const string &word,
+                                              int distance)
+{
+    vector<Cursor> found;
+    if (header == nullptr) {
+        return found;
+    }
+    string target = toLowerCase(word);
+    size_t width = target.size() + 1;
+    //rows[d * width + j]: edits between the first d characters of path and
+    //the first j of target
+    vector<int> rows(width);
+    for (size_t j = 0; j < width; j++) {
+        rows[j] = j;
+    }
+    string path; //the lowercase characters rows has been worked out for
+    uint32_t g = 0;
+    while (g < header->groupCount) {
+        const Group &group = groups[g];
+        if (group.termCount == 0 or group.firstTerm >= header->termCount) {
+            g++;
+            continue;
+        }
+        string_view key = termKey(group.firstTerm);
+        size_t shared = 0;
+        while (shared < path.size() and shared < key.size() and
+               path[shared] == (char)tolower((unsigned char)key[shared])) {
+            shared++;
+        }
+        path.resize(shared);
+        bool hopeless = false;
+        while (path.size() < key.size() and not hopeless) {
+            char c = tolower((unsigned char)key[path.size()]);
+            path += c;
+            rows.resize((path.size() + 1) * width);
+            const int *above = &rows[(path.size() - 1) * width];
+            int *row = &rows[path.size() * width];
+            row[0] = path.size();
+            int best = row[0];
+            for (size_t j = 1; j < width; j++) {
+                row[j] = min({above[j] + 1, row[j - 1] + 1,
+                              above[j - 1] + (target[j - 1] != c)});
+                best = min(best, row[j]);
+            }
+            hopeless = best > distance;
+        }
+        if (hopeless) {
+            //no word starting so is close; always move on, even if a
+            //damaged table is out of order
+            g = max(g + 1, firstGroupFrom(path, true));
+            continue;
+        }
+        if (rows[key.size() * width + target.size()] <= distance) {
+            found.push_back(openList(group.postingOff, group.postingCount));
+        }
+        g++;
+    }
+    return found;
+}
+
+/*
+ * name:        getTrigramFiles (member function)
+ * purpose:     Get the files a trigram appears in
+ * arguments:
+ *     trigram: three bytes, lowercased and packed as splitTrigrams does
+ * returns:     the file numbers, sorted, empty if no file has the trigram
+ * effects:     None
+ */
+vector<int> IndexFile::getTrigramFiles(uint32_t trigram)
+{
+    vector<int> found;
+    if (header == nullptr) {
+        return found;
+    }
+    const TrigramEntry *end = trigrams + header->trigramCount;
+    const TrigramEntry *entry = lower_bound(
+        trigrams, end, trigram, [](const TrigramEntry &a, uint32_t b) {
+            return a.trigram < b;
+        });
+    if (entry == end or entry->trigram != trigram) {
+        return found;
+    }
+    const unsigned char *p = (const unsigned char *)image +
+                             header->trigramFilesOff + entry->filesOff;
+    const unsigned char *filesEnd = (const unsigned char *)image +
+                                    header->lineOffsetsOff;
+    found.reserve(entry->fileCount);
+    uint32_t file = 0;
+    for (uint32_t i = 0; i < entry->fileCount; i++) {
+        file += getVarint(p, filesEnd);
+        if (file >= header->fileCount) {
+            break; //damaged, the files are sorted and in the index
+        }
+        found.push_back(file);
+    }
+    return found;
+}
+
+/*
+ * name:        addStats (member function)
+ * purpose:     Add this image's counts and sizes to a report
+ * arguments:
+ *     stats: the report, perhaps already holding other segments
+ * returns:     Nothing
+ * effects:     Adds this image's largest groups to stats.largest; the
+ *              caller combines and trims them. Rehashes every group's first
+ *              term to find how far its slot is from where it hashed to
+ */
+void IndexFile::addStats(IndexStats &stats)
+{
+    if (header == nullptr) {
+        return;
+    }
+    stats.segments++;
+    stats.files += header->fileCount;
+    stats.terms += header->termCount;
+    stats.groups += header->groupCount;
+    stats.trigrams += header->trigramCount;
+    stats.slots += header->slotCount;
+    uint64_t pathBytes = 0, textBytes = 0, keyBytes = 0;
+    for (uint32_t f = 0; f < header->fileCount; f++) {
+        stats.lines += files[f].lineCount;
+        pathBytes += files[f].pathLen;
+        textBytes += getText(f).size();
+    }
+    for (uint32_t t = 0; t < header->termCount; t++) {
+        stats.postings += terms[t].postingCount;
+        keyBytes += terms[t].keyLen;
+    }
+    uint32_t mask = header->slotCount - 1;
+    for (uint32_t i = 0; i < header->slotCount; i++) {
+        if (slots[i].group == 0 or slots[i].group > header->groupCount) {
+            continue;
+        }
+        const Group &group = groups[slots[i].group - 1];
+        uint64_t home = foldedHash(termKey(group.firstTerm)) & mask;
+        uint64_t probe = ((i - home) & mask) + 1;
+        stats.probes += probe;
+        stats.longestProbe = max(stats.longestProbe, probe);
+    }
+
+    //sections are laid out in this order, so each ends where the next starts
+    stats.pathTableBytes += header->termsOff - header->filesOff + pathBytes;
+    stats.wordTableBytes += header->postingsOff - header->termsOff + keyBytes;
+    stats.postingBytes += header->trigramsOff - header->postingsOff;
+    stats.trigramBytes += header->lineOffsetsOff - header->trigramsOff;
+    stats.lineStoreBytes += header->blobOff - header->lineOffsetsOff +
+                            textBytes;
+    stats.imageBytes += imageSize;
+
+    vector<uint32_t> order(header->groupCount);
+    for (uint32_t g = 0; g < header->groupCount; g++) {
+        order[g] = g;
+    }
+    size_t kept = min(order.size(), (size_t)IndexStats::LARGEST);
+    partial_sort(order.begin(), order.begin() + kept, order.end(),
+                 [this](uint32_t a, uint32_t b) {
+                     return groups[a].postingCount > groups[b].postingCount;
+                 });
+    for (size_t i = 0; i < kept; i++) {
+        const Group &group = groups[order[i]];
+        stats.largest.push_back(
+            {group.postingCount,
+             toLowerCase(string(termKey(group.firstTerm)))});
+    }
+}
+
+/*
+ * name:        firstGroupFrom (member function)
+ * purpose:     Binary search the groups for where a prefix would go
+ * arguments:
+ *     prefix: the prefix, in any case
+ *     pastPrefix: whether to skip the groups starting with the prefix too
+ * returns:     index of the first group whose lowercase form is not before
+ *              the prefix's, which is the first group starting with it if
+ *              any does; or, with pastPrefix, the first group after all of
+ *              those
+ * effects:     None. Compares bytes as the build's sort does, unsigned and
+ *              lowercased
+ */
+uint32_t IndexFile::firstGroupFrom(string_view prefix, bool pastPrefix)
+{
+    auto before = [prefix, pastPrefix](string_view key) {
+        for (size_t i = 0; i < key.size() and i < prefix.size(); i++) {
+            unsigned char a = tolower((unsigned char)key[i]);
+            unsigned char b = tolower((unsigned char)prefix[i]);
+            if (a != b) {
+                return a < b;
+            }
+        }
+        return key.size() < prefix.size() or pastPrefix;
+    };
+    uint32_t low = 0, high = header->groupCount;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        const Group &group = groups[mid];
+        if (group.firstTerm < header->termCount and
+            before(termKey(group.firstTerm))) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/*
+ * name:        openList (member function)
+ * purpose:     Start a Cursor on one posting list
+ * arguments:
+ *     postingOff: byte offset of the list in the posting section
+ *     postingCount: the number of postings in it
+ * returns:     a Cursor on its first posting, done if it is empty
+ * effects:     Decodes the first block
+ */
+IndexFile::Cursor IndexFile::openList(uint64_t postingOff,
+                                      uint32_t postingCount)
+{
+    Cursor cursor;
+    cursor.owner = this;
+    cursor.list = postings + postingOff;
+    cursor.end = postings + (header->trigramsOff - header->postingsOff - 8);
+    cursor.count = postingCount;
+    cursor.blocks = (postingCount + Cursor::BLOCK - 1) / Cursor::BLOCK;
+    if (postingCount > 0) {
+        cursor.decode(0);
+    }
+    return cursor;
+}
+
+/*
+ * name:        findGroup (member function)
+ * purpose:     Find the group of a word's case variants
+ * arguments:
+ *     key: the word, in any case
+ * returns:     index of the group whose lowercase form matches the word's,
+ *              or -1 if there is none
+ * effects:     None
+ */
+int IndexFile::findGroup(const string &key)
+{
+    if (header == nullptr or header->groupCount == 0) {
+        return -1;
+    }
+    uint64_t hash = foldedHash(key);
+    uint32_t mask = header->slotCount - 1;
+    for (uint32_t i = hash & mask; slots[i].group != 0; i = (i + 1) & mask) {
+        if (slots[i].hash != (uint32_t)(hash >> 32) or
+            slots[i].group > header->groupCount) {
+            continue;
+        }
+        const Group &group = groups[slots[i].group - 1];
+        if (group.termCount > 0 and
+            group.firstTerm < header->termCount and
+            foldedEquals(termKey(group.firstTerm), key)) {
+            return slots[i].group - 1;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,196 @@
+/*
+ *  indexFile.h
+ *  Harrison Tun and Jonah Pflaster
+ *  {htun01}         {jpflas01}
+ *
+ *  COMP 15 Proj Gerp
+ *
+ *  Purpose: This header file defines the interface for the IndexFile class,
+ *          which holds a finished gerp index as one flat image: the file
+ *          table, every file's lines with their offsets, the term
+ *          dictionary, an open addressing table over the lowercase terms and
+ *          the posting lists, with one pre-merged list per group of case
+ *          variants for case insensitive queries. Posting lists are
+ *          compressed in blocks and read through a Cursor that decodes one
+ *          block at a time and can skip whole blocks. The image has no
+ *          pointers in it, so it can be written to disk as is and later
+ *          mmap'd and queried in place, which makes startup from a saved
+ *          index nearly instant. An IndexSet keeps one or more images as
+ *          the segments of an index. The term table is sorted by lowercase
+ *          form, so it is also an ordered dictionary: the terms starting
+ *          with a prefix are one run of it, found by binary search, which is
+ *          how prefix, wildcard and fuzzy queries are answered. A trigram table
+ *          lists the files holding each three lowercase bytes in a row, to
+ *          narrow a substring or regex search to the files that can match.
+ *          Images can also be merged into one straight to a file, a list at
+ *          a time, for builds too big to hold in memory.
+ *
+ */
+
+#ifndef __INDEXFILE_H
+#define __INDEXFILE_H
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "hashTable.h"
+using namespace std;
+
+//what an index holds and the bytes each part of it takes, added up over
+//the segments of an IndexSet
+struct IndexStats {
+    //how many of the largest posting lists are kept
+    static const size_t LARGEST = 10;
+
+    uint64_t segments = 0;
+    uint64_t files = 0;
+    uint64_t deadFiles = 0;
+    uint64_t lines = 0;
+    uint64_t terms = 0;         //distinct words, case kept
+    uint64_t groups = 0;        //distinct words, case ignored
+    uint64_t postings = 0;      //(file, line) entries over every term
+    uint64_t trigrams = 0;
+    uint64_t slots = 0;
+    uint64_t probes = 0;        //slots looked at to find every group once
+    uint64_t longestProbe = 0;
+    //bytes of each part of the images
+    uint64_t pathTableBytes = 0;  //file entries and paths
+    uint64_t lineStoreBytes = 0;  //file text and line offsets
+    uint64_t wordTableBytes = 0;  //terms, their text, groups and slots
+    uint64_t postingBytes = 0;
+    uint64_t trigramBytes = 0;    //trigram entries and their file lists
+    uint64_t imageBytes = 0;
+    //the groups with the most postings, most first: postings, lowercase word
+    vector<pair<uint64_t, string>> largest;
+};
+
+class IndexFile
+{
+    public:
+        //walks one posting list in order, decoding a block at a time
+        class Cursor {
+            public:
+                static const uint32_t BLOCK = 128; //postings per block
+                bool done();
+                pair<int, int> current();
+                void next();
+                void seek(pair<int, int> target);
+                uint32_t size();
+            private:
+                friend class IndexFile;
+                const IndexFile *owner = nullptr; //for its file table
+                const unsigned char *list = nullptr;
+                const unsigned char *end = nullptr; //of the posting data
+                uint32_t count = 0;
+                uint32_t blocks = 0;
+                uint32_t block = 0;   //the block held in files and lines
+                uint32_t pos = 0;     //current posting within the block
+                uint32_t held = 0;    //postings in the block
+                uint32_t files[BLOCK];
+                uint32_t lines[BLOCK];
+                void decode(uint32_t b);
+                pair<uint32_t, uint32_t> blockStart(uint32_t b);
+        };
+
+        IndexFile();
+        ~IndexFile();
+        //the section pointers point into the image, so no copies
+        IndexFile(const IndexFile &other) = delete;
+        IndexFile &operator=(const IndexFile &other) = delete;
+        void build(HashTable &table);
+        static void merge(vector<IndexFile *> &parts, ofstream &output);
+        void view(const char *data, size_t size);
+        string_view getImage();
+        bool isEmpty();
+        int getFileSize();
+        string_view getFile(int file);
+        string_view getLine(int file, int lineNum);
+        int getLineCount(int file);
+        string_view getText(int file);
+        fileStamp getStamp(int file);
+        vector<pair<int, int>> getWord(const string &key, bool caseSens);
+        Cursor getCursor(const string &key, bool caseSens);
+        vector<Cursor> getMatches(const string &pattern, bool caseSens);
+        vector<Cursor> getFuzzy(const string &word, int distance);
+        vector<int> getTrigramFiles(uint32_t trigram);
+        void addStats(IndexStats &stats);
+    private:
+        //every section starts on an 8 byte boundary of the image
+        struct Header {
+            char magic[8];
+            uint32_t fileCount;
+            uint32_t termCount;
+            uint32_t slotCount;   //power of two
+            uint32_t groupCount;
+            uint32_t trigramCount;
+            uint32_t unused;
+            uint64_t filesOff;
+            uint64_t termsOff;
+            uint64_t groupsOff;
+            uint64_t slotsOff;
+            uint64_t postingsOff;
+            uint64_t trigramsOff;
+            uint64_t trigramFilesOff;
+            uint64_t lineOffsetsOff;
+            uint64_t blobOff;
+            uint64_t imageSize;
+        };
+        struct FileEntry {
+            uint64_t pathOff;     //into the blob
+            uint64_t textOff;     //into the blob, start of line 0
+            uint64_t linesOff;    //lineCount + 1 uint32 offsets from textOff
+            uint32_t pathLen;
+            uint32_t lineCount;
+            int64_t mtime;        //the file's fileStamp when it was read
+            uint64_t size;
+            uint64_t hash;
+        };
+        //terms are sorted by lowercase form, so case variants are adjacent
+        struct TermEntry {
+            uint64_t keyOff;      //into the blob
+            uint64_t postingOff;  //byte offset in the posting section
+            uint32_t keyLen;
+            uint32_t postingCount;
+        };
+        //the case variants of one lowercase form, in the same order
+        struct Group {
+            uint64_t postingOff;  //merged postings of all the variants
+            uint32_t postingCount;
+            uint32_t firstTerm;
+            uint32_t termCount;
+            uint32_t unused;
+        };
+        struct Slot {
+            uint32_t hash;        //high bits of the lowercase hash
+            uint32_t group;       //group + 1, 0 if empty
+        };
+        //sorted by trigram
+        struct TrigramEntry {
+            uint32_t trigram;     //as splitTrigrams packs it
+            uint32_t fileCount;
+            uint64_t filesOff;    //into the trigram file section
+        };
+
+        string owned;             //the image when built in memory
+        const char *image = nullptr;
+        size_t imageSize = 0;
+        const Header *header = nullptr;
+        const FileEntry *files = nullptr;
+        const TermEntry *terms = nullptr;
+        const Group *groups = nullptr;
+        const Slot *slots = nullptr;
+        const unsigned char *postings = nullptr;
+        const TrigramEntry *trigrams = nullptr;
+
+        void attach(const char *data, size_t size);
+        void checkEntries(const char *data, size_t size);
+        void release();
+        string_view termKey(int term);
+        int findGroup(const string &key);
+        uint32_t firstGroupFrom(string_view prefix, bool pastPrefix = false);
+        Cursor openList(uint64_t postingOff, uint32_t postingCount);
+};
+
+#endif
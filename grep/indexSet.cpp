@@ -0,0 +1,849 @@
+/*
+ *  indexSet.cpp
+ *  Harrison Tun and Jonah Pflaster
+ *
+ *  COMP 15 Proj Gerp
+ *
+ *  Purpose: This implementation file provides the function definitions for
+ *          the IndexSet class. Segments are appended as files are indexed
+ *          and only ever marked dead file by file; getting rid of the dead
+ *          files is left to whoever builds a new single segment set (see
+ *          IndexBuilder::compact). Saving writes the segment images one
+ *          after another behind a small header, and loading maps that file
+ *          and lets each segment view its image in place. Appending maps
+ *          another saved set after the segments already held, which is how
+ *          a segment written straight to disk rejoins the set.
+ *
+ */
+
+#include "indexSet.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <queue>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+static const char SET_MAGIC[8] = {'G', 'E', 'R', 'P', 'S', 'E', 'T', '1'};
+
+/*
+ * name:        concatenate
+ * purpose:     Join the results of several segments
+ * arguments:
+ *     parts: each segment's results, in segment order, used up
+ * returns:     every part's results, one part after another
+ * effects:     None
+ */
+template <typename T>
+static vector<T> concatenate(vector<vector<T>> &parts)
+{
+    if (parts.size() == 1) {
+        return std::move(parts[0]);
+    }
+    vector<T> result;
+    for (vector<T> &part : parts) {
+        result.insert(result.end(), part.begin(), part.end());
+    }
+    return result;
+}
+
+/*
+ * Default constructor for IndexSet class, starts with no segments
+ */
+IndexSet::IndexSet() {}
+
+/*
+ * Destructor for IndexSet class, lets go of its segments and saved set
+ */
+IndexSet::~IndexSet()
+{
+    clear();
+}
+
+/*
+ * name:        addSegment (member function)
+ * purpose:     Freeze a HashTable of new files into a segment
+ * arguments:
+ *     table: the table, whose files are numbered from 0
+ * returns:     Nothing
+ * effects:     The table's files get the numbers after every file already
+ *              in the set
+ */
+void IndexSet::addSegment(HashTable &table)
+{
+    shared_ptr<IndexFile> segment(new IndexFile());
+    segment->build(table);
+    firstFile.push_back(getFileSize());
+    dead.resize(dead.size() + segment->getFileSize(), false);
+    segments.push_back(std::move(segment));
+}
+
+/*
+ * name:        addSegment (member function)
+ * purpose:     Freeze a HashTable of new files into a segment kept on disk
+ * arguments:
+ *     table: the table, whose files are numbered from 0
+ *     path: a file to write the segment to, removed once it is mapped
+ * returns:     Nothing
+ * effects:     As addSegment, but the image is only held in memory while it
+ *              is written; after that the system reads its pages back as
+ *              they are used. Throws a runtime_error if the file can't be
+ *              written or mapped
+ */
+void IndexSet::addSegment(HashTable &table, const string &path)
+{
+    IndexSet single;
+    single.addSegment(table);
+    single.save(path);
+    single.clear();
+    try {
+        append(path);
+    } catch (const runtime_error &e) {
+        remove(path.c_str());
+        throw;
+    }
+    remove(path.c_str()); //the mapping keeps the data until it is let go
+}
+
+/*
+ * name:        clear (member function)
+ * purpose:     Drop every segment
+ * arguments:   None
+ * returns:     Nothing
+ * effects:     Segments and the saved set are freed once no copy of this
+ *              set holds them
+ */
+void IndexSet::clear()
+{
+    segments.clear();
+    firstFile.clear();
+    dead.clear();
+    deadCount = 0;
+    unmap();
+}
+
+/*
+ * name:        save (member function)
+ * purpose:     Write the set to a file so a later run can load it
+ * arguments:
+ *     path: the file to write
+ * returns:     Nothing
+ * effects:     Writes a temporary file and renames it over path, so a set
+ *              loaded from path stays intact while it is replaced. Throws a
+ *              runtime_error if the file can't be written
+ */
+void IndexSet::save(const string &path)
+{
+    if (segments.empty()) {
+        throw runtime_error("no index to save");
+    }
+    auto align = [](uint64_t offset) { return (offset + 7) & ~(uint64_t)7; };
+    Header head;
+    memcpy(head.magic, SET_MAGIC, sizeof(SET_MAGIC));
+    head.segmentCount = segments.size();
+    head.fileCount = dead.size();
+    head.segmentsOff = sizeof(Header);
+    head.deadOff = head.segmentsOff + segments.size() * sizeof(SegmentEntry);
+    vector<SegmentEntry> entries(segments.size());
+    uint64_t offset = align(head.deadOff + dead.size());
+    for (size_t s = 0; s < segments.size(); s++) {
+        entries[s].imageOff = offset;
+        entries[s].imageSize = segments[s]->getImage().size();
+        offset = align(offset + entries[s].imageSize);
+    }
+    head.setSize = offset;
+
+    string temporary = path + ".tmp";
+    ofstream output(temporary, ios::binary);
+    output.write((const char *)&head, sizeof(head));
+    output.write((const char *)entries.data(),
+                 entries.size() * sizeof(SegmentEntry));
+    string flags(dead.size(), '\0');
+    for (size_t f = 0; f < dead.size(); f++) {
+        flags[f] = dead[f] ? 1 : 0;
+    }
+    output.write(flags.data(), flags.size());
+    uint64_t written = head.deadOff + flags.size();
+    for (size_t s = 0; s < segments.size(); s++) {
+        string padding(entries[s].imageOff - written, '\0');
+        output.write(padding.data(), padding.size());
+        string_view image = segments[s]->getImage();
+        output.write(image.data(), image.size());
+        written = entries[s].imageOff + image.size();
+    }
+    output.write(string(head.setSize - written, '\0').data(),
+                 head.setSize - written);
+    output.close();
+    if (not output or rename(temporary.c_str(), path.c_str()) != 0) {
+        remove(temporary.c_str());
+        throw runtime_error("could not write index " + path);
+    }
+}
+
+/*
+ * name:        saveMerged (member function)
+ * purpose:     Write the set to a file as one segment holding every file
+ * arguments:
+ *     path: the file to write
+ * returns:     Nothing
+ * effects:     The segments are merged straight into the file, so the set
+ *              does not have to fit in memory; dead files keep their
+ *              numbers and their flags. Like save, writes a temporary file
+ *              and renames it. Throws a runtime_error if the file can't be
+ *              written
+ */
+void IndexSet::saveMerged(const string &path)
+{
+    if (segments.empty()) {
+        throw runtime_error("no index to save");
+    }
+    auto align = [](uint64_t offset) { return (offset + 7) & ~(uint64_t)7; };
+    Header head;
+    memcpy(head.magic, SET_MAGIC, sizeof(SET_MAGIC));
+    head.segmentCount = 1;
+    head.fileCount = dead.size();
+    head.segmentsOff = sizeof(Header);
+    head.deadOff = head.segmentsOff + sizeof(SegmentEntry);
+    SegmentEntry entry;
+    entry.imageOff = align(head.deadOff + dead.size());
+
+    string temporary = path + ".tmp";
+    ofstream output(temporary, ios::binary);
+    string flags(entry.imageOff - sizeof(Header), '\0'); //entry, dead, padding
+    for (size_t f = 0; f < dead.size(); f++) {
+        flags[sizeof(SegmentEntry) + f] = dead[f] ? 1 : 0;
+    }
+    output.write((const char *)&head, sizeof(head)); //rewritten when known
+    output.write(flags.data(), flags.size());
+    vector<IndexFile *> parts;
+    for (shared_ptr<IndexFile> &segment : segments) {
+        parts.push_back(segment.get());
+    }
+    try {
+        IndexFile::merge(parts, output);
+    } catch (const runtime_error &e) {
+        output.setstate(ios::failbit);
+    }
+    uint64_t end = output.tellp();
+    entry.imageSize = end - entry.imageOff;
+    head.setSize = align(end);
+    output.write(string(head.setSize - end, '\0').data(), head.setSize - end);
+    output.seekp(0);
+    output.write((const char *)&head, sizeof(head));
+    output.write((const char *)&entry, sizeof(entry));
+    output.close();
+    if (not output or rename(temporary.c_str(), path.c_str()) != 0) {
+        remove(temporary.c_str());
+        throw runtime_error("could not write index " + path);
+    }
+}
+
+/*
+ * name:        load (member function)
+ * purpose:     Map a set written by save and query it in place
+ * arguments:
+ *     path: the file to map
+ * returns:     Nothing
+ * effects:     Replaces every segment held. Throws a runtime_error if the
+ *              file can't be mapped or is not a gerp index
+ */
+void IndexSet::load(const string &path)
+{
+    clear();
+    append(path);
+}
+
+/*
+ * name:        append (member function)
+ * purpose:     Map a set written by save and add its segments after the
+ *              ones held
+ * arguments:
+ *     path: the file to map
+ * returns:     Nothing
+ * effects:     Its files get the numbers after every file already in the
+ *              set and keep their dead flags. The file may be removed once
+ *              this returns. Throws a runtime_error if the file can't be
+ *              mapped or is not a gerp index, leaving the set as it was
+ */
+void IndexSet::append(const string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw runtime_error("could not open index " + path);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 or info.st_size < (off_t)sizeof(Header)) {
+        close(fd);
+        throw runtime_error(path + " is not a gerp index");
+    }
+    void *data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        throw runtime_error("could not map index " + path);
+    }
+    size_t mappedSize = info.st_size;
+    mappings.push_back(shared_ptr<void>(data, [mappedSize](void *region) {
+        munmap(region, mappedSize);
+    }));
+    size_t segmentsBefore = segments.size();
+    uint32_t filesBefore = dead.size();
+    int deadBefore = deadCount;
+    const char *bytes = (const char *)data;
+    const Header *head = (const Header *)data;
+    size_t size = info.st_size;
+    try {
+        if (memcmp(head->magic, SET_MAGIC, sizeof(SET_MAGIC)) != 0 or
+            head->setSize != size or head->segmentsOff > size or
+            head->segmentCount > (size - head->segmentsOff) /
+                                 sizeof(SegmentEntry) or
+            head->deadOff > size or head->fileCount > size - head->deadOff) {
+            throw runtime_error("damaged index");
+        }
+        const SegmentEntry *entries =
+            (const SegmentEntry *)(bytes + head->segmentsOff);
+        for (uint32_t s = 0; s < head->segmentCount; s++) {
+            const SegmentEntry &entry = entries[s];
+            if (entry.imageOff % 8 != 0 or entry.imageOff > size or
+                entry.imageSize > size - entry.imageOff) {
+                throw runtime_error("damaged index");
+            }
+            shared_ptr<IndexFile> segment(new IndexFile());
+            segment->view(bytes + entry.imageOff, entry.imageSize);
+            firstFile.push_back(dead.size());
+            dead.resize(dead.size() + segment->getFileSize(), false);
+            segments.push_back(std::move(segment));
+        }
+        if (dead.size() - filesBefore != head->fileCount) {
+            throw runtime_error("damaged index");
+        }
+        for (uint32_t f = 0; f < head->fileCount; f++) {
+            if (bytes[head->deadOff + f] != 0) {
+                removeFile(filesBefore + f);
+            }
+        }
+    } catch (const runtime_error &e) {
+        segments.resize(segmentsBefore);
+        firstFile.resize(segmentsBefore);
+        dead.resize(filesBefore);
+        deadCount = deadBefore;
+        mappings.pop_back();
+        throw runtime_error(path + " is not a gerp index");
+    }
+}
+
+/*
+ * name:        unmap (member function)
+ * purpose:     Let go of the saved sets loaded or appended
+ * arguments:   None
+ * returns:     Nothing
+ * effects:     Each is unmapped once no copy of this set still views it
+ */
+void IndexSet::unmap()
+{
+    mappings.clear();
+}
+
+/*
+ * name:        getStats (member function)
+ * purpose:     Report what the index holds and the memory it takes
+ * arguments:   None
+ * returns:     the counts and sizes of every segment added up
+ * effects:     Reads every segment's tables. A word's postings in several
+ *              segments are added up, among each segment's largest lists
+ */
+IndexStats IndexSet::getStats()
+{
+    IndexStats stats;
+    for (auto &segment : segments) {
+        segment->addStats(stats);
+    }
+    stats.deadFiles = deadCount;
+    sort(stats.largest.begin(), stats.largest.end(),
+         [](const pair<uint64_t, string> &a, const pair<uint64_t, string> &b) {
+             return a.second < b.second;
+         });
+    vector<pair<uint64_t, string>> combined;
+    for (auto &list : stats.largest) {
+        if (not combined.empty() and combined.back().second == list.second) {
+            combined.back().first += list.first;
+        } else {
+            combined.push_back(list);
+        }
+    }
+    stable_sort(combined.begin(), combined.end(),
+                [](const pair<uint64_t, string> &a,
+                   const pair<uint64_t, string> &b) {
+                    return a.first > b.first;
+                });
+    combined.resize(min(combined.size(), (size_t)IndexStats::LARGEST));
+    stats.largest = std::move(combined);
+    return stats;
+}
+
+/*
+ * name:        getSegmentCount (member function)
+ * purpose:     Get the number of segments
+ * arguments:   None
+ * returns:     int number of segments, 0 if there is no index
+ * effects:     None
+ */
+int IndexSet::getSegmentCount()
+{
+    return segments.size();
+}
+
+/*
+ * name:        getFileSize (member function)
+ * purpose:     Get the number of files in every segment, dead or not
+ * arguments:   None
+ * returns:     int number of files, one more than the largest file number
+ * effects:     None
+ */
+int IndexSet::getFileSize()
+{
+    return dead.size();
+}
+
+/*
+ * name:        getDeadCount (member function)
+ * purpose:     Get the number of dead files
+ * arguments:   None
+ * returns:     int number of files removed or replaced since the last full
+ *              build
+ * effects:     None
+ */
+int IndexSet::getDeadCount()
+{
+    return deadCount;
+}
+
+/*
+ * name:        isLive (member function)
+ * purpose:     Tell whether a file still counts
+ * arguments:
+ *     file: number of the file
+ * returns:     false if the file was removed or replaced
+ * effects:     Throws a runtime_error if the file is not found
+ */
+bool IndexSet::isLive(int file)
+{
+    segmentOf(file);
+    return not dead[file];
+}
+
+/*
+ * name:        removeFile (member function)
+ * purpose:     Mark a file dead, so queries no longer see it
+ * arguments:
+ *     file: number of the file
+ * returns:     Nothing
+ * effects:     Its postings stay in its segment until the next full build.
+ *              Throws a runtime_error if the file is not found
+ */
+void IndexSet::removeFile(int file)
+{
+    segmentOf(file);
+    if (not dead[file]) {
+        dead[file] = true;
+        deadCount++;
+    }
+}
+
+/*
+ * name:        segmentOf (member function)
+ * purpose:     Find the segment holding a file
+ * arguments:
+ *     file: number of the file
+ * returns:     index of the segment
+ * effects:     Throws a runtime_error if the file is not found
+ */
+int IndexSet::segmentOf(int file)
+{
+    if (file < 0 or file >= getFileSize()) {
+        throw runtime_error("key not found");
+    }
+    return upper_bound(firstFile.begin(), firstFile.end(), file) -
+           firstFile.begin() - 1;
+}
+
+/*
+ * name:        getFile (member function)
+ * purpose:     Retrieve the path of a file
+ * arguments:
+ *     file: number of the file
+ * returns:     string_view of the path, valid while the set is unchanged
+ * effects:     Throws a runtime_error if the file is not found
+ */
+string_view IndexSet::getFile(int file)
+{
+    int s = segmentOf(file);
+    return segments[s]->getFile(file - firstFile[s]);
+}
+
+/*
+ * name:        getLine (member function)
+ * purpose:     Retrieve one line of a file
+ * arguments:
+ *     file: number of the file
+ *     lineNum: line number, counting from 0
+ * returns:     string_view of the line without its newline
+ * effects:     Throws a runtime_error if the file or line is not found
+ */
+string_view IndexSet::getLine(int file, int lineNum)
+{
+    int s = segmentOf(file);
+    return segments[s]->getLine(file - firstFile[s], lineNum);
+}
+
+/*
+ * name:        getLineCount (member function)
+ * purpose:     Get the number of lines in a file
+ * arguments:
+ *     file: number of the file
+ * returns:     int number of lines
+ * effects:     Throws a runtime_error if the file is not found
+ */
+int IndexSet::getLineCount(int file)
+{
+    int s = segmentOf(file);
+    return segments[s]->getLineCount(file - firstFile[s]);
+}
+
+/*
+ * name:        getText (member function)
+ * purpose:     Retrieve the whole text of a file
+ * arguments:
+ *     file: number of the file
+ * returns:     string_view of every line, each followed by '\n'
+ * effects:     Throws a runtime_error if the file is not found
+ */
+string_view IndexSet::getText(int file)
+{
+    int s = segmentOf(file);
+    return segments[s]->getText(file - firstFile[s]);
+}
+
+/*
+ * name:        getStamp (member function)
+ * purpose:     Retrieve what a file looked like when it was indexed
+ * arguments:
+ *     file: number of the file
+ * returns:     the file's fileStamp
+ * effects:     Throws a runtime_error if the file is not found
+ */
+fileStamp IndexSet::getStamp(int file)
+{
+    int s = segmentOf(file);
+    return segments[s]->getStamp(file - firstFile[s]);
+}
+
+/*
+ * name:        getWord (member function)
+ * purpose:     Get every (file, line) of a live file a word appears on
+ * arguments:
+ *     key: the word to look up
+ *     caseSens: whether case must match exactly
+ * returns:     vector of (file number, line number) pairs, sorted and
+ *              without duplicates
+ * effects:     None
+ */
+vector<pair<int, int>> IndexSet::getWord(const string &key, bool caseSens)
+{
+    vector<pair<int, int>> result;
+    for (Cursor cursor = getCursor(key, caseSens); not cursor.done();
+         cursor.next()) {
+        result.push_back(cursor.current());
+    }
+    return result;
+}
+
+/*
+ * name:        getCursor (member function)
+ * purpose:     Start walking the (file, line) pairs a word appears on
+ * arguments:
+ *     key: the word to look up
+ *     caseSens: whether case must match exactly
+ * returns:     a Cursor over every segment, on the first posting of a live
+ *              file, or done if there is none
+ * effects:     The cursor is only valid while the set is unchanged
+ */
+IndexSet::Cursor IndexSet::getCursor(const string &key, bool caseSens)
+{
+    Cursor cursor;
+    cursor.set = this;
+    for (shared_ptr<IndexFile> &segment : segments) {
+        cursor.parts.push_back(segment->getCursor(key, caseSens));
+    }
+    cursor.skipDead();
+    return cursor;
+}
+
+/*
+ * name:        getMatches (member function)
+ * purpose:     Get every (file, line) a word matching a wildcard pattern
+ *              appears on
+ * arguments:
+ *     pattern: the pattern, with '*' for any run of characters and '?' for
+ *              any one character
+ *     caseSens: whether case must match exactly
+ * returns:     vector of (file number, line number) pairs of live files,
+ *              sorted and without duplicates
+ * effects:     Each segment's dictionary is searched on its own thread
+ */
+vector<pair<int, int>> IndexSet::getMatches(const string &pattern,
+                                            bool caseSens)
+{
+    vector<vector<pair<int, int>>> parts(segments.size());
+    fanOut([&](size_t s) {
+        vector<IndexFile::Cursor> lists =
+            segments[s]->getMatches(pattern, caseSens);
+        mergeLists(s, lists, parts[s]);
+    });
+    return concatenate(parts);
+}
+
+/*
+ * name:        getFuzzy (member function)
+ * purpose:     Get every (file, line) a word close to a given one appears on
+ * arguments:
+ *     word: the word, in any case
+ *     distance: the most edits (a character inserted, removed or changed)
+ *               a word may be from it, ignoring case
+ * returns:     vector of (file number, line number) pairs of live files,
+ *              sorted and without duplicates
+ * effects:     Each segment's dictionary is searched on its own thread
+ */
+vector<pair<int, int>> IndexSet::getFuzzy(const string &word, int distance)
+{
+    vector<vector<pair<int, int>>> parts(segments.size());
+    fanOut([&](size_t s) {
+        vector<IndexFile::Cursor> lists =
+            segments[s]->getFuzzy(word, distance);
+        mergeLists(s, lists, parts[s]);
+    });
+    return concatenate(parts);
+}
+
+/*
+ * name:        mergeLists (member function)
+ * purpose:     Merge posting lists of one segment into a result
+ * arguments:
+ *     segment: the segment the lists are from, after every segment
+ *              already merged into result
+ *     lists: cursors on the lists, used up by the merge
+ *     result: gets the lines of live files in the lists, in order and
+ *             without duplicates
+ * returns:     Nothing
+ * effects:     The lists are merged at once through a heap of their
+ *              cursors, and a dead file is skipped in one seek
+ */
+void IndexSet::mergeLists(size_t segment, vector<IndexFile::Cursor> &lists,
+                          vector<pair<int, int>> &result)
+{
+    auto later = [&lists](size_t a, size_t b) {
+        return lists[a].current() > lists[b].current();
+    };
+    priority_queue<size_t, vector<size_t>, decltype(later)> heap(later);
+    for (size_t i = 0; i < lists.size(); i++) {
+        if (not lists[i].done()) {
+            heap.push(i);
+        }
+    }
+    while (not heap.empty()) {
+        size_t i = heap.top();
+        heap.pop();
+        pair<int, int> local = lists[i].current();
+        int file = local.first + firstFile[segment];
+        if (dead[file]) {
+            lists[i].seek({local.first + 1, 0});
+        } else {
+            if (result.empty() or
+                result.back() != make_pair(file, local.second)) {
+                result.push_back({file, local.second});
+            }
+            lists[i].next();
+        }
+        if (not lists[i].done()) {
+            heap.push(i);
+        }
+    }
+}
+
+/*
+ * name:        fanOut (member function)
+ * purpose:     Run the same work on every segment at once
+ * arguments:
+ *     work: called with each segment's index; it must only read the set
+ * returns:     Nothing
+ * effects:     Every segment but the first gets a thread of its own, and
+ *              the first runs on the caller's. Returns once all are done
+ */
+void IndexSet::fanOut(const function<void(size_t)> &work)
+{
+    vector<thread> threads;
+    for (size_t s = 1; s < segments.size(); s++) {
+        threads.emplace_back(work, s);
+    }
+    if (not segments.empty()) {
+        work(0);
+    }
+    for (thread &t : threads) {
+        t.join();
+    }
+}
+
+/*
+ * name:        getTrigramFiles (member function)
+ * purpose:     Find the files that could hold some text, by its trigrams
+ * arguments:
+ *     required: trigrams packed as splitTrigrams does, all of which the
+ *               text has
+ * returns:     the live files holding every one of the trigrams, sorted;
+ *              every live file if none are required
+ * effects:     In each segment the trigrams' file lists are intersected
+ *              shortest first, stopping once nothing is left
+ */
+vector<int> IndexSet::getTrigramFiles(const vector<uint32_t> &required)
+{
+    vector<int> result;
+    for (size_t s = 0; s < segments.size(); s++) {
+        vector<int> files;
+        if (required.empty()) {
+            for (int f = 0; f < segments[s]->getFileSize(); f++) {
+                files.push_back(f);
+            }
+        } else {
+            vector<vector<int>> lists;
+            for (uint32_t trigram : required) {
+                lists.push_back(segments[s]->getTrigramFiles(trigram));
+            }
+            sort(lists.begin(), lists.end(),
+                 [](const vector<int> &a, const vector<int> &b) {
+                     return a.size() < b.size();
+                 });
+            files = std::move(lists[0]);
+            for (size_t i = 1; i < lists.size() and not files.empty(); i++) {
+                vector<int> both;
+                set_intersection(files.begin(), files.end(), lists[i].begin(),
+                                 lists[i].end(), back_inserter(both));
+                files.swap(both);
+            }
+        }
+        for (int file : files) {
+            if (not dead[file + firstFile[s]]) {
+                result.push_back(file + firstFile[s]);
+            }
+        }
+    }
+    return result;
+}
+
+/*
+ * name:        done (Cursor member function)
+ * purpose:     Tell whether the cursor has passed the last posting
+ * arguments:   None
+ * returns:     true if there is no current posting
+ * effects:     None
+ */
+bool IndexSet::Cursor::done()
+{
+    return part >= parts.size();
+}
+
+/*
+ * name:        current (Cursor member function)
+ * purpose:     Get the posting the cursor is on
+ * arguments:   None
+ * returns:     its (file number, line number); only valid if not done
+ * effects:     None
+ */
+pair<int, int> IndexSet::Cursor::current()
+{
+    pair<int, int> local = parts[part].current();
+    return {local.first + set->firstFile[part], local.second};
+}
+
+/*
+ * name:        next (Cursor member function)
+ * purpose:     Move to the next posting of a live file
+ * arguments:   None
+ * returns:     Nothing
+ * effects:     None
+ */
+void IndexSet::Cursor::next()
+{
+    parts[part].next();
+    skipDead();
+}
+
+/*
+ * name:        seek (Cursor member function)
+ * purpose:     Move to the first posting of a live file at or after a
+ *              (file, line)
+ * arguments:
+ *     target: the (file number, line number) to reach
+ * returns:     Nothing
+ * effects:     Never moves backwards. Segments that end before the target
+ *              are skipped without being read
+ */
+void IndexSet::Cursor::seek(pair<int, int> target)
+{
+    while (part + 1 < parts.size() and
+           set->firstFile[part + 1] <= target.first) {
+        part++;
+    }
+    if (done()) {
+        return;
+    }
+    int base = set->firstFile[part];
+    if (target.first >= base) {
+        parts[part].seek({target.first - base, target.second});
+    }
+    skipDead();
+}
+
+/*
+ * name:        size (Cursor member function)
+ * purpose:     Estimate how many postings the cursor walks, to plan queries
+ * arguments:   None
+ * returns:     the length of the word's lists in every segment, counting
+ *              postings of dead files
+ * effects:     None
+ */
+uint64_t IndexSet::Cursor::size()
+{
+    uint64_t total = 0;
+    for (IndexFile::Cursor &at : parts) {
+        total += at.size();
+    }
+    return total;
+}
+
+/*
+ * name:        skipDead (Cursor member function)
+ * purpose:     Move past dead files and used up segments
+ * arguments:   None
+ * returns:     Nothing
+ * effects:     A dead file is skipped in one seek, not posting by posting
+ */
+void IndexSet::Cursor::skipDead()
+{
+    while (part < parts.size()) {
+        IndexFile::Cursor &at = parts[part];
+        if (at.done()) {
+            part++;
+            continue;
+        }
+        pair<int, int> local = at.current();
+        if (not set->dead[local.first + set->firstFile[part]]) {
+            return;
+        }
+        at.seek({local.first + 1, 0});
+    }
+}
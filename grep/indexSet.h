@@ -0,0 +1,119 @@
+/*
+ *  indexSet.h
+ *  Harrison Tun and Jonah Pflaster
+ *  {htun01}         {jpflas01}
+ *
+ *  COMP 15 Proj Gerp
+ *
+ *  Purpose: This header file defines the interface for the IndexSet class,
+ *          which is the whole gerp index as a list of segments. A segment is
+ *          an IndexFile image; the first one is a full build and each later
+ *          one holds the files added or changed since. Files get numbers in
+ *          segment order, and a file that was deleted or replaced by a newer
+ *          copy is marked dead (a tombstone) instead of being cut out of its
+ *          segment. Queries read every segment and skip dead files. The set
+ *          is saved to one file and mapped back in without copying.
+ *
+ *          Segments never change once built, so a copy of a set shares them,
+ *          and the mapping they view, with the original and only has its
+ *          own dead flags. Updating a copy leaves the original as it was,
+ *          which lets queries go on reading one set while the next is made.
+ *
+ *          For builds bigger than memory, a segment can go to disk as soon
+ *          as it is built and be mapped back in, and the segments of a set
+ *          can be merged into a set of one without holding any of them in
+ *          memory. Queries that read each segment's whole dictionary run
+ *          the segments on threads of their own and join the results.
+ *
+ */
+
+#ifndef __INDEXSET_H
+#define __INDEXSET_H
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "hashTable.h"
+#include "indexFile.h"
+using namespace std;
+
+class IndexSet
+{
+    public:
+        //walks a word's postings in every segment, skipping dead files
+        class Cursor {
+            public:
+                bool done();
+                pair<int, int> current();
+                void next();
+                void seek(pair<int, int> target);
+                uint64_t size();
+            private:
+                friend class IndexSet;
+                IndexSet *set = nullptr;
+                vector<IndexFile::Cursor> parts; //one per segment
+                size_t part = 0;                 //the segment being read
+                void skipDead();
+        };
+
+        IndexSet();
+        ~IndexSet();
+        //a copy shares the segments and the mappings they view
+        IndexSet(const IndexSet &other) = default;
+        IndexSet &operator=(const IndexSet &other) = default;
+        void addSegment(HashTable &table);
+        void addSegment(HashTable &table, const string &path);
+        void clear();
+        void save(const string &path);
+        void saveMerged(const string &path);
+        void load(const string &path);
+        void append(const string &path);
+        int getSegmentCount();
+        int getFileSize();
+        int getDeadCount();
+        bool isLive(int file);
+        void removeFile(int file);
+        string_view getFile(int file);
+        string_view getLine(int file, int lineNum);
+        int getLineCount(int file);
+        string_view getText(int file);
+        fileStamp getStamp(int file);
+        vector<pair<int, int>> getWord(const string &key, bool caseSens);
+        Cursor getCursor(const string &key, bool caseSens);
+        vector<pair<int, int>> getMatches(const string &pattern,
+                                          bool caseSens);
+        vector<pair<int, int>> getFuzzy(const string &word, int distance);
+        vector<int> getTrigramFiles(const vector<uint32_t> &required);
+        IndexStats getStats();
+    private:
+        //a saved set: Header, SegmentEntry[segmentCount], one dead flag
+        //byte per file, then each segment's image on an 8 byte boundary
+        struct Header {
+            char magic[8];
+            uint32_t segmentCount;
+            uint32_t fileCount;
+            uint64_t segmentsOff;
+            uint64_t deadOff;
+            uint64_t setSize;
+        };
+        struct SegmentEntry {
+            uint64_t imageOff;
+            uint64_t imageSize;
+        };
+
+        vector<shared_ptr<void>> mappings; //the saved sets loaded
+        vector<shared_ptr<IndexFile>> segments; //may view a mapping
+        vector<int> firstFile;     //number of each segment's first file
+        vector<bool> dead;         //one per file
+        int deadCount = 0;
+        int segmentOf(int file);
+        void mergeLists(size_t segment, vector<IndexFile::Cursor> &lists,
+                        vector<pair<int, int>> &result);
+        void fanOut(const function<void(size_t)> &work);
+        void unmap();
+};
+
+#endif
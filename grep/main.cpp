@@ -23,15 +23,99 @@ using namespace std;
 */
 int main(int argc, char *argv[]) 
 {
-    if (argc != 3) {
-        cerr << "Usage: ./gerp inputDirectory outputFile" << endl;
+    string usage = "Usage: ./gerp inputDirectory outputFile\n"
+                   "       ./gerp --save-index indexFile inputDirectory "
+                   "outputFile\n"
+                   "       ./gerp --load-index indexFile outputFile\n"
+                   "       ./gerp --update-index indexFile inputDirectory "
+                   "outputFile\n"
+                   "       ./gerp --watch inputDirectory outputFile\n"
+                   "       ./gerp --serve socket inputDirectory\n"
+                   "       ./gerp --serve socket --load-index indexFile\n"
+                   "       ./gerp --connect socket outputFile\n"
+                   "Any of these may start with --queries queryFile to "
+                   "answer the\nqueries in queryFile instead of asking, "
+                   "with --async-output to write\nresults on a thread "
+                   "of their own, and with --stats to print what the\n"
+                   "index holds and how long it took to build, as @stats "
+                   "does.\nWith --memory-budget MB, a build holds about MB "
+                   "megabytes of index at a time,\nwriting the rest to "
+                   "$TMPDIR (or /tmp) and merging it at the end.\n"
+                   "After --update-index or a --watch update, lines from "
+                   "changed and new files are\nlisted after the rest until "
+                   "the index is compacted.";
+    IndexBuilder builder;
+    while (argc > 1) {
+        string prefix = argv[1];
+        if (argc > 2 and prefix == "--queries") {
+            //answer a file of queries in parallel, then the usual arguments
+            builder.setQueryFile(argv[2]);
+            argv += 2;
+            argc -= 2;
+        } else if (prefix == "--async-output") {
+            builder.setAsyncOutput(true);
+            argv++;
+            argc--;
+        } else if (argc > 2 and prefix == "--memory-budget") {
+            //spill the index to disk instead of outgrowing memory
+            builder.setMemoryBudget((size_t)max(1, atoi(argv[2])) << 20);
+            argv += 2;
+            argc -= 2;
+        } else if (prefix == "--stats") {
+            builder.setStats(true);
+            argv++;
+            argc--;
+        } else {
+            break;
+        }
+    }
+    string option = argc > 1 ? argv[1] : "";
+    if (argc == 5 and option == "--save-index") {
+        //build, keep the index for next time, then answer queries
+        string outputFile = argv[4];
+        builder.build(argv[3]);
+        builder.saveIndex(argv[2]);
+        builder.query(outputFile);
+    } else if (argc == 4 and option == "--load-index") {
+        //skip indexing, query a saved index in place
+        string outputFile = argv[3];
+        builder.loadIndex(argv[2]);
+        builder.query(outputFile);
+    } else if (argc == 5 and option == "--update-index") {
+        //reindex only what changed since the index was saved
+        string outputFile = argv[4];
+        builder.loadIndex(argv[2]);
+        builder.update(argv[3]);
+        builder.saveIndex(argv[2]);
+        builder.query(outputFile);
+    } else if (argc == 4 and option == "--watch") {
+        //stay current with the directory while answering queries
+        string outputFile = argv[3];
+        builder.build(argv[2]);
+        builder.watch(argv[2]);
+        builder.query(outputFile);
+    } else if (argc == 4 and option == "--serve") {
+        //answer clients on a socket, staying current with the directory
+        builder.build(argv[3]);
+        builder.watch(argv[3]);
+        builder.serve(argv[2]);
+    } else if (argc == 5 and option == "--serve" and
+               string(argv[3]) == "--load-index") {
+        //answer clients on a socket from a saved index
+        builder.loadIndex(argv[4]);
+        builder.serve(argv[2]);
+    } else if (argc == 4 and option == "--connect") {
+        //ask a running server instead of building an index
+        QueryClient client;
+        client.prompt(argv[2], argv[3]);
+    } else if (argc == 3) {
+        string inputDirectory = argv[1];
+        string outputFile = argv[2];
+        builder.run(inputDirectory, outputFile);
+    } else {
+        cerr << usage << endl;
         exit(EXIT_FAILURE);
     }
-    string inputDirectory = argv[1];
-    string outputFile = argv[2];
-    
-    IndexBuilder builder;
-    builder.run(inputDirectory, outputFile);
     cout << "Goodbye! Thank you and have a nice day." << endl;
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,418 @@
+/*
+ *  queryServer.cpp
+ *  Harrison Tun and Jonah Pflaster
+ *
+ *  COMP 15 Proj Gerp
+ *
+ *  Purpose: This implementation file provides the function definitions for
+ *          the QueryServer and QueryClient classes. The server polls its
+ *          listening socket so a signal is noticed within a moment, starts
+ *          a thread per client it accepts, and joins the threads of clients
+ *          that hung up as it goes. Stopping shuts every client's socket
+ *          down, which wakes their threads, and removes the socket file.
+ *          Frames are written with MSG_NOSIGNAL, so a client that went away
+ *          ends its own thread rather than the server.
+ *
+ */
+
+#include "queryServer.h"
+#include "resultWriter.h"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+//set by SIGINT or SIGTERM, checked by the accept loop and the updater;
+//lock free, so a signal handler may set it
+static atomic<bool> signalled{false};
+
+/*
+ * name:        onSignal
+ * purpose:     Ask the running server to stop
+ * arguments:
+ *     signal: the signal caught
+ * returns:     Nothing
+ * effects:     Only sets a flag, as a signal handler may
+ */
+static void onSignal(int signal)
+{
+    (void)signal;
+    signalled = true;
+}
+
+/*
+ * name:        socketAddress
+ * purpose:     Fill in the address of a Unix socket
+ * arguments:
+ *     socketPath: the socket's file
+ *     address: set to the address
+ * returns:     Nothing
+ * effects:     Throws a runtime_error if the path is too long for a socket
+ */
+static void socketAddress(const string &socketPath, sockaddr_un &address)
+{
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.empty() or socketPath.size() >= sizeof(address.sun_path)) {
+        throw runtime_error(socketPath + " can't be a socket");
+    }
+    memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+}
+
+/*
+ * name:        readAll
+ * purpose:     Read exactly so many bytes from a socket
+ * arguments:
+ *     fd: the socket
+ *     data: where the bytes go
+ *     size: how many to read
+ * returns:     false if the socket closed or failed first
+ * effects:     Picks up after short reads and interrupted calls
+ */
+static bool readAll(int fd, char *data, size_t size)
+{
+    while (size > 0) {
+        ssize_t got = read(fd, data, size);
+        if (got < 0 and errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return false;
+        }
+        data += got;
+        size -= got;
+    }
+    return true;
+}
+
+/*
+ * name:        writeAll
+ * purpose:     Write exactly so many bytes to a socket
+ * arguments:
+ *     fd: the socket
+ *     data: the bytes
+ *     size: how many to write
+ * returns:     false if the socket closed or failed first
+ * effects:     Never raises SIGPIPE
+ */
+static bool writeAll(int fd, const char *data, size_t size)
+{
+    while (size > 0) {
+        ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0 and errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+/*
+ * name:        clearStaleSocket
+ * purpose:     Remove a socket left by a server that did not stop cleanly
+ * arguments:
+ *     socketPath: the socket's file
+ *     address: its address
+ * returns:     Nothing
+ * effects:     Does nothing if there is no file. Throws a runtime_error,
+ *              leaving the file alone, if it is not a socket or a server
+ *              still answers on it
+ */
+static void clearStaleSocket(const string &socketPath,
+                             const sockaddr_un &address)
+{
+    struct stat info;
+    if (lstat(socketPath.c_str(), &info) < 0) {
+        if (errno == ENOENT) {
+            return;
+        }
+        throw runtime_error("it could not be checked");
+    }
+    if (not S_ISSOCK(info.st_mode)) {
+        throw runtime_error("it is not a socket");
+    }
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe < 0) {
+        throw runtime_error("could not make a socket");
+    }
+    //only a socket nothing listens on refuses a connection
+    bool live = connect(probe, (const sockaddr *)&address,
+                        sizeof(address)) == 0;
+    bool refused = not live and errno == ECONNREFUSED;
+    close(probe);
+    if (live) {
+        throw runtime_error("a server is running on it");
+    } else if (not refused) {
+        throw runtime_error("it could not be replaced");
+    }
+    unlink(socketPath.c_str());
+}
+
+/*
+ * Constructor and destructor for the QueryServer class
+ */
+QueryServer::QueryServer() {}
+
+QueryServer::~QueryServer()
+{
+    shutDown();
+}
+
+/*
+ * name:        readFrame (static member function)
+ * purpose:     Read one message of the protocol
+ * arguments:
+ *     fd: the socket
+ *     message: set to the message
+ *     limit: the longest message accepted
+ * returns:     false if the socket closed, failed, or sent a frame longer
+ *              than limit
+ * effects:     None
+ */
+bool QueryServer::readFrame(int fd, string &message, uint32_t limit)
+{
+    unsigned char head[4];
+    if (not readAll(fd, (char *)head, sizeof(head))) {
+        return false;
+    }
+    uint32_t size = (uint32_t)head[0] << 24 | (uint32_t)head[1] << 16 |
+                    (uint32_t)head[2] << 8 | head[3];
+    if (size > limit) {
+        return false;
+    }
+    message.resize(size);
+    return readAll(fd, &message[0], size);
+}
+
+/*
+ * name:        writeFrame (static member function)
+ * purpose:     Write one message of the protocol
+ * arguments:
+ *     fd: the socket
+ *     message: the message, less than 4 GB
+ * returns:     false if the socket closed or failed
+ * effects:     None
+ */
+bool QueryServer::writeFrame(int fd, string_view message)
+{
+    uint32_t size = message.size();
+    unsigned char head[4] = {(unsigned char)(size >> 24),
+                             (unsigned char)(size >> 16),
+                             (unsigned char)(size >> 8), (unsigned char)size};
+    return writeAll(fd, (const char *)head, sizeof(head)) and
+           writeAll(fd, message.data(), message.size());
+}
+
+/*
+ * name:        listen (member function)
+ * purpose:     Make the socket clients connect to
+ * arguments:
+ *     socketPath: the socket's file, replaced if a socket no server
+ *                 answers on is left there
+ * returns:     Nothing
+ * effects:     Throws a runtime_error if the socket can't be made, or the
+ *              file is something else or a live server's socket
+ */
+void QueryServer::listen(const string &socketPath)
+{
+    sockaddr_un address;
+    socketAddress(socketPath, address);
+    clearStaleSocket(socketPath, address);
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        throw runtime_error("could not make a socket");
+    }
+    if (bind(listenFd, (sockaddr *)&address, sizeof(address)) < 0 or
+        ::listen(listenFd, SOMAXCONN) < 0) {
+        close(listenFd);
+        listenFd = -1;
+        throw runtime_error("it could not be bound");
+    }
+    path = socketPath;
+}
+
+/*
+ * name:        run (member function)
+ * purpose:     Accept clients and answer their requests until stopped
+ * arguments:
+ *     handler: answers one request; called on many threads at once
+ * returns:     Nothing
+ * effects:     Catches SIGINT and SIGTERM, which stop the server. Waits for
+ *              the requests being answered, then closes every connection
+ *              and removes the socket
+ */
+void QueryServer::run(Handler handler)
+{
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = onSignal;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    pollfd waiting = {listenFd, POLLIN, 0};
+    while (not signalled and listenFd >= 0) {
+        if (poll(&waiting, 1, ACCEPT_POLL_MS) <= 0) {
+            continue;
+        }
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        reap(false);
+        lock_guard<mutex> guard(lock);
+        clients.emplace_back();
+        Client &client = clients.back();
+        client.fd = fd;
+        client.worker = thread(&QueryServer::serveClient, this,
+                               ref(client), ref(handler));
+    }
+    shutDown();
+}
+
+/*
+ * name:        isStopped (member function)
+ * purpose:     Tell whether the server has stopped or been asked to
+ * arguments:   None
+ * returns:     true once a signal came or run returned
+ * effects:     None; safe to call from any thread
+ */
+bool QueryServer::isStopped()
+{
+    return stopped or signalled;
+}
+
+/*
+ * name:        serveClient (member function)
+ * purpose:     The thread of one client: answer its requests in order
+ * arguments:
+ *     client: the client
+ *     handler: answers each request
+ * returns:     Nothing
+ * effects:     Ends when the client hangs up or sends a bad frame
+ */
+void QueryServer::serveClient(Client &client, Handler &handler)
+{
+    string request, reply;
+    while (readFrame(client.fd, request, MAX_REQUEST)) {
+        reply.clear();
+        handler(request, reply);
+        if (not writeFrame(client.fd, reply)) {
+            break;
+        }
+    }
+    client.done = true;
+}
+
+/*
+ * name:        reap (member function)
+ * purpose:     Join the threads of clients and close their connections
+ * arguments:
+ *     all: true to wake and join every client, false for only those done
+ * returns:     Nothing
+ * effects:     Waking a client shuts its socket down, so its thread sees
+ *              the client hang up once its current request is answered
+ */
+void QueryServer::reap(bool all)
+{
+    lock_guard<mutex> guard(lock);
+    for (auto it = clients.begin(); it != clients.end();) {
+        if (not all and not it->done) {
+            it++;
+            continue;
+        }
+        shutdown(it->fd, SHUT_RDWR);
+        it->worker.join();
+        close(it->fd);
+        it = clients.erase(it);
+    }
+}
+
+/*
+ * name:        shutDown (member function)
+ * purpose:     Stop serving
+ * arguments:   None
+ * returns:     Nothing
+ * effects:     Closes the socket and removes its file, then wakes and
+ *              joins every client. Does nothing the second time
+ */
+void QueryServer::shutDown()
+{
+    stopped = true;
+    if (listenFd >= 0) {
+        close(listenFd);
+        listenFd = -1;
+        unlink(path.c_str());
+    }
+    reap(true);
+}
+
+/*
+ * name:        prompt (member function)
+ * purpose:     Ask the user for queries and have a server answer them
+ * arguments:
+ *     socketPath: the server's socket
+ *     outputFile: the file results are written to
+ * returns:     Nothing
+ * effects:     Runs until @q, @quit or the end of input, as the query loop
+ *              does. @f switches the output file here; every other line is
+ *              sent to the server as it was typed, and the reply to a line
+ *              starting with @stats is printed. Exits the program if the
+ *              server can't be reached or goes away
+ */
+void QueryClient::prompt(const string &socketPath, const string &outputFile)
+{
+    sockaddr_un address;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    try {
+        socketAddress(socketPath, address);
+    } catch (const runtime_error &e) {
+        fd = -1;
+    }
+    if (fd < 0 or connect(fd, (sockaddr *)&address, sizeof(address)) < 0) {
+        cerr << "Could not connect to " << socketPath << ", exiting." << endl;
+        exit(EXIT_FAILURE);
+    }
+    ResultWriter writer;
+    writer.open(outputFile);
+    string line, first, reply;
+    cout << "Query? ";
+    while (getline(cin, line)) {
+        size_t start = line.find_first_not_of(" \t");
+        first = start == string::npos ? ""
+                : line.substr(start, line.find_first_of(" \t", start) - start);
+        if (first == "@q" or first == "@quit") {
+            break;
+        } else if (first == "@f") {
+            string rest = line.substr(start + 2);
+            size_t name = rest.find_first_not_of(" \t");
+            if (name != string::npos) {
+                writer.open(rest.substr(name, rest.find_first_of(" \t", name)
+                                                  - name));
+            }
+        } else if (not first.empty()) {
+            if (not QueryServer::writeFrame(fd, line) or
+                not QueryServer::readFrame(fd, reply)) {
+                cerr << "Lost the server, exiting." << endl;
+                exit(EXIT_FAILURE);
+            }
+            if (first == "@stats") {
+                cout << reply; //printed, as the query loop does
+            } else {
+                writer.write(reply);
+                writer.flush(); //the user may look at the file now
+            }
+        }
+        cout << "Query? ";
+    }
+    writer.close();
+    close(fd);
+}
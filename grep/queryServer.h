@@ -0,0 +1,80 @@
+/*
+ *  queryServer.h
+ *  Harrison Tun and Jonah Pflaster
+ *  {htun01}         {jpflas01}
+ *
+ *  COMP 15 Proj Gerp
+ *
+ *  Purpose: This header file defines the interface for the QueryServer
+ *          class, which answers gerp queries from other processes over a
+ *          Unix domain socket, and the QueryClient class, which is the
+ *          query prompt of a client. Every message either way is a frame:
+ *          its length as four bytes, most significant first, then that
+ *          many bytes. A client sends a line of commands as typed at the
+ *          prompt and gets back their results as they would be written to
+ *          the output file. A client may send any number of requests on one
+ *          connection, each answered before the next is read. The server
+ *          answers each client on a thread of its own, and stops on SIGINT
+ *          or SIGTERM.
+ *
+ */
+
+#ifndef __QUERYSERVER_H
+#define __QUERYSERVER_H
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+using namespace std;
+
+class QueryServer
+{
+    public:
+        //answers one request: the commands, and the empty reply to fill
+        using Handler = function<void(const string &, string &)>;
+
+        QueryServer();
+        ~QueryServer();
+        QueryServer(const QueryServer &other) = delete;
+        QueryServer &operator=(const QueryServer &other) = delete;
+        void listen(const string &socketPath);
+        void run(Handler handler);
+        bool isStopped();
+
+        static bool readFrame(int fd, string &message,
+                              uint32_t limit = UINT32_MAX);
+        static bool writeFrame(int fd, string_view message);
+    private:
+        //a connected client and the thread answering it
+        struct Client {
+            int fd;
+            thread worker;
+            atomic<bool> done{false};
+        };
+
+        //largest request the server reads; a bigger one drops the client
+        static const uint32_t MAX_REQUEST = 1 << 20;
+        //longest accept waits before checking for a signal, in ms
+        static const int ACCEPT_POLL_MS = 250;
+
+        int listenFd = -1;
+        string path;
+        atomic<bool> stopped{false};
+        mutex lock;
+        list<Client> clients;
+        void serveClient(Client &client, Handler &handler);
+        void reap(bool all);
+        void shutDown();
+};
+
+class QueryClient
+{
+    public:
+        void prompt(const string &socketPath, const string &outputFile);
+};
+
+#endif
@@ -0,0 +1,233 @@
+/*
+ *  regexQuery.cpp
+ *  Harrison Tun and Jonah Pflaster
+ *
+ *  COMP 15 Proj Gerp
+ *
+ *  Purpose: This implementation file provides the function definitions for
+ *          the RegexQuery class. The expression is scanned once for the runs
+ *          of plain characters that sit at its top level, outside groups and
+ *          classes and not made optional by a quantifier: any match has to
+ *          contain every such run. With an alternation at the top level no
+ *          run is certain, and the search reads every file.
+ *
+ *          A run's trigrams pick out the candidate files through the index.
+ *          In a candidate the longest run is searched for in the whole text,
+ *          which jumps straight to the lines that could match, and only
+ *          lines holding every run are handed to std::regex, by far the
+ *          slowest step.
+ *
+ */
+
+#include "regexQuery.h"
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
+/*
+ * name:        RegexQuery (constructor)
+ * purpose:     Compile a regular expression
+ * arguments:
+ *     pattern: the expression, for example: ->next|0x[0-9a-f]+
+ *     sensitive: whether case must match exactly
+ * returns:     Nothing
+ * effects:     Throws a runtime_error (a regex_error) saying what is wrong
+ *              if the expression can't be compiled
+ */
+RegexQuery::RegexQuery(const string &pattern, bool sensitive)
+    : caseSens(sensitive)
+{
+    if (pattern.empty()) {
+        throw runtime_error("nothing to search for");
+    }
+    matcher = regex(pattern, sensitive ? regex::ECMAScript
+                                       : regex::ECMAScript | regex::icase);
+    findLiterals(pattern);
+}
+
+/*
+ * name:        evaluate (member function)
+ * purpose:     Find every line the expression matches
+ * arguments:
+ *     index: the index to search
+ * returns:     vector of (file number, line number) pairs, sorted and
+ *              without duplicates
+ * effects:     None
+ */
+vector<pair<int, int>> RegexQuery::evaluate(IndexSet &index)
+{
+    vector<uint32_t> required, trigrams;
+    for (string &literal : literals) {
+        splitTrigrams(literal, trigrams);
+        required.insert(required.end(), trigrams.begin(), trigrams.end());
+    }
+    sort(required.begin(), required.end());
+    required.erase(unique(required.begin(), required.end()), required.end());
+
+    vector<pair<int, int>> found;
+    string lowered;
+    for (int file : index.getTrigramFiles(required)) {
+        string_view text = index.getText(file);
+        string_view searched = text; //text the runs are looked for in
+        if (not caseSens and not literals.empty()) {
+            lowered = toLowerCase(string(text));
+            searched = lowered;
+        }
+        size_t start = 0;
+        int lineNum = 0;
+        int lineCount = index.getLineCount(file);
+        while (start < text.size()) {
+            size_t lineStart = start;
+            if (not literals.empty()) {
+                size_t at = searched.find(literals[0], start);
+                if (at == string_view::npos) {
+                    break;
+                }
+                lineStart = searched.rfind('\n', at);
+                lineStart = (lineStart == string_view::npos or
+                             lineStart < start) ? start : lineStart + 1;
+                lineNum += count(text.begin() + start,
+                                 text.begin() + lineStart, '\n');
+            }
+            if (lineNum >= lineCount) {
+                break; //a '\n' the line offsets don't have: damaged
+            }
+            size_t lineEnd = text.find('\n', lineStart); //every line has one
+            if (matchesLine(searched.substr(lineStart, lineEnd - lineStart),
+                            text.substr(lineStart, lineEnd - lineStart))) {
+                found.push_back({file, lineNum});
+            }
+            lineNum++;
+            start = lineEnd + 1;
+        }
+    }
+    return found;
+}
+
+/*
+ * name:        findLiterals (member function)
+ * purpose:     Find the runs of plain text every match contains
+ * arguments:
+ *     pattern: the expression
+ * returns:     Nothing
+ * effects:     Fills literals, longest first. Groups, classes and escapes
+ *              like \d end a run and are not looked into. A character
+ *              followed by *, ? or {} may be missing, so it is dropped from
+ *              its run; one followed by + is kept, but ends the run. A top
+ *              level | leaves no runs at all
+ */
+void RegexQuery::findLiterals(const string &pattern)
+{
+    string run;
+    auto flush = [this, &run]() {
+        if (not run.empty()) {
+            literals.push_back(caseSens ? run : toLowerCase(run));
+            run.clear();
+        }
+    };
+    //skips a class or a group at i, to just past its end
+    auto skip = [&pattern](size_t i) {
+        int depth = 0;
+        bool inClass = false;
+        for (; i < pattern.size(); i++) {
+            char c = pattern[i];
+            if (c == '\\') {
+                i++;
+            } else if (inClass) {
+                //a ] right after [ or [^ is part of the class
+                if (c == ']' and pattern[i - 1] != '[' and
+                    not (pattern[i - 1] == '^' and pattern[i - 2] == '[')) {
+                    inClass = false;
+                    if (depth == 0) {
+                        return i + 1;
+                    }
+                }
+            } else if (c == '[') {
+                inClass = true;
+            } else if (c == '(') {
+                depth++;
+            } else if (c == ')' and --depth == 0) {
+                return i + 1;
+            }
+        }
+        return i;
+    };
+    size_t i = 0;
+    while (i < pattern.size()) {
+        char c = pattern[i];
+        if (c == '|') {
+            literals.clear();
+            return;
+        } else if (c == '*' or c == '?' or c == '{') {
+            if (not run.empty()) {
+                run.pop_back();
+            }
+            flush();
+            i = c == '{' ? pattern.find('}', i) : i;
+            i = i == string::npos ? pattern.size() : i + 1;
+            if (i < pattern.size() and pattern[i] == '?') {
+                i++; //lazy, not another quantifier
+            }
+        } else if (c == '+') {
+            flush();
+            i++;
+            if (i < pattern.size() and pattern[i] == '?') {
+                i++;
+            }
+        } else if (c == '[' or c == '(') {
+            flush();
+            i = skip(i);
+        } else if (c == '\\' and i + 1 < pattern.size() and
+                   not isalnum((unsigned char)pattern[i + 1])) {
+            run += pattern[i + 1]; //an escaped symbol is itself
+            i += 2;
+        } else if (c == '\\') {
+            flush();
+            char kind = i + 1 < pattern.size() ? pattern[i + 1] : ' ';
+            i += 2;
+            //the rest of \x41, \u0041, \cJ or \12 is not text of its own
+            if (kind == 'x' or kind == 'u') {
+                size_t end = min(pattern.size(), i + (kind == 'x' ? 2 : 4));
+                while (i < end and isxdigit((unsigned char)pattern[i])) {
+                    i++;
+                }
+            } else if (kind == 'c' and i < pattern.size()) {
+                i++;
+            } else if (isdigit((unsigned char)kind)) {
+                while (i < pattern.size() and
+                       isdigit((unsigned char)pattern[i])) {
+                    i++;
+                }
+            }
+        } else if (c == '.' or c == '^' or c == '$') {
+            flush();
+            i++;
+        } else {
+            run += c;
+            i++;
+        }
+    }
+    flush();
+    sort(literals.begin(), literals.end(),
+         [](const string &a, const string &b) { return a.size() > b.size(); });
+}
+
+/*
+ * name:        matchesLine (member function)
+ * purpose:     Check one line against the expression
+ * arguments:
+ *     searched: the line as the runs are looked for in it, lowercased when
+ *               case is ignored
+ *     line: the line itself, without its newline
+ * returns:     true if the expression matches somewhere in the line
+ * effects:     None
+ */
+bool RegexQuery::matchesLine(string_view searched, string_view line)
+{
+    for (string &literal : literals) {
+        if (searched.find(literal) == string_view::npos) {
+            return false;
+        }
+    }
+    return regex_search(line.begin(), line.end(), matcher);
+}
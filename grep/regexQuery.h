@@ -0,0 +1,46 @@
+/*
+ *  regexQuery.h
+ *  Harrison Tun and Jonah Pflaster
+ *  {htun01}         {jpflas01}
+ *
+ *  COMP 15 Proj Gerp
+ *
+ *  Purpose: This header file defines the interface for the RegexQuery
+ *          class, which finds the lines of an IndexSet matching a regular
+ *          expression (ECMAScript syntax, as std::regex reads it). Unlike
+ *          word queries it sees the raw text of a line, punctuation and
+ *          all, so it can find substrings like ->next or 0x7f. The runs of
+ *          plain text every match must contain are pulled out of the
+ *          expression, their trigrams narrow the search to the files that
+ *          hold all of them, and only the lines holding the runs are given
+ *          to the regex.
+ *
+ */
+
+#ifndef __REGEXQUERY_H
+#define __REGEXQUERY_H
+#include <regex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "indexSet.h"
+using namespace std;
+
+class RegexQuery
+{
+    public:
+        RegexQuery(const string &pattern, bool sensitive);
+        vector<pair<int, int>> evaluate(IndexSet &index);
+    private:
+        bool caseSens;
+        regex matcher;
+        //text every match contains, lowercased when case is ignored,
+        //longest first
+        vector<string> literals;
+
+        void findLiterals(const string &pattern);
+        bool matchesLine(string_view searched, string_view line);
+};
+
+#endif
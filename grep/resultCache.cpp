@@ -0,0 +1,174 @@
+/*
+ *  resultCache.cpp
+ *  Harrison Tun and Jonah Pflaster
+ *
+ *  COMP 15 Proj Gerp
+ *
+ *  Purpose: This implementation file provides the function definitions for
+ *          the ResultCache class. Entries sit in a list in order of use and
+ *          a hash map finds an entry's place in it, so a lookup, a move to
+ *          the front and an eviction from the back are all constant time.
+ *
+ */
+
+#include "resultCache.h"
+
+/*
+ * name:        ResultCache (constructor)
+ * purpose:     Make an empty cache
+ * arguments:
+ *     maxBytes: the most bytes the entries may take
+ * returns:     Nothing
+ * effects:     None
+ */
+ResultCache::ResultCache(size_t maxBytes) : budget(maxBytes) {}
+
+/*
+ * name:        find (member function)
+ * purpose:     Look up the results of a query
+ * arguments:
+ *     key: the query, normalized so that queries with the same results
+ *          have the same key
+ *     result: set to the results if they are kept
+ * returns:     true if they were kept
+ * effects:     The entry becomes the most recently used. Counts a hit or a
+ *              miss
+ */
+bool ResultCache::find(const string &key, string &result)
+{
+    lock_guard<mutex> guard(lock);
+    auto found = lookup.find(key);
+    if (found == lookup.end()) {
+        misses++;
+        return false;
+    }
+    hits++;
+    entries.splice(entries.begin(), entries, found->second);
+    result = found->second->second;
+    return true;
+}
+
+/*
+ * name:        insert (member function)
+ * purpose:     Keep the results of a query
+ * arguments:
+ *     key: the normalized query
+ *     result: its results, as written to the output file
+ * returns:     Nothing
+ * effects:     Evicts the least recently used entries until the new one
+ *              fits. Results bigger than a quarter of the budget are not
+ *              kept, so one huge query can't flush everything else
+ */
+void ResultCache::insert(const string &key, const string &result)
+{
+    lock_guard<mutex> guard(lock);
+    if (lookup.count(key) > 0) {
+        return; //another thread answered the same query first
+    }
+    size_t needed = key.size() + result.size() + ENTRY_OVERHEAD;
+    if (needed > budget / 4) {
+        return;
+    }
+    while (bytes + needed > budget and not entries.empty()) {
+        bytes -= cost(entries.back());
+        lookup.erase(entries.back().first);
+        entries.pop_back();
+        evictions++;
+    }
+    entries.emplace_front(key, result);
+    lookup.emplace(entries.front().first, entries.begin());
+    bytes += needed;
+}
+
+/*
+ * name:        clear (member function)
+ * purpose:     Forget every kept result, for when the index changes
+ * arguments:   None
+ * returns:     Nothing
+ * effects:     The counters are kept
+ */
+void ResultCache::clear()
+{
+    lock_guard<mutex> guard(lock);
+    lookup.clear();
+    entries.clear();
+    bytes = 0;
+}
+
+/*
+ * name:        getHits (member function)
+ * purpose:     Get how many lookups found their query
+ * arguments:   None
+ * returns:     the count since the cache was made
+ * effects:     None
+ */
+uint64_t ResultCache::getHits()
+{
+    lock_guard<mutex> guard(lock);
+    return hits;
+}
+
+/*
+ * name:        getMisses (member function)
+ * purpose:     Get how many lookups did not find their query
+ * arguments:   None
+ * returns:     the count since the cache was made
+ * effects:     None
+ */
+uint64_t ResultCache::getMisses()
+{
+    lock_guard<mutex> guard(lock);
+    return misses;
+}
+
+/*
+ * name:        getEvictions (member function)
+ * purpose:     Get how many entries were dropped to make room
+ * arguments:   None
+ * returns:     the count since the cache was made
+ * effects:     None
+ */
+uint64_t ResultCache::getEvictions()
+{
+    lock_guard<mutex> guard(lock);
+    return evictions;
+}
+
+/*
+ * name:        getBytes (member function)
+ * purpose:     Get the bytes the entries take, as counted against the budget
+ * arguments:   None
+ * returns:     the bytes
+ * effects:     None
+ */
+size_t ResultCache::getBytes()
+{
+    lock_guard<mutex> guard(lock);
+    return bytes;
+}
+
+/*
+ * name:        getEntryCount (member function)
+ * purpose:     Get how many queries have their results kept
+ * arguments:   None
+ * returns:     the number of entries
+ * effects:     None
+ */
+size_t ResultCache::getEntryCount()
+{
+    lock_guard<mutex> guard(lock);
+    return entries.size();
+}
+
+/*
+ * name:        cost (member function)
+ * purpose:     Get the bytes an entry counts for
+ * arguments:
+ *     entry: the key and results
+ * returns:     their sizes plus the bookkeeping around them
+ * effects:     None
+ */
+size_t ResultCache::cost(const pair<string, string> &entry)
+{
+    return entry.first.size() + entry.second.size() + ENTRY_OVERHEAD;
+}
@@ -0,0 +1,58 @@
+/*
+ *  resultCache.h
+ *  Harrison Tun and Jonah Pflaster
+ *  {htun01}         {jpflas01}
+ *
+ *  COMP 15 Proj Gerp
+ *
+ *  Purpose: This header file defines the interface for the ResultCache
+ *          class, which keeps the written out results of recent queries so
+ *          a repeated query is answered without searching the index or
+ *          reading its lines again. Entries are kept least recently used
+ *          first out, within a budget of bytes that counts each entry's key
+ *          and text. The cache is emptied whenever the index changes. It is
+ *          locked inside, so queries on several threads can share it.
+ *
+ */
+
+#ifndef __RESULTCACHE_H
+#define __RESULTCACHE_H
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+using namespace std;
+
+class ResultCache
+{
+    public:
+        ResultCache(size_t maxBytes);
+        bool find(const string &key, string &result);
+        void insert(const string &key, const string &result);
+        void clear();
+        uint64_t getHits();
+        uint64_t getMisses();
+        uint64_t getEvictions();
+        size_t getBytes();
+        size_t getEntryCount();
+    private:
+        //bytes an entry costs beyond its key and text: list and map nodes
+        static const size_t ENTRY_OVERHEAD = 128;
+
+        //most recently used first
+        list<pair<string, string>> entries;
+        unordered_map<string_view, list<pair<string, string>>::iterator>
+            lookup;                //keys view the strings in entries
+        size_t budget;
+        size_t bytes = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        mutex lock;
+        size_t cost(const pair<string, string> &entry);
+};
+
+#endif
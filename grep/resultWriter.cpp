@@ -0,0 +1,291 @@
+/*
+ *  resultWriter.cpp
+ *  Harrison Tun and Jonah Pflaster
+ *
+ *  COMP 15 Proj Gerp
+ *
+ *  Purpose: This implementation file provides the function definitions for
+ *          the ResultWriter class. Results are taken over, never formatted
+ *          again: a small one is appended to the current buffer and a big
+ *          one becomes a buffer itself. Once a megabyte is waiting, or on a
+ *          flush, the buffers are handed off as a batch and written with
+ *          writev, picking up after partial writes. With the thread on, the
+ *          hand off only queues the batch, and a full queue makes the
+ *          caller wait, which bounds the memory held.
+ *
+ */
+
+#include "resultWriter.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/*
+ * Constructor and destructor for the ResultWriter class
+ */
+ResultWriter::ResultWriter() {}
+
+ResultWriter::~ResultWriter()
+{
+    close();
+    if (worker.joinable()) {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        changed.notify_all();
+        worker.join();
+    }
+}
+
+/*
+ * name:        setAsync (member function)
+ * purpose:     Have a thread of the writer's own do the writing
+ * arguments:
+ *     on: true to start the thread; false is ignored once it runs
+ * returns:     Nothing
+ * effects:     Starts the thread the first time it is turned on
+ */
+void ResultWriter::setAsync(bool on)
+{
+    if (on and not async) {
+        async = true;
+        worker = thread(&ResultWriter::run, this);
+    }
+}
+
+/*
+ * name:        open (member function)
+ * purpose:     Start writing to a file
+ * arguments:
+ *     filePath: the file, emptied if it exists
+ * returns:     Nothing
+ * effects:     Writes out and closes the file open before. If the file can't
+ *              be opened results are dropped, as an ofstream would
+ */
+void ResultWriter::open(const string &filePath)
+{
+    close();
+    path = filePath;
+    failed = false;
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+}
+
+/*
+ * name:        write (member function)
+ * purpose:     Add results after the ones written so far
+ * arguments:
+ *     text: the results, taken over by the writer and left empty
+ * returns:     Nothing
+ * effects:     Hands the buffers off once enough is waiting
+ */
+void ResultWriter::write(string &text)
+{
+    if (text.size() >= BUFFER_BYTES / 4) {
+        //big enough to go out on its own, without a copy
+        if (not current.empty()) {
+            fullBytes += current.size();
+            full.push_back(std::move(current));
+            current.clear();
+        }
+        fullBytes += text.size();
+        full.push_back(std::move(text));
+    } else {
+        if (current.size() + text.size() > BUFFER_BYTES) {
+            fullBytes += current.size();
+            full.push_back(std::move(current));
+            current.clear();
+        }
+        if (current.empty() and current.capacity() < BUFFER_BYTES) {
+            //a spare only replaces an empty buffer, never waiting results
+            lock_guard<mutex> guard(lock); //the thread returns spares
+            if (not spare.empty()) {
+                current = std::move(spare.back());
+                spare.pop_back();
+            } else {
+                current.reserve(BUFFER_BYTES);
+            }
+        }
+        current += text;
+    }
+    text.clear();
+    if (fullBytes >= BUFFER_BYTES) {
+        handOff();
+    }
+}
+
+/*
+ * name:        flush (member function)
+ * purpose:     Send everything written so far on its way to the file
+ * arguments:   None
+ * returns:     Nothing
+ * effects:     Writes it now, or queues it for the thread
+ */
+void ResultWriter::flush()
+{
+    if (not current.empty()) {
+        fullBytes += current.size();
+        full.push_back(std::move(current));
+        current.clear();
+    }
+    handOff();
+}
+
+/*
+ * name:        close (member function)
+ * purpose:     Finish writing the file
+ * arguments:   None
+ * returns:     Nothing
+ * effects:     Waits for every result to be written, then closes it
+ */
+void ResultWriter::close()
+{
+    flush();
+    drain();
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+/*
+ * name:        handOff (member function)
+ * purpose:     Write the full buffers as one batch
+ * arguments:   None
+ * returns:     Nothing
+ * effects:     With the thread on, queues the batch instead, first waiting
+ *              while MAX_QUEUED batches are queued
+ */
+void ResultWriter::handOff()
+{
+    if (full.empty()) {
+        return;
+    }
+    Batch batch{fd, std::move(full)};
+    full.clear();
+    fullBytes = 0;
+    if (not async) {
+        writeBatch(batch);
+        recycle(batch.buffers);
+        return;
+    }
+    unique_lock<mutex> guard(lock);
+    changed.wait(guard, [this]() { return queue.size() < MAX_QUEUED; });
+    queue.push_back(std::move(batch));
+    guard.unlock();
+    changed.notify_all();
+}
+
+/*
+ * name:        writeBatch (member function)
+ * purpose:     Write a batch's buffers with as few writev calls as it takes
+ * arguments:
+ *     batch: the file and the buffers, in order
+ * returns:     Nothing
+ * effects:     Says once on cerr if the file can't be written
+ */
+void ResultWriter::writeBatch(Batch &batch)
+{
+    if (batch.fd < 0 or failed) {
+        return;
+    }
+    vector<iovec> pieces;
+    for (string &buffer : batch.buffers) {
+        if (not buffer.empty()) {
+            pieces.push_back({&buffer[0], buffer.size()});
+        }
+    }
+    size_t first = 0;
+    while (first < pieces.size()) {
+        int count = min(pieces.size() - first, (size_t)IOV_MAX);
+        ssize_t written = writev(batch.fd, &pieces[first], count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            failed = true;
+            cerr << "Could not write " << path << "." << endl;
+            return;
+        }
+        size_t left = written;
+        while (first < pieces.size() and left >= pieces[first].iov_len) {
+            left -= pieces[first].iov_len;
+            first++;
+        }
+        if (first < pieces.size()) {
+            pieces[first].iov_base = (char *)pieces[first].iov_base + left;
+            pieces[first].iov_len -= left;
+        }
+    }
+}
+
+/*
+ * name:        recycle (member function)
+ * purpose:     Keep written buffers to fill again
+ * arguments:
+ *     buffers: the written buffers
+ * returns:     Nothing
+ * effects:     Keeps at most two, each a full buffer, and frees small and
+ *              huge results
+ */
+void ResultWriter::recycle(vector<string> &buffers)
+{
+    lock_guard<mutex> guard(lock);
+    for (string &buffer : buffers) {
+        if (spare.size() < 2 and buffer.capacity() >= BUFFER_BYTES and
+            buffer.capacity() <= 2 * BUFFER_BYTES) {
+            buffer.clear();
+            spare.push_back(std::move(buffer));
+        }
+    }
+}
+
+/*
+ * name:        drain (member function)
+ * purpose:     Wait for the thread to write every queued batch
+ * arguments:   None
+ * returns:     Nothing
+ * effects:     None without the thread
+ */
+void ResultWriter::drain()
+{
+    if (not async) {
+        return;
+    }
+    unique_lock<mutex> guard(lock);
+    changed.wait(guard, [this]() { return queue.empty() and not writing; });
+}
+
+/*
+ * name:        run (member function)
+ * purpose:     The writer thread: write queued batches until stopped
+ * arguments:   None
+ * returns:     Nothing
+ * effects:     Only stops once the queue is empty
+ */
+void ResultWriter::run()
+{
+    unique_lock<mutex> guard(lock);
+    while (true) {
+        changed.wait(guard, [this]() {
+            return stopping or not queue.empty();
+        });
+        if (queue.empty()) {
+            return;
+        }
+        Batch batch = std::move(queue.front());
+        queue.pop_front();
+        writing = true;
+        guard.unlock();
+        changed.notify_all(); //there is room in the queue
+        writeBatch(batch);
+        recycle(batch.buffers);
+        guard.lock();
+        writing = false;
+        changed.notify_all();
+    }
+}
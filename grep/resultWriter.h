@@ -0,0 +1,74 @@
+/*
+ *  resultWriter.h
+ *  Harrison Tun and Jonah Pflaster
+ *  {htun01}         {jpflas01}
+ *
+ *  COMP 15 Proj Gerp
+ *
+ *  Purpose: This header file defines the interface for the ResultWriter
+ *          class, which writes query results to the output file. Small
+ *          results are gathered into large buffers that are reused, big
+ *          ones are taken over whole, and the buffers go out together in
+ *          one writev call, so a query with many hits costs a few system
+ *          calls rather than one per line. Optionally a thread of its own
+ *          does the writing, so the next query can run while the last one's
+ *          results go to disk.
+ *
+ */
+
+#ifndef __RESULTWRITER_H
+#define __RESULTWRITER_H
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+class ResultWriter
+{
+    public:
+        ResultWriter();
+        ~ResultWriter();
+        ResultWriter(const ResultWriter &other) = delete;
+        ResultWriter &operator=(const ResultWriter &other) = delete;
+        void setAsync(bool on);
+        void open(const string &filePath);
+        void write(string &text);
+        void flush();
+        void close();
+    private:
+        //buffers to write to one file, in order
+        struct Batch {
+            int fd;
+            vector<string> buffers;
+        };
+
+        static const size_t BUFFER_BYTES = 1 << 20;
+        //most batches waiting for the thread before write blocks
+        static const size_t MAX_QUEUED = 4;
+
+        int fd = -1;
+        string path;
+        bool failed = false;       //a write failed, reported once
+        string current;            //the buffer small results go into
+        vector<string> full;       //buffers waiting to be written
+        size_t fullBytes = 0;
+        vector<string> spare;      //written buffers, kept for reuse
+        bool async = false;
+        thread worker;
+        mutex lock;
+        condition_variable changed;
+        deque<Batch> queue;        //for the thread to write
+        bool writing = false;      //the thread holds a batch
+        bool stopping = false;
+
+        void handOff();
+        void writeBatch(Batch &batch);
+        void recycle(vector<string> &buffers);
+        void drain();
+        void run();
+};
+
+#endif
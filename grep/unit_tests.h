@@ -0,0 +1,369 @@
+/*
+ *  unit_tests.h
+ *  Harrison Tun and Jonah Pflaster
+ *  {htun01}         {jpflas01}
+ *
+ *  COMP 15 Proj Gerp
+ *
+ *  Purpose: Test functionality of gerp's queries against small indexes
+ *           built from temporary directories
+ *
+ */
+#include "gerpProcessor.h"
+#include <algorithm>
+#include <cassert>
+#include <filesystem>
+#include <functional>
+#include <fstream>
+#include <random>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*
+ * Helpers for the tests below: a directory of files made for one test, and
+ * the text a query writes
+ */
+string make_tree(const string &name, const vector<pair<string, string>> &files)
+{
+    filesystem::path dir = filesystem::temp_directory_path() / name;
+    filesystem::remove_all(dir);
+    filesystem::create_directories(dir);
+    for (const pair<string, string> &file : files) {
+        filesystem::create_directories((dir / file.first).parent_path());
+        ofstream output(dir / file.first, ios::binary);
+        output << file.second;
+    }
+    return dir.string();
+}
+
+string answer(IndexBuilder &builder, const string &query)
+{
+    string output;
+    builder.search(query, output);
+    return output;
+}
+
+/*
+ * A few files over two directories, and a query of each kind to ask of
+ * them, for the tests that compare two ways of making an index
+ */
+string sample_tree(const string &name)
+{
+    return make_tree(name,
+                     {{"notes.txt", "The cat sat.\nA hash table\nno cats\n"},
+                      {"src/table.cpp", "hash->next = table;\nCat cot\n"},
+                      {"src/deep/main.cpp", "int main() { cat(); }\n"},
+                      {"zed.txt", "receive the table\nhash\n"}});
+}
+
+vector<string> sample_queries()
+{
+    return {"cat", "@i cat", "table", "hash", "c?t", "ca*",
+            "@b hash AND table", "@b cat OR cot NOT sat",
+            "@b \"hash table\"", "@re c[ao]t", "@re ->next",
+            "@fuzzy 1 recive", "missing"};
+}
+
+//the lines of a query's output in sorted order, for outputs that may list
+//the same lines in another order
+vector<string> sorted_lines(const string &output)
+{
+    vector<string> lines;
+    istringstream input(output);
+    string line;
+    while (getline(input, line)) {
+        lines.push_back(line);
+    }
+    sort(lines.begin(), lines.end());
+    return lines;
+}
+
+/*
+ * Brute force answers to check queries against: every line of every file
+ * under dir that match accepts, formatted as gerp writes a hit, sorted
+ */
+vector<string> brute_force(const string &dir,
+                           function<bool(const string &)> match)
+{
+    vector<string> lines;
+    for (const filesystem::directory_entry &entry :
+         filesystem::recursive_directory_iterator(dir)) {
+        if (not entry.is_regular_file()) {
+            continue;
+        }
+        ifstream input(entry.path());
+        string line;
+        for (int number = 1; getline(input, line); number++) {
+            if (match(line)) {
+                lines.push_back(entry.path().string() + ":" +
+                                to_string(number) + ": " + line);
+            }
+        }
+    }
+    sort(lines.begin(), lines.end());
+    return lines;
+}
+
+//the words of a line as the index keeps them, punctuation stripped
+vector<string> line_words(const string &line, bool caseSens)
+{
+    vector<string> words;
+    istringstream input(line);
+    string word;
+    while (input >> word) {
+        string stripped(stripNonAlphaNum(word));
+        if (not caseSens) {
+            for (char &c : stripped) {
+                c = tolower((unsigned char)c);
+            }
+        }
+        if (not stripped.empty()) {
+            words.push_back(stripped);
+        }
+    }
+    return words;
+}
+
+//whether the words hold phrase as a run of words next to each other
+bool has_phrase(const vector<string> &words, const vector<string> &phrase)
+{
+    return search(words.begin(), words.end(), phrase.begin(),
+                  phrase.end()) != words.end();
+}
+
+/*
+ * Word queries: punctuation around a word is stripped as it always was,
+ * '?' at either end included, while a '?' or '*' inside a word is still a
+ * wildcard
+ */
+void word_query_punctuation()
+{
+    string dir = make_tree("gerp_unit_punctuation",
+                           {{"a.txt", "what is this\nSo what?\ncat and cot\n"},
+                            {"b.txt", "whatever\n(what) now\nconnect\n"}});
+    IndexBuilder builder;
+    builder.build(dir);
+    string plain = answer(builder, "what");
+    assert(plain.find("Not Found") == string::npos);
+    vector<string> queries = {"what?", "what??", "?what", "(what)",
+                              "what!", "\"what\"", "what?!"};
+    for (const string &query : queries) {
+        assert(answer(builder, query) == plain);
+    }
+    assert(answer(builder, "@i What?") == answer(builder, "@i what"));
+
+    string pattern = answer(builder, "c?t");
+    assert(pattern.find("cat and cot") != string::npos);
+    assert(answer(builder, "conn*").find("connect") != string::npos);
+    filesystem::remove_all(dir);
+}
+
+/*
+ * Boolean queries: @b finds exactly the lines a brute force check of their
+ * words accepts, with NOT binding tighter than AND and AND than OR, and
+ * phrases only where their words are next to each other
+ */
+void boolean_query_brute_force()
+{
+    string dir = make_tree("gerp_unit_boolean",
+                           {{"a.txt", "hash table\ntable hash\nhash big table\n"
+                                      "Hash Table\nthe cat and the dog\n"
+                                      "cat cow\ndog cow\ndog, table.\n(cat)\n"},
+                            {"sub/b.txt", "a dog on the table\nHASH-TABLE\n"
+                                          "cow\ncat; hash table!\n"}});
+    IndexBuilder builder;
+    builder.build(dir);
+    auto has = [](const string &line, const string &word) {
+        return has_phrase(line_words(line, true), {word});
+    };
+    vector<pair<string, function<bool(const string &)>>> queries = {
+        {"hash table", [&](const string &l) {
+             return has(l, "hash") and has(l, "table");
+         }},
+        {"hash AND table", [&](const string &l) {
+             return has(l, "hash") and has(l, "table");
+         }},
+        {"\"hash table\"", [&](const string &l) {
+             return has_phrase(line_words(l, true), {"hash", "table"});
+         }},
+        {"@i \"hash table\"", [&](const string &l) {
+             return has_phrase(line_words(l, false), {"hash", "table"});
+         }},
+        {"cat OR dog NOT cow", [&](const string &l) {
+             return has(l, "cat") or (has(l, "dog") and not has(l, "cow"));
+         }},
+        {"(cat OR dog) NOT cow", [&](const string &l) {
+             return (has(l, "cat") or has(l, "dog")) and not has(l, "cow");
+         }},
+        {"NOT cow cat", [&](const string &l) {
+             return has(l, "cat") and not has(l, "cow");
+         }},
+        {"cat OR dog table", [&](const string &l) {
+             return has(l, "cat") or (has(l, "dog") and has(l, "table"));
+         }},
+        {"table NOT \"hash table\"", [&](const string &l) {
+             return has(l, "table") and
+                    not has_phrase(line_words(l, true), {"hash", "table"});
+         }}};
+    for (const pair<string, function<bool(const string &)>> &query :
+         queries) {
+        vector<string> expected = brute_force(dir, query.second);
+        assert(not expected.empty());
+        assert(sorted_lines(answer(builder, "@b " + query.first)) ==
+               expected);
+    }
+
+    vector<pair<string, string>> errors = {
+        {"", "nothing to search for"},
+        {"cat AND", "query ends too early"},
+        {"(cat", "missing )"},
+        {"cat )", "unexpected )"},
+        {"NOT cat", "NOT needs words to exclude from"},
+        {"cat OR NOT dog", "NOT needs words to exclude from"},
+        {"NOT NOT cat", "unexpected NOT"},
+        {"\"cat", "missing closing \""},
+        {"\"\" cat", "empty phrase"}};
+    for (const pair<string, string> &error : errors) {
+        assert(answer(builder, "@b " + error.first) ==
+               "Invalid query " + error.first + ": " + error.second + "\n");
+    }
+    assert(answer(builder, "@b cat cow dog") == "cat cow dog Not Found.\n");
+    filesystem::remove_all(dir);
+}
+
+/*
+ * Regular expressions: @re finds exactly the lines std::regex finds when
+ * run over every line, however the runs of plain text each match must hold
+ * are taken from the expression (alternations, optional and counted parts,
+ * escapes, back references, classes holding ']', @i)
+ */
+void regex_query_brute_force()
+{
+    string dir = make_tree("gerp_unit_regex",
+                           {{"a.txt", "color\ncolour\ncolr\nabc\nabbc\nabbbc\n"
+                                      "abbbbc\nx.y\nxzy\nABC and abc\n"},
+                            {"sub/b.txt", "foobaz\nbarbaz\nbaz\nabab\nab ab\n"
+                                          "ct\ncat\na]y\nx]]y\nHello there\n"
+                                          "the world\nac\nid42 = 7;\n"}});
+    IndexBuilder builder;
+    builder.build(dir);
+    vector<string> expressions = {"colou?r", "ab{2,3}c", "cat|dog",
+                                  "(foo|bar)baz", "x\\.y", "\\x41BC",
+                                  "(ab)\\1", "[\\]a]+y", "x[^a-z\\]]+y",
+                                  "ca{0}t", "ab*c", "(?:ab)?c", "id\\d+",
+                                  "@i HELLO|World", "@i \\x41bc", "@i COLOU?R"};
+    for (string expression : expressions) {
+        string query = "@re " + expression;
+        bool caseSens = expression.rfind("@i ", 0) != 0;
+        if (not caseSens) {
+            expression = expression.substr(3);
+        }
+        regex matcher(expression, caseSens ? regex::ECMAScript
+                                           : regex::ECMAScript | regex::icase);
+        vector<string> expected = brute_force(dir, [&](const string &line) {
+            return regex_search(line, matcher);
+        });
+        assert(not expected.empty());
+        assert(sorted_lines(answer(builder, query)) == expected);
+    }
+    assert(answer(builder, "@re zz+top") == "zz+top Not Found.\n");
+    filesystem::remove_all(dir);
+}
+
+/*
+ * Saved indexes: an index read back with --load-index answers every query
+ * exactly as the build that saved it
+ */
+void load_index_matches_build()
+{
+    string dir = sample_tree("gerp_unit_load");
+    string indexFile = dir + ".index";
+    IndexBuilder built;
+    built.build(dir);
+    built.saveIndex(indexFile);
+    IndexBuilder loaded;
+    loaded.loadIndex(indexFile);
+    for (const string &query : sample_queries()) {
+        assert(answer(loaded, query) == answer(built, query));
+    }
+    assert(answer(built, "cat").find("Not Found") == string::npos);
+    filesystem::remove(indexFile);
+    filesystem::remove_all(dir);
+}
+
+/*
+ * Memory budgets: a build held to 1MB, as --memory-budget 1 is, spills runs
+ * to disk and merges them, and saves an index byte for byte the same as
+ * the one an in memory build saves
+ */
+void memory_budget_matches_build()
+{
+    vector<pair<string, string>> files;
+    mt19937 rng(15);
+    uniform_int_distribution<int> letter('a', 'z'), length(1, 9);
+    for (int f = 0; f < 40; f++) {
+        string text;
+        while (text.size() < 40000) {
+            for (int k = length(rng); k > 0; k--) {
+                text += (char)letter(rng);
+            }
+            text += letter(rng) < 'd' ? "\n" : " ";
+        }
+        files.push_back({"d" + to_string(f % 4) + "/f" + to_string(f) +
+                         ".txt", text});
+    }
+    string dir = make_tree("gerp_unit_budget", files);
+    string whole = dir + ".whole", budgeted = dir + ".budget";
+    IndexBuilder inMemory;
+    inMemory.build(dir);
+    inMemory.saveIndex(whole);
+    IndexBuilder spilled;
+    spilled.setMemoryBudget(1 << 20);
+    spilled.build(dir);
+    spilled.saveIndex(budgeted);
+
+    ifstream first(whole, ios::binary), second(budgeted, ios::binary);
+    string firstBytes((istreambuf_iterator<char>(first)),
+                      istreambuf_iterator<char>());
+    string secondBytes((istreambuf_iterator<char>(second)),
+                       istreambuf_iterator<char>());
+    assert(not firstBytes.empty());
+    assert(firstBytes == secondBytes);
+    filesystem::remove(whole);
+    filesystem::remove(budgeted);
+    filesystem::remove_all(dir);
+}
+
+/*
+ * Updates: after files are changed, added and removed, an updated index
+ * finds the same lines as a fresh build of the directory. Too few files
+ * change for a compaction, so the new segment's lines may come last and
+ * the outputs are compared sorted
+ */
+void update_matches_build()
+{
+    string dir = sample_tree("gerp_unit_update");
+    for (int i = 0; i < 8; i++) {
+        ofstream(dir + "/filler" + to_string(i) + ".txt") << "cat table\n";
+    }
+    IndexBuilder updated;
+    updated.build(dir);
+    ofstream(dir + "/notes.txt") << "The cat sat again.\nno hash here\n";
+    filesystem::create_directories(dir + "/added");
+    ofstream(dir + "/added/new.txt") << "hash table cat\nrecieve\n";
+    filesystem::remove(dir + "/zed.txt");
+    updated.update(dir);
+
+    IndexBuilder fresh;
+    fresh.build(dir);
+    for (const string &query : sample_queries()) {
+        assert(sorted_lines(answer(updated, query)) ==
+               sorted_lines(answer(fresh, query)));
+    }
+    assert(answer(updated, "again").find("notes.txt") != string::npos);
+    filesystem::remove_all(dir);
+}
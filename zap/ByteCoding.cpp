@@ -0,0 +1,231 @@
+/*
+ *  ByteCoding.cpp
+ *  Harrison Tun
+ *
+ *  COMP 15 Proj Zap
+ *
+ *  Purpose: Implementation of the varint, fixed width and bit packing
+ *           helpers declared in ByteCoding.h.
+ *
+ */
+
+#include "ByteCoding.h"
+#include <stdexcept>
+
+/*
+ * name:      writeVarint( )
+ * purpose:   appends n to out as a LEB128 varint
+ * arguments: the string to append to and the number
+ * returns:   NADA
+ * effects:   grows out by one to ten bytes
+ */
+void writeVarint(string &out, uint64_t n) {
+    while (n >= 0x80) {
+        out += (char)((n & 0x7f) | 0x80);
+        n >>= 7;
+    }
+    out += (char)n;
+}
+
+/*
+ * name:      readVarint( )
+ * purpose:   reads a varint made by writeVarint( )
+ * arguments: the string to read and the position to start at
+ * returns:   the number
+ * effects:   moves pos past the number, throws a runtime_error if in ends
+ *            first or the number doesn't fit in 64 bits
+ */
+uint64_t readVarint(const string &in, size_t &pos) {
+    uint64_t n = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= in.size()) {
+            throw runtime_error("Zap data is truncated.");
+        }
+        unsigned char byte = in[pos++];
+        n |= (uint64_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return n;
+        }
+    }
+    throw runtime_error("Zap data holds a malformed number.");
+}
+
+/*
+ * name:      writeU32( )
+ * purpose:   appends n to out as 4 little endian bytes
+ * arguments: the string to append to and the number
+ * returns:   NADA
+ * effects:   grows out by four bytes
+ */
+void writeU32(string &out, uint32_t n) {
+    for (int i = 0; i < 4; i++) {
+        out += (char)((n >> (8 * i)) & 0xff);
+    }
+}
+
+/*
+ * name:      readU32( )
+ * purpose:   reads a number written by writeU32( )
+ * arguments: the string to read and the position to start at
+ * returns:   the number
+ * effects:   moves pos past the number, throws a runtime_error if in ends
+ *            first
+ */
+uint32_t readU32(const string &in, size_t &pos) {
+    if (pos > in.size() or in.size() - pos < 4) {
+        throw runtime_error("Zap data is truncated.");
+    }
+    uint32_t n = 0;
+    for (int i = 0; i < 4; i++) {
+        n |= (uint32_t)(unsigned char)in[pos++] << (8 * i);
+    }
+    return n;
+}
+
+/*
+ * BitWriter constructor: starts with no bits written
+ */
+BitWriter::BitWriter() {
+    acc = 0;
+    pending = 0;
+    count = 0;
+}
+
+/*
+ * name:      put( )
+ * purpose:   appends the low len bits of value, most significant first
+ * arguments: the code bits and how many of them to write (at most 64)
+ * returns:   NADA
+ * effects:   whole bytes are moved to out as they fill
+ */
+void BitWriter::put(uint64_t value, int len) {
+    //split long codes so acc never has to hold more than 39 bits
+    if (len > 32) {
+        put(value >> 32, len - 32);
+        len = 32;
+    }
+    acc = (acc << len) | (value & ((1ULL << len) - 1));
+    pending += len;
+    count += len;
+    while (pending >= 8) {
+        pending -= 8;
+        out += (char)(acc >> pending);
+    }
+}
+
+/*
+ * name:      finish( )
+ * purpose:   pads the last partial byte with zeros and writes it out
+ * arguments: NADA
+ * returns:   NADA
+ * effects:   no more bits should be put after this
+ */
+void BitWriter::finish() {
+    if (pending > 0) {
+        out += (char)(acc << (8 - pending));
+        pending = 0;
+    }
+}
+
+/*
+ * name:      bitCount( )
+ * purpose:   tells how many bits have been put, not counting padding
+ * arguments: NADA
+ * returns:   the number of bits
+ * effects:   NADA
+ */
+size_t BitWriter::bitCount() {
+    return count;
+}
+
+/*
+ * name:      bytes( )
+ * purpose:   gives the packed bytes, complete once finish( ) is called
+ * arguments: NADA
+ * returns:   a reference to the bytes, which callers may move from
+ * effects:   NADA
+ */
+string &BitWriter::bytes() {
+    return out;
+}
+
+/*
+ * BitReader constructor: reads bits bits packed in bytes, starting with
+ * the most significant bit of the first byte
+ */
+BitReader::BitReader(const char *bytes, size_t bits) {
+    data = (const unsigned char *)bytes;
+    bitLen = bits;
+    bitPos = 0;
+}
+
+/*
+ * name:      peek( )
+ * purpose:   looks at the next len bits without consuming them
+ * arguments: the number of bits, at most 32
+ * returns:   the bits, zeros past the end of the input
+ * effects:   NADA
+ */
+uint32_t BitReader::peek(int len) {
+    size_t byte = bitPos / 8;
+    size_t byteLen = (bitLen + 7) / 8;
+    uint64_t window = 0;
+    for (int i = 0; i < 8; i++) {
+        window <<= 8;
+        if (byte + i < byteLen) {
+            window |= data[byte + i];
+        }
+    }
+    window <<= bitPos % 8;
+    return window >> (64 - len);
+}
+
+/*
+ * name:      skip( )
+ * purpose:   consumes len bits, usually after peek( )
+ * arguments: the number of bits
+ * returns:   NADA
+ * effects:   may move past the end, which overran( ) reports
+ */
+void BitReader::skip(int len) {
+    bitPos += len;
+}
+
+/*
+ * name:      bit( )
+ * purpose:   reads one bit
+ * arguments: NADA
+ * returns:   the bit, or 0 past the end of the input
+ * effects:   advances by one bit
+ */
+int BitReader::bit() {
+    if (bitPos >= bitLen) {
+        bitPos++;
+        return 0;
+    }
+    int b = (data[bitPos / 8] >> (7 - bitPos % 8)) & 1;
+    bitPos++;
+    return b;
+}
+
+/*
+ * name:      overran( )
+ * purpose:   tells whether more bits were read than the input holds
+ * arguments: NADA
+ * returns:   true if the reader went past bitLen
+ * effects:   NADA
+ */
+bool BitReader::overran() {
+    return bitPos > bitLen;
+}
+
+/*
+ * name:      position( )
+ * purpose:   tells how many bits have been consumed
+ * arguments: NADA
+ * returns:   the bit position
+ * effects:   NADA
+ */
+size_t BitReader::position() {
+    return bitPos;
+}
@@ -0,0 +1,73 @@
+/*
+ *  ByteCoding.h
+ *  Harrison Tun
+ *
+ *  COMP 15 Proj Zap
+ *
+ *  Purpose: Helpers for writing numbers into, and reading them back out of,
+ *           the byte strings that zap's delta and word modes build. Numbers
+ *           are LEB128 varints: seven bits per byte, with the high bit set
+ *           on every byte but the last, so small numbers take one byte.
+ *           Also holds BitWriter and BitReader, which pack Huffman codes
+ *           eight to a byte, most significant bit first.
+ *
+ */
+#ifndef _BYTE_CODING
+#define _BYTE_CODING
+
+#include <cstdint>
+#include <string>
+using namespace std;
+
+/* Appends n to out as a varint. */
+void writeVarint(string &out, uint64_t n);
+
+/* Reads a varint from in starting at pos and moves pos past it.
+ * Possible exception: throws a runtime_error if in ends in the middle of
+ * the number or the number doesn't fit in 64 bits.
+ */
+uint64_t readVarint(const string &in, size_t &pos);
+
+/* Appends n to out as 4 little endian bytes, and reads such a number back.
+ * readU32 throws a runtime_error if in ends before the number does.
+ */
+void writeU32(string &out, uint32_t n);
+uint32_t readU32(const string &in, size_t &pos);
+
+/*
+ * Packs codes into bytes. put( ) takes the low len bits of value, most
+ * significant first. finish( ) pads the last byte with zeros.
+ */
+class BitWriter {
+    public:
+        BitWriter();
+        void put(uint64_t value, int len);
+        void finish();
+        size_t bitCount();
+        string &bytes();
+    private:
+        string out;
+        uint64_t acc;  //bits not yet written to out
+        int pending;   //number of valid bits in acc, always < 8 between puts
+        size_t count;
+};
+
+/*
+ * Reads bits back out of bytes packed by BitWriter. Reading past bitLen
+ * yields zeros; overran( ) tells if that has happened.
+ */
+class BitReader {
+    public:
+        BitReader(const char *data, size_t bitLen);
+        uint32_t peek(int len); //len is at most 32
+        void skip(int len);
+        int bit();
+        bool overran();
+        size_t position();
+    private:
+        const unsigned char *data;
+        size_t bitLen;
+        size_t bitPos;
+};
+
+#endif
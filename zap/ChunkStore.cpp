@@ -0,0 +1,255 @@
+/*
+ *  ChunkStore.cpp
+ *  Harrison Tun
+ *
+ *  COMP 15 Proj Zap
+ *
+ *  Purpose: This file is the implementation of the ChunkStore class. Chunk
+ *           boundaries are picked with a gear rolling hash (FastCDC style
+ *           normalized chunking), so an insertion near the start of a file
+ *           only changes the chunks around it. Chunks are deduplicated by a
+ *           64 bit fingerprint, and a fingerprint match is always confirmed
+ *           by comparing the bytes, so a hash collision can never corrupt an
+ *           archive.
+ *
+ */
+
+#include "ChunkStore.h"
+#include "ByteCoding.h"
+#include <cstring>
+#include <stdexcept>
+
+//the cut masks used before and after the average chunk size. The stricter
+//mask makes small chunks unlikely, the looser one makes huge chunks unlikely
+static const uint64_t MASK_SMALL = 0x0003590703530000ULL; //15 bits set
+static const uint64_t MASK_LARGE = 0x0000d90003530000ULL; //11 bits set
+
+/*
+ * ChunkStore constructor: fills the gear table with fixed pseudo random
+ * values (splitmix64), so the same input is always cut at the same places.
+ */
+ChunkStore::ChunkStore() {
+    uint64_t seed = 0x5a4150u;
+    for (int i = 0; i < 256; i++) {
+        seed += 0x9e3779b97f4a7c15ULL;
+        uint64_t z = seed;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        gear[i] = z ^ (z >> 31);
+    }
+}
+
+/*
+ * name:      addFile( )
+ * purpose:   Splits a file into content defined chunks and remembers the
+ *            file as a list of references to stored chunks.
+ * arguments: the name to store the file under and the file's contents
+ * returns:   NADA
+ * effects:   new chunks are added to the store
+ */
+void ChunkStore::addFile(const string &name, const string &contents) {
+    fileEntry entry;
+    entry.name = name;
+    size_t start = 0;
+    while (start < contents.size()) {
+        size_t end = nextCut(contents, start);
+        entry.refs.push_back(storeChunk(contents, start, end - start));
+        start = end;
+    }
+    files.push_back(entry);
+}
+
+/*
+ * name:      nextCut( )
+ * purpose:   finds the end of the chunk that begins at start
+ * arguments: the data being chunked and the start of the current chunk
+ * returns:   index one past the last byte of the chunk
+ * effects:   NADA
+ */
+size_t ChunkStore::nextCut(const string &data, size_t start) {
+    size_t remaining = data.size() - start;
+    if (remaining <= MIN_CHUNK) {
+        return data.size();
+    }
+    size_t limit = start + (remaining < MAX_CHUNK ? remaining : MAX_CHUNK);
+    size_t normal = start + AVG_CHUNK < limit ? start + AVG_CHUNK : limit;
+    uint64_t hash = 0;
+    size_t i = start + MIN_CHUNK;
+    for (; i < normal; i++) {
+        hash = (hash << 1) + gear[(unsigned char)data[i]];
+        if ((hash & MASK_SMALL) == 0) {
+            return i + 1;
+        }
+    }
+    for (; i < limit; i++) {
+        hash = (hash << 1) + gear[(unsigned char)data[i]];
+        if ((hash & MASK_LARGE) == 0) {
+            return i + 1;
+        }
+    }
+    return limit;
+}
+
+/*
+ * name:      storeChunk( )
+ * purpose:   stores a chunk unless an identical chunk is already stored
+ * arguments: the data, and the start and length of the chunk in it
+ * returns:   the index of the stored copy of the chunk
+ * effects:   may add a chunk and a fingerprint entry
+ */
+uint32_t ChunkStore::storeChunk(const string &data, size_t start,
+                                size_t len) {
+    uint64_t print = fingerprint(data.data() + start, len);
+    vector<uint32_t> &candidates = fingerprints[print];
+    for (uint32_t index : candidates) {
+        //confirm the match so a collision can't alias two chunks
+        if (chunks[index].size() == len and
+            memcmp(chunks[index].data(), data.data() + start, len) == 0) {
+            return index;
+        }
+    }
+    chunks.push_back(data.substr(start, len));
+    candidates.push_back(chunks.size() - 1);
+    return chunks.size() - 1;
+}
+
+/*
+ * name:      fingerprint( )
+ * purpose:   64 bit FNV-1a hash of a chunk
+ * arguments: pointer to the chunk and its length
+ * returns:   the fingerprint
+ * effects:   NADA
+ */
+uint64_t ChunkStore::fingerprint(const char *data, size_t len) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/*
+ * name:      serialize( )
+ * purpose:   Lays out the store as one string: the file table (names and
+ *            chunk references), the chunk lengths, then every unique chunk
+ *            back to back. All numbers are 32 bit little endian (see
+ *            writeU32 in ByteCoding.h).
+ * arguments: NADA
+ * returns:   the serialized store
+ * effects:   NADA
+ */
+string ChunkStore::serialize() {
+    string out;
+    writeU32(out, files.size());
+    for (fileEntry &file : files) {
+        writeU32(out, file.name.size());
+        out += file.name;
+        writeU32(out, file.refs.size());
+        for (uint32_t ref : file.refs) {
+            writeU32(out, ref);
+        }
+    }
+    writeU32(out, chunks.size());
+    for (string &chunk : chunks) {
+        writeU32(out, chunk.size());
+    }
+    for (string &chunk : chunks) {
+        out += chunk;
+    }
+    return out;
+}
+
+/*
+ * name:      deserialize( )
+ * purpose:   rebuilds a store from the output of serialize
+ * arguments: the serialized store
+ * returns:   NADA
+ * effects:   replaces the contents of the store, throws a runtime_error if
+ *            the payload is truncated or references a missing chunk
+ */
+void ChunkStore::deserialize(const string &payload) {
+    files.clear();
+    chunks.clear();
+    fingerprints.clear();
+    size_t pos = 0;
+    uint32_t fileCount = readU32(payload, pos);
+    for (uint32_t i = 0; i < fileCount; i++) {
+        fileEntry file;
+        uint32_t nameLen = readU32(payload, pos);
+        if (payload.size() - pos < nameLen) {
+            throw runtime_error("Archive is truncated.");
+        }
+        file.name = payload.substr(pos, nameLen);
+        pos += nameLen;
+        uint32_t refCount = readU32(payload, pos);
+        for (uint32_t j = 0; j < refCount; j++) {
+            file.refs.push_back(readU32(payload, pos));
+        }
+        files.push_back(file);
+    }
+    uint32_t chunkCount = readU32(payload, pos);
+    if ((payload.size() - pos) / 4 < chunkCount) {
+        throw runtime_error("Archive is truncated.");
+    }
+    vector<uint32_t> lengths(chunkCount);
+    for (uint32_t &len : lengths) {
+        len = readU32(payload, pos);
+    }
+    for (uint32_t len : lengths) {
+        if (payload.size() - pos < len) {
+            throw runtime_error("Archive is truncated.");
+        }
+        chunks.push_back(payload.substr(pos, len));
+        pos += len;
+    }
+    for (fileEntry &file : files) {
+        for (uint32_t ref : file.refs) {
+            if (ref >= chunks.size()) {
+                throw runtime_error("Archive references a missing chunk.");
+            }
+        }
+    }
+}
+
+/*
+ * getters for the files in the store
+ */
+int ChunkStore::numFiles() {
+    return files.size();
+}
+
+string ChunkStore::getFileName(int n) {
+    return files.at(n).name;
+}
+
+/*
+ * name:      getFileContents( )
+ * purpose:   puts a file back together from its chunk references
+ * arguments: index of the file
+ * returns:   the file's contents
+ * effects:   NADA
+ */
+string ChunkStore::getFileContents(int n) {
+    string contents;
+    for (uint32_t ref : files.at(n).refs) {
+        contents += chunks[ref];
+    }
+    return contents;
+}
+
+/*
+ * number of unique chunks stored, and number of chunk references made by
+ * all files (the difference is how many chunks were deduplicated)
+ */
+size_t ChunkStore::numChunks() {
+    return chunks.size();
+}
+
+size_t ChunkStore::numReferences() {
+    size_t total = 0;
+    for (fileEntry &file : files) {
+        total += file.refs.size();
+    }
+    return total;
+}
@@ -0,0 +1,58 @@
+/*
+ *  ChunkStore.h
+ *  Harrison Tun
+ *
+ *  COMP 15 Proj Zap
+ *
+ *  Purpose: This is the header file for the ChunkStore class. A ChunkStore
+ *           splits files into content-defined chunks using a rolling (gear)
+ *           hash, so that identical regions in different files are cut at
+ *           the same places. Every chunk is fingerprinted and only stored
+ *           once; each file is then remembered as a list of references to
+ *           the stored chunks.
+ *
+ */
+#ifndef _CHUNK_STORE
+#define _CHUNK_STORE
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+class ChunkStore {
+    public:
+        ChunkStore();
+        void addFile(const string &name, const string &contents);
+        string serialize();
+        void deserialize(const string &payload);
+        int numFiles();
+        string getFileName(int n);
+        string getFileContents(int n);
+        size_t numChunks();
+        size_t numReferences();
+
+        //chunk size limits in bytes, the average is roughly AVG_CHUNK. A
+        //file's last chunk may be shorter than MIN_CHUNK
+        static const size_t MIN_CHUNK = 2 * 1024;
+        static const size_t AVG_CHUNK = 8 * 1024;
+        static const size_t MAX_CHUNK = 64 * 1024;
+    private:
+        struct fileEntry {
+            string name;
+            vector<uint32_t> refs; //indices into chunks
+        };
+
+        uint64_t gear[256];
+        vector<string> chunks;
+        vector<fileEntry> files;
+        //fingerprint -> every stored chunk with that fingerprint
+        unordered_map<uint64_t, vector<uint32_t>> fingerprints;
+
+        size_t nextCut(const string &data, size_t start);
+        uint32_t storeChunk(const string &data, size_t start, size_t len);
+        uint64_t fingerprint(const char *data, size_t len);
+};
+
+#endif
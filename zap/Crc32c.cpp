@@ -0,0 +1,161 @@
+/*
+ *  Crc32c.cpp
+ *  Harrison Tun
+ *
+ *  COMP 15 Proj Zap
+ *
+ *  Purpose: Implementation of crc32c( ). The first call checks once whether
+ *           the CPU has SSE4.2 and every later call goes straight to the
+ *           chosen version. crc32cPortable( ) always uses the tables,
+ *           so tests can hold the two versions to each other.
+ *
+ */
+
+#include "Crc32c.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define ZAP_HAVE_SSE42_PATH 1
+#endif
+
+//reflected Castagnoli polynomial
+static const uint32_t POLY = 0x82f63b78;
+
+static uint32_t table[8][256];
+
+/*
+ * name:      buildTable( )
+ * purpose:   fills the eight 256 entry tables used by slicing-by-8. table[0]
+ *            is the classic byte at a time table; table[k] advances a byte
+ *            through k more zero bytes.
+ * arguments: NADA
+ * returns:   NADA
+ * effects:   fills table
+ */
+static void buildTable() {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ ((crc & 1) ? POLY : 0);
+        }
+        table[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int k = 1; k < 8; k++) {
+            table[k][i] = (table[k - 1][i] >> 8) ^
+                          table[0][table[k - 1][i] & 0xff];
+        }
+    }
+}
+
+/*
+ * name:      crcSlicing8( )
+ * purpose:   portable CRC-32C, eight bytes per step
+ * arguments: the data and its length
+ * returns:   the checksum
+ * effects:   NADA
+ */
+static uint32_t crcSlicing8(const unsigned char *p, size_t len) {
+    uint32_t crc = 0xffffffff;
+    while (len >= 8) {
+        uint32_t lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+        lo ^= crc; //assumes a little endian host, like the rest of zap
+        crc = table[7][lo & 0xff] ^ table[6][(lo >> 8) & 0xff] ^
+              table[5][(lo >> 16) & 0xff] ^ table[4][lo >> 24] ^
+              table[3][hi & 0xff] ^ table[2][(hi >> 8) & 0xff] ^
+              table[1][(hi >> 16) & 0xff] ^ table[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len-- > 0) {
+        crc = (crc >> 8) ^ table[0][(crc ^ *p++) & 0xff];
+    }
+    return ~crc;
+}
+
+#ifdef ZAP_HAVE_SSE42_PATH
+/*
+ * name:      crcHardware( )
+ * purpose:   CRC-32C with the SSE4.2 crc32 instruction, eight bytes per
+ *            instruction on 64 bit builds
+ * arguments: the data and its length
+ * returns:   the checksum
+ * effects:   NADA
+ */
+__attribute__((target("sse4.2")))
+static uint32_t crcHardware(const unsigned char *p, size_t len) {
+#if defined(__x86_64__)
+    uint64_t crc = 0xffffffff;
+    while (len >= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        crc = _mm_crc32_u64(crc, word);
+        p += 8;
+        len -= 8;
+    }
+    uint32_t crc32 = crc;
+#else
+    uint32_t crc32 = 0xffffffff;
+#endif
+    while (len-- > 0) {
+        crc32 = _mm_crc32_u8(crc32, *p++);
+    }
+    return ~crc32;
+}
+#endif
+
+/*
+ * name:      useHardware( )
+ * purpose:   builds the tables and checks for SSE4.2, the first time only
+ * arguments: NADA
+ * returns:   true if crc32c( ) should use the crc32 instruction
+ * effects:   fills table on the first call
+ */
+static bool useHardware() {
+    //function local statics are initialized once, even across threads
+    static const bool hardware = []() {
+        buildTable();
+#ifdef ZAP_HAVE_SSE42_PATH
+        return (bool)__builtin_cpu_supports("sse4.2");
+#else
+        return false;
+#endif
+    }();
+    return hardware;
+}
+
+/*
+ * name:      crc32c( )
+ * purpose:   computes the CRC-32C of a buffer with the crc32 instruction
+ *            when the CPU has it, and the tables otherwise
+ * arguments: the bytes and their number
+ * returns:   the checksum
+ * effects:   builds the tables on the first call
+ */
+uint32_t crc32c(const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char *)data;
+#ifdef ZAP_HAVE_SSE42_PATH
+    if (useHardware()) {
+        return crcHardware(p, len);
+    }
+#else
+    useHardware();
+#endif
+    return crcSlicing8(p, len);
+}
+
+/*
+ * name:      crc32cPortable( )
+ * purpose:   computes the CRC-32C with the tables whatever the CPU has,
+ *            so tests can hold crc32c( ) to it
+ * arguments: the bytes and their number
+ * returns:   the checksum
+ * effects:   builds the tables on the first call
+ */
+uint32_t crc32cPortable(const void *data, size_t len) {
+    useHardware();
+    return crcSlicing8((const unsigned char *)data, len);
+}
@@ -0,0 +1,26 @@
+/*
+ *  Crc32c.h
+ *  Harrison Tun
+ *
+ *  COMP 15 Proj Zap
+ *
+ *  Purpose: CRC-32C (Castagnoli) checksums for zap blocks. On x86 CPUs with
+ *           SSE4.2 the crc32 instruction is used; everywhere else a table
+ *           driven slicing-by-8 version computes the same value.
+ *
+ */
+#ifndef _CRC32C
+#define _CRC32C
+
+#include <cstddef>
+#include <cstdint>
+
+/* Returns the CRC-32C of len bytes starting at data. */
+uint32_t crc32c(const void *data, size_t len);
+
+/* The table driven version on its own, whatever the CPU has; crc32c( )
+ * must always agree with it.
+ */
+uint32_t crc32cPortable(const void *data, size_t len);
+
+#endif
@@ -0,0 +1,224 @@
+/*
+ *  DeltaCoder.cpp
+ *  Harrison Tun
+ *
+ *  COMP 15 Proj Zap
+ *
+ *  Purpose: This file is the implementation of the DeltaCoder class. The
+ *           reference is indexed by hashing a 16 byte window every 8 bytes.
+ *           The target is scanned with a rolling hash of the same window, and
+ *           every hit is checked, extended forwards and backwards, and turned
+ *           into a copy. Bytes that no copy covers become inserts.
+ *
+ *           Delta layout (integers are LEB128 varints):
+ *               "ZAPDLT1" refLength refChecksum(8 bytes) targetLength
+ *               then operations until targetLength bytes are produced:
+ *                   'C' offset length          copy from the reference
+ *                   'I' length bytes...        insert literal bytes
+ *
+ */
+
+#include "DeltaCoder.h"
+#include "ByteCoding.h"
+#include <cstring>
+#include <stdexcept>
+
+static const string DELTA_TAG = "ZAPDLT1";
+//multiplier of the rolling polynomial hash
+static const uint64_t ROLL_BASE = 0x100000001b3ULL;
+
+/*
+ * name:      diff( )
+ * purpose:   Encodes target as copy and insert operations against reference.
+ * arguments: the old version and the new version of a file
+ * returns:   the delta, in the layout described at the top of this file
+ * effects:   rebuilds the reference index
+ */
+string DeltaCoder::diff(const string &reference, const string &target) {
+    string delta = DELTA_TAG;
+    writeVarint(delta, reference.size());
+    uint64_t sum = checksum(reference);
+    delta.append((const char *)&sum, sizeof(sum));
+    writeVarint(delta, target.size());
+
+    uint64_t outPower = 1; //ROLL_BASE^(MIN_MATCH - 1)
+    for (size_t k = 1; k < MIN_MATCH; k++) {
+        outPower *= ROLL_BASE;
+    }
+    buildIndex(reference);
+    size_t literalStart = 0;
+    size_t i = 0;
+    bool canMatch = reference.size() >= MIN_MATCH and
+                    target.size() >= MIN_MATCH;
+    uint64_t hash = canMatch ? windowHash(target.data()) : 0;
+    while (canMatch and i + MIN_MATCH <= target.size()) {
+        uint32_t slot = index[((hash * 0x9e3779b97f4a7c15ULL) >> 32) &
+                              indexMask];
+        size_t off = slot - 1;
+        if (slot != 0 and memcmp(reference.data() + off, target.data() + i,
+                                 MIN_MATCH) == 0) {
+            size_t len = MIN_MATCH;
+            while (i + len < target.size() and off + len < reference.size()
+                   and reference[off + len] == target[i + len]) {
+                len++;
+            }
+            //grow backwards over bytes that were about to be inserted
+            size_t back = 0;
+            while (back < i - literalStart and back < off and
+                   reference[off - back - 1] == target[i - back - 1]) {
+                back++;
+            }
+            emitInsert(delta, target, literalStart, i - back);
+            emitCopy(delta, off - back, len + back);
+            i += len;
+            literalStart = i;
+            if (i + MIN_MATCH <= target.size()) {
+                hash = windowHash(target.data() + i);
+            }
+            continue;
+        }
+        if (i + MIN_MATCH < target.size()) {
+            //roll the window one byte forward
+            hash -= (unsigned char)target[i] * outPower;
+            hash = hash * ROLL_BASE + (unsigned char)target[i + MIN_MATCH];
+        }
+        i++;
+    }
+    emitInsert(delta, target, literalStart, target.size());
+    return delta;
+}
+
+/*
+ * name:      apply( )
+ * purpose:   Rebuilds the new version of a file from its delta.
+ * arguments: the old version and a delta made by diff( ) against it
+ * returns:   the new version
+ * effects:   throws a runtime_error if the delta is damaged or was made
+ *            against a different reference
+ */
+string DeltaCoder::apply(const string &reference, const string &delta) {
+    if (delta.compare(0, DELTA_TAG.size(), DELTA_TAG) != 0) {
+        throw runtime_error("File is not a zap delta.");
+    }
+    size_t pos = DELTA_TAG.size();
+    uint64_t refLength = readVarint(delta, pos);
+    uint64_t sum;
+    if (delta.size() - pos < sizeof(sum)) {
+        throw runtime_error("Delta is truncated.");
+    }
+    memcpy(&sum, delta.data() + pos, sizeof(sum));
+    pos += sizeof(sum);
+    if (refLength != reference.size() or sum != checksum(reference)) {
+        throw runtime_error("Reference file does not match the one the "
+                            "delta was made against.");
+    }
+    uint64_t targetLength = readVarint(delta, pos);
+    string target;
+    while (target.size() < targetLength) {
+        if (pos >= delta.size()) {
+            throw runtime_error("Delta is truncated.");
+        }
+        char op = delta[pos++];
+        if (op == 'C') {
+            uint64_t off = readVarint(delta, pos);
+            uint64_t len = readVarint(delta, pos);
+            if (off > reference.size() or len > reference.size() - off) {
+                throw runtime_error("Delta copies past end of reference.");
+            }
+            target.append(reference, off, len);
+        } else if (op == 'I') {
+            uint64_t len = readVarint(delta, pos);
+            if (len > delta.size() - pos) {
+                throw runtime_error("Delta is truncated.");
+            }
+            target.append(delta, pos, len);
+            pos += len;
+        } else {
+            throw runtime_error("Delta holds an unknown operation.");
+        }
+    }
+    if (target.size() != targetLength) {
+        throw runtime_error("Delta overruns the target length.");
+    }
+    return target;
+}
+
+/*
+ * name:      buildIndex( )
+ * purpose:   hashes every INDEX_STEP'th window of the reference into an
+ *            open table, keeping the first offset seen for each slot
+ * arguments: the reference
+ * returns:   NADA
+ * effects:   replaces index and indexMask
+ */
+void DeltaCoder::buildIndex(const string &reference) {
+    size_t windows = reference.size() / INDEX_STEP + 1;
+    size_t size = 1024;
+    while (size < 2 * windows) {
+        size *= 2;
+    }
+    index.assign(size, 0);
+    indexMask = size - 1;
+    for (size_t pos = 0; pos + MIN_MATCH <= reference.size();
+         pos += INDEX_STEP) {
+        uint64_t hash = windowHash(reference.data() + pos);
+        uint32_t &slot = index[((hash * 0x9e3779b97f4a7c15ULL) >> 32) &
+                               indexMask];
+        if (slot == 0) {
+            slot = pos + 1;
+        }
+    }
+}
+
+/*
+ * name:      windowHash( )
+ * purpose:   polynomial hash of MIN_MATCH bytes, the same value the rolling
+ *            update in diff( ) produces
+ * arguments: pointer to the first byte of the window
+ * returns:   the hash
+ * effects:   NADA
+ */
+uint64_t DeltaCoder::windowHash(const char *window) {
+    uint64_t hash = 0;
+    for (size_t k = 0; k < MIN_MATCH; k++) {
+        hash = hash * ROLL_BASE + (unsigned char)window[k];
+    }
+    return hash;
+}
+
+/*
+ * emit helpers: append one insert or copy operation to the delta. Empty
+ * inserts are skipped.
+ */
+void DeltaCoder::emitInsert(string &delta, const string &target,
+                            size_t start, size_t end) {
+    if (start >= end) {
+        return;
+    }
+    delta += 'I';
+    writeVarint(delta, end - start);
+    delta.append(target, start, end - start);
+}
+
+void DeltaCoder::emitCopy(string &delta, size_t offset, size_t len) {
+    delta += 'C';
+    writeVarint(delta, offset);
+    writeVarint(delta, len);
+}
+
+/*
+ * name:      checksum( )
+ * purpose:   64 bit FNV-1a hash, used to catch unzapping against the wrong
+ *            reference file
+ * arguments: the data to hash
+ * returns:   the hash
+ * effects:   NADA
+ */
+uint64_t DeltaCoder::checksum(const string &data) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const char &c : data) {
+        hash ^= (unsigned char)c;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
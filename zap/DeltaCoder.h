@@ -0,0 +1,42 @@
+/*
+ *  DeltaCoder.h
+ *  Harrison Tun
+ *
+ *  COMP 15 Proj Zap
+ *
+ *  Purpose: This is the header file for the DeltaCoder class. A DeltaCoder
+ *           describes a new version of a file as a list of copy operations
+ *           (take bytes from the old version) and insert operations (new
+ *           literal bytes). The resulting delta is then Huffman coded by
+ *           HuffmanCoder like any other string.
+ *
+ */
+#ifndef _DELTA_CODER
+#define _DELTA_CODER
+
+#include <cstdint>
+#include <string>
+#include <vector>
+using namespace std;
+
+class DeltaCoder {
+    public:
+        string diff(const string &reference, const string &target);
+        string apply(const string &reference, const string &delta);
+    private:
+        //shortest match worth a copy, and the spacing of indexed windows
+        static const size_t MIN_MATCH = 16;
+        static const size_t INDEX_STEP = 8;
+
+        vector<uint32_t> index; //window hash -> reference offset + 1
+        uint64_t indexMask;
+
+        void buildIndex(const string &reference);
+        uint64_t windowHash(const char *window);
+        void emitInsert(string &delta, const string &target, size_t start,
+                        size_t end);
+        void emitCopy(string &delta, size_t offset, size_t len);
+        uint64_t checksum(const string &data);
+};
+
+#endif
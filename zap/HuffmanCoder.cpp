@@ -13,11 +13,25 @@
  */
 
 #include "HuffmanCoder.h"
+#include "ChunkStore.h"
+#include "DeltaCoder.h"
+#include "WordCoder.h"
+#include "Crc32c.h"
+#include <atomic>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <queue>
+#include <thread>
 #include <utility>
 const int ASCII_SIZE = 256;
+//bytes of input per block, each block is coded and checked on its own
+const size_t BLOCK_SIZE = 1 << 20;
+//first bytes of every archive payload, tells unarchive what it is reading
+const string ARCHIVE_TAG = "ZAPARC1";
+//a tree of 256 leaves is at most 255 internal nodes deep, so a serialized
+//tree nested deeper than this is damaged
+const int MAX_TREE_DEPTH = 256;
 
 /*
  * name:      encoder( )
@@ -28,32 +42,23 @@ const int ASCII_SIZE = 256;
  * effects:   NADA
  */
 void HuffmanCoder::encoder(const string &inputFile, const string &outputFile) {
-    int frequency[ASCII_SIZE] = {0};
     ifstream input(inputFile);
     if (not input) {
         throw std::runtime_error("Unable to open file " + inputFile);
     }
     //string that holds input file's content
+    startPhase("read");
     string input_string { istreambuf_iterator<char>(input), 
                           istreambuf_iterator<char>() };
+    endPhase(input_string.size());
     if (input_string.empty()) {
         cout << inputFile << " is empty and cannot be compressed." << endl;
         return;
     }
-    count_frequency(input_string, frequency); //counts freq of chars
-    HuffmanTreeNode *root = build(frequency); //builds tree
-    unordered_map<char, string> codes;
-    generateCodes(root, "", codes); //makes binary code
-    string encoded_data;
-    for (char&c : input_string) {
-        encoded_data += codes[c];
-    }
-    string serialized_tree = serialize_tree(root);
-    writeZapFile(outputFile, serialized_tree, encoded_data);
     input.close();
+    size_t bits = zapString(input_string, outputFile);
     cout << "Success! Encoded given text using " 
-    << encoded_data.length() << " bits." << endl;
-    deleteNodes(root); //inorder traversal function to delete tree
+    << bits << " bits." << endl;
 }
 /*
  * name:      Decoder( )
@@ -64,6 +69,220 @@ void HuffmanCoder::encoder(const string &inputFile, const string &outputFile) {
  * effects:   NADA
  */
 void HuffmanCoder::decoder(const string &inputFile, const string &outputFile) {
+    string decoded_data = unzapString(inputFile);
+    startPhase("write");
+    ofstream output(outputFile);
+    output << decoded_data;
+    output.close();
+    endPhase(decoded_data.size());
+}
+/*
+ * name:      wordEncoder( )
+ * purpose:   Encodes a text file with a Huffman code over whole tokens
+ *            rather than characters, which suits natural language text.
+ *            unzap recognizes these files on its own.
+ * arguments: reference to a input file and output file string 
+ * returns:   NADA
+ * effects:   throws a runtime_error if the input file can't be opened
+ */
+void HuffmanCoder::wordEncoder(const string &inputFile,
+                               const string &outputFile) {
+    string input_string = readWholeFile(inputFile);
+    if (input_string.empty()) {
+        cout << inputFile << " is empty and cannot be compressed." << endl;
+        return;
+    }
+    size_t bits = 0;
+    writeWholeFile(outputFile, compress(input_string, true, &bits));
+    cout << "Success! Encoded given text using " 
+    << bits << " bits." << endl;
+}
+/*
+ * name:      archive( )
+ * purpose:   Zaps several files into one archive. The files are split into
+ *            content defined chunks, every distinct chunk is kept once, and
+ *            the chunk table plus the unique chunks are Huffman coded.
+ * arguments: the files to archive and the archive to write
+ * returns:   NADA
+ * effects:   throws a runtime_error if an input file can't be opened
+ */
+void HuffmanCoder::archive(const vector<string> &inputFiles,
+                           const string &outputFile) {
+    ChunkStore store;
+    size_t total_bytes = 0;
+    for (const string &inputFile : inputFiles) {
+        string contents = readWholeFile(inputFile);
+        total_bytes += contents.size();
+        store.addFile(inputFile, contents);
+    }
+    size_t bits = zapString(ARCHIVE_TAG + store.serialize(), outputFile);
+    cout << "Success! Archived " << inputFiles.size() << " files ("
+    << total_bytes << " bytes, " << store.numChunks() << " of "
+    << store.numReferences() << " chunks unique) using " << bits
+    << " bits." << endl;
+}
+/*
+ * name:      unarchive( )
+ * purpose:   Restores every file in an archive made by archive( ) under the
+ *            given directory, keeping each file's relative path.
+ * arguments: the archive to read and the directory to write files to
+ * returns:   NADA
+ * effects:   creates directories as needed, throws a runtime_error if the
+ *            file isn't an archive or holds an unsafe path
+ */
+void HuffmanCoder::unarchive(const string &inputFile,
+                             const string &outputDir) {
+    string payload = unzapString(inputFile);
+    if (payload.compare(0, ARCHIVE_TAG.size(), ARCHIVE_TAG) != 0) {
+        throw runtime_error(inputFile + " is not a zap archive.");
+    }
+    ChunkStore store;
+    store.deserialize(payload.substr(ARCHIVE_TAG.size()));
+    for (int i = 0; i < store.numFiles(); i++) {
+        filesystem::path name = store.getFileName(i);
+        //never let an archive write outside of outputDir
+        if (name.is_absolute()) {
+            name = name.relative_path();
+        }
+        for (const filesystem::path &part : name) {
+            if (part == "..") {
+                throw runtime_error("Archive holds unsafe path " +
+                                    store.getFileName(i));
+            }
+        }
+        filesystem::path target = filesystem::path(outputDir) / name;
+        if (target.has_parent_path()) {
+            filesystem::create_directories(target.parent_path());
+        }
+        ofstream output(target, ios::binary);
+        if (not output) {
+            throw runtime_error("Unable to open file " + target.string());
+        }
+        output << store.getFileContents(i);
+    }
+}
+/*
+ * name:      deltaEncoder( )
+ * purpose:   Zaps a new version of a file as copy and insert operations
+ *            against an older version, then Huffman codes the operations.
+ * arguments: the reference (old) file, the new file, and the output file
+ * returns:   NADA
+ * effects:   throws a runtime_error if a file can't be opened
+ */
+void HuffmanCoder::deltaEncoder(const string &referenceFile,
+                                const string &inputFile,
+                                const string &outputFile) {
+    string reference = readWholeFile(referenceFile);
+    string target = readWholeFile(inputFile);
+    DeltaCoder delta;
+    size_t bits = zapString(delta.diff(reference, target), outputFile);
+    cout << "Success! Encoded given text against " << referenceFile
+    << " using " << bits << " bits." << endl;
+}
+/*
+ * name:      deltaDecoder( )
+ * purpose:   Unzaps a file made by deltaEncoder( ) using the same reference.
+ * arguments: the reference (old) file, the zapped delta, and the output file
+ * returns:   NADA
+ * effects:   throws a runtime_error if the reference is not the one the
+ *            delta was made against, or a file can't be opened
+ */
+void HuffmanCoder::deltaDecoder(const string &referenceFile,
+                                const string &inputFile,
+                                const string &outputFile) {
+    string reference = readWholeFile(referenceFile);
+    DeltaCoder delta;
+    writeWholeFile(outputFile, delta.apply(reference,
+                                           unzapString(inputFile)));
+}
+/*
+ * name:      setStats( )
+ * purpose:   makes later calls record their phases, code lengths and
+ *            entropy in zapStats
+ * arguments: the stats to fill in, or nullptr to stop recording
+ * returns:   NADA
+ * effects:   NADA
+ */
+void HuffmanCoder::setStats(ZapStats *zapStats) {
+    stats = zapStats;
+}
+/*
+ * phase helpers: time a phase in stats when stats are being recorded
+ */
+void HuffmanCoder::startPhase(const string &phase) {
+    if (stats != nullptr) {
+        stats->begin(phase);
+    }
+}
+
+void HuffmanCoder::endPhase(size_t bytes) {
+    if (stats != nullptr) {
+        stats->end(bytes);
+    }
+}
+/*
+ * name:      readWholeFile( )
+ * purpose:   reads a file into a string, byte for byte
+ * arguments: the file to read
+ * returns:   the file's contents
+ * effects:   throws a runtime_error if the file can't be opened
+ */
+string HuffmanCoder::readWholeFile(const string &inputFile) {
+    ifstream input(inputFile, ios::binary);
+    if (not input) {
+        throw std::runtime_error("Unable to open file " + inputFile);
+    }
+    startPhase("read");
+    string contents { istreambuf_iterator<char>(input), 
+                      istreambuf_iterator<char>() };
+    endPhase(contents.size());
+    return contents;
+}
+/*
+ * name:      writeWholeFile( )
+ * purpose:   writes a string to a file, byte for byte
+ * arguments: the file to write and its contents
+ * returns:   NADA
+ * effects:   throws a runtime_error if the file can't be opened
+ */
+void HuffmanCoder::writeWholeFile(const string &outputFile,
+                                  const string &contents) {
+    ofstream output(outputFile, ios::binary);
+    if (not output) {
+        throw std::runtime_error("Unable to open file " + outputFile);
+    }
+    startPhase("write");
+    output << contents;
+    output.close();
+    endPhase(contents.size());
+}
+/*
+ * name:      zapString( )
+ * purpose:   Huffman codes a string and writes it to a zap block file along
+ *            with the serialized tree.
+ * arguments: the data to encode and the file to write
+ * returns:   number of bits in the encoding
+ * effects:   NADA
+ */
+size_t HuffmanCoder::zapString(const string &data, const string &outputFile) {
+    size_t bits = 0;
+    writeWholeFile(outputFile, compress(data, false, &bits));
+    return bits;
+}
+/*
+ * name:      unzapString( )
+ * purpose:   Reads a zap file and decodes its contents with the model stored
+ *            in it. Files from before blocks existed are still read with
+ *            readZapFile.
+ * arguments: the zap file to read
+ * returns:   the decoded string
+ * effects:   throws a runtime_error if the encoding doesn't match the tree
+ *            or a block fails its checksum
+ */
+string HuffmanCoder::unzapString(const string &inputFile) {
+    if (isBlockFile(inputFile)) {
+        return decompress(readWholeFile(inputFile));
+    }
     pair<string, string> data = readZapFile(inputFile);
     string serialized_tree = data.first; //serialized tree string
     string encoded_data = data.second; //binary string
@@ -82,11 +301,307 @@ void HuffmanCoder::decoder(const string &inputFile, const string &outputFile) {
     }
     if (curr_root != root and not curr_root->is_leaf()) {
         //last node has to be a leaf
+        deleteNodes(root);
         throw runtime_error("Encoding did not match Huffman tree.");
     }
-    ofstream output(outputFile);
-    output << decoded_data;
     deleteNodes(root); //inorder traversal function to delete tree
+    return decoded_data;
+}
+/*
+ * name:      compress( )
+ * purpose:   Codes data in memory, with a byte Huffman tree or, if words is
+ *            set, the word model. The blocks are coded in parallel and each
+ *            is checksummed.
+ * arguments: the data, which model to use, and optionally where to store
+ *            the total number of code bits
+ * returns:   the bytes of a zap block file
+ * effects:   NADA
+ */
+string HuffmanCoder::compress(const string &data, bool words, size_t *bits) {
+    string header;
+    vector<size_t> ends;
+    function<void(size_t, size_t, BitWriter &)> encode;
+    WordCoder wordModel;
+    uint64_t codeBits[ASCII_SIZE] = {0};
+    int codeLength[ASCII_SIZE] = {0};
+    if (words) {
+        //cut blocks on token boundaries so every block codes on its own;
+        //a token too long for one block is split, and escapes in each
+        bool splitTokens = false;
+        size_t end = 0;
+        while (end < data.size()) {
+            size_t boundary = wordModel.tokenBoundary(data, end + BLOCK_SIZE);
+            if (boundary > end + MAX_BLOCK_LENGTH) {
+                boundary = end + MAX_BLOCK_LENGTH;
+                splitTokens = true;
+            }
+            end = boundary;
+            ends.push_back(end);
+        }
+        startPhase("build");
+        header = wordModel.buildModel(data, splitTokens);
+        endPhase(data.size());
+        if (stats != nullptr) {
+            for (uint8_t length : wordModel.tokenCodeLengths()) {
+                if (length > 0) {
+                    stats->addCodeLength(length);
+                }
+            }
+        }
+        encode = [&](size_t start, size_t stop, BitWriter &out) {
+            wordModel.encodeBlock(data, start, stop, out);
+        };
+    } else if (not data.empty()) {
+        int frequency[ASCII_SIZE] = {0};
+        startPhase("count_frequency");
+        count_frequency(data, frequency); //counts freq of chars
+        endPhase(data.size());
+        startPhase("build");
+        HuffmanTreeNode *root = build(frequency); //builds tree
+        endPhase(0);
+        unordered_map<char, string> codes;
+        startPhase("generateCodes");
+        generateCodes(root, "", codes); //makes binary code
+        //turn each code string into bits once, not once per character
+        for (auto &code : codes) {
+            unsigned char c = code.first;
+            for (const char &bit : code.second) {
+                codeBits[c] = (codeBits[c] << 1) | (bit == '1');
+            }
+            codeLength[c] = code.second.length();
+            if (stats != nullptr) {
+                stats->addCodeLength(codeLength[c]);
+            }
+        }
+        endPhase(0);
+        header = serialize_tree(root);
+        deleteNodes(root); //inorder traversal function to delete tree
+        for (size_t end = BLOCK_SIZE; end < data.size(); end += BLOCK_SIZE) {
+            ends.push_back(end);
+        }
+        ends.push_back(data.size());
+        encode = [&](size_t start, size_t stop, BitWriter &out) {
+            for (size_t i = start; i < stop; i++) {
+                unsigned char c = data[i];
+                out.put(codeBits[c], codeLength[c]);
+            }
+        };
+    }
+    vector<ZapBlock> blocks(ends.size());
+    startPhase("encode");
+    runParallel(blocks.size(), [&](size_t i, int) {
+        size_t start = i == 0 ? 0 : ends[i - 1];
+        BitWriter out;
+        encode(start, ends[i], out);
+        out.finish();
+        blocks[i].rawLength = ends[i] - start;
+        blocks[i].bitLength = out.bitCount();
+        blocks[i].crc = crc32c(data.data() + start, ends[i] - start);
+        blocks[i].bits = std::move(out.bytes());
+    });
+    size_t totalBits = 0;
+    for (ZapBlock &block : blocks) {
+        totalBits += block.bitLength;
+    }
+    endPhase(data.size());
+    if (bits != nullptr) {
+        *bits = totalBits;
+    }
+    if (stats != nullptr) {
+        uint64_t counts[ASCII_SIZE] = {0};
+        for (const char &c : data) {
+            counts[(unsigned char)c]++;
+        }
+        stats->setSymbols(counts, totalBits);
+    }
+    startPhase("serialize");
+    string zapped = packBlocks(header, blocks);
+    endPhase(zapped.size());
+    return zapped;
+}
+/*
+ * name:      decompress( )
+ * purpose:   Decodes zap block file bytes in memory. Blocks are decoded in
+ *            parallel and every block is checked against its checksum.
+ * arguments: the bytes of a zap block file
+ * returns:   the decoded data
+ * effects:   throws a runtime_error if the data is damaged
+ */
+string HuffmanCoder::decompress(const string &zapped) {
+    string header;
+    vector<ZapBlock> blocks;
+    startPhase("deserialize");
+    unpackBlocks(zapped, header, blocks);
+    endPhase(zapped.size());
+    startPhase("decode");
+    vector<string> decoded(blocks.size());
+    vector<size_t> bad = decodeBlocks(header, blocks, &decoded);
+    if (not bad.empty()) {
+        throw runtime_error("Zap data is damaged: block " +
+                            to_string(bad[0]) + " failed its checksum.");
+    }
+    string decoded_data;
+    for (string &block : decoded) {
+        decoded_data += block;
+    }
+    endPhase(decoded_data.size());
+    return decoded_data;
+}
+/*
+ * name:      tester( )
+ * purpose:   Checks a zap file without writing anything: every block is
+ *            decoded into a scratch buffer, in parallel, and compared with
+ *            its checksum.
+ * arguments: the zap file to check
+ * returns:   true if every block decoded and matched its checksum
+ * effects:   prints a line for every damaged block and a summary, or why
+ *            the file can't be read and DAMAGED
+ */
+bool HuffmanCoder::tester(const string &inputFile) {
+    if (not isBlockFile(inputFile)) {
+        cout << inputFile << " has no checksums (written before zap used "
+        << "blocks); unzap it to check it." << endl;
+        return false;
+    }
+    string header;
+    vector<ZapBlock> blocks;
+    vector<size_t> bad;
+    try {
+        readBlockFile(inputFile, header, blocks);
+        bad = decodeBlocks(header, blocks, nullptr);
+    } catch (const exception &e) {
+        //the block table or the model is damaged, no block can be trusted
+        cout << e.what() << endl;
+        cout << inputFile << ": DAMAGED" << endl;
+        return false;
+    }
+    size_t bytes = 0;
+    for (ZapBlock &block : blocks) {
+        bytes += block.rawLength;
+    }
+    for (size_t block : bad) {
+        cout << "Block " << block << " failed its checksum." << endl;
+    }
+    cout << inputFile << ": " << blocks.size() << " blocks, " << bytes
+    << " bytes, " << (bad.empty() ? "OK" : "DAMAGED") << endl;
+    return bad.empty();
+}
+/*
+ * name:      decodeBlocks( )
+ * purpose:   Decodes blocks in parallel with the model in header and checks
+ *            each against its checksum.
+ * arguments: the header, the blocks, and where to keep the decoded blocks
+ *            (nullptr to decode into per thread scratch space and drop them)
+ * returns:   the numbers of the blocks that failed, in order
+ * effects:   throws a runtime_error if the header is damaged
+ */
+vector<size_t> HuffmanCoder::decodeBlocks(const string &header,
+                                          const vector<ZapBlock> &blocks,
+                                          vector<string> *decoded) {
+    if (blocks.empty()) {
+        return {};
+    }
+    bool words = WordCoder::isWordHeader(header);
+    WordCoder wordModel;
+    HuffmanTreeNode *root = nullptr;
+    if (words) {
+        wordModel.loadModel(header);
+    } else {
+        root = deserialize_tree(header);
+        if (root == nullptr) {
+            throw runtime_error("Encoding did not match Huffman tree.");
+        }
+    }
+    vector<char> failed(blocks.size(), 0);
+    vector<string> scratch(workerCount());
+    runParallel(blocks.size(), [&](size_t i, int worker) {
+        string &out = decoded ? (*decoded)[i] : scratch[worker];
+        const ZapBlock &block = blocks[i];
+        try {
+            if (words) {
+                wordModel.decodeBlock(block.bits.data(), block.bitLength,
+                                      block.rawLength, out);
+            } else {
+                decodeTreeBlock(root, block, out);
+            }
+            failed[i] = crc32c(out.data(), out.size()) != block.crc;
+        } catch (const exception &e) {
+            failed[i] = 1; //bits that don't decode, or a length they can't
+        }
+    });
+    deleteNodes(root);
+    vector<size_t> bad;
+    for (size_t i = 0; i < failed.size(); i++) {
+        if (failed[i]) {
+            bad.push_back(i);
+        }
+    }
+    return bad;
+}
+/*
+ * name:      decodeTreeBlock( )
+ * purpose:   decodes one block by walking the Huffman tree bit by bit
+ * arguments: the tree's root, the block, and the string to decode into
+ * returns:   NADA
+ * effects:   replaces out, throws a runtime_error if the bits don't match
+ *            the tree or are too few for the block's length
+ */
+void HuffmanCoder::decodeTreeBlock(HuffmanTreeNode *root,
+                                   const ZapBlock &block, string &out) {
+    //every byte takes a bit at least, unless the tree is a single leaf
+    if (not root->is_leaf() and block.rawLength > block.bitLength) {
+        throw runtime_error("Encoding did not match Huffman tree.");
+    }
+    BitReader in(block.bits.data(), block.bitLength);
+    out.clear();
+    out.reserve(block.rawLength);
+    while (out.size() < block.rawLength) {
+        HuffmanTreeNode *curr_root = root;
+        while (curr_root != nullptr and not curr_root->is_leaf()) {
+            curr_root = in.bit() ? curr_root->get_right()
+                                 : curr_root->get_left();
+        }
+        if (curr_root == nullptr or in.overran()) {
+            throw runtime_error("Encoding did not match Huffman tree.");
+        }
+        out += curr_root->get_val();
+    }
+}
+/*
+ * name:      runParallel( )
+ * purpose:   calls work(i, worker) for every i below count, spread over a
+ *            few threads that each take the next unclaimed i
+ * arguments: the number of items and the work to do for each
+ * returns:   NADA
+ * effects:   NADA
+ */
+void HuffmanCoder::runParallel(size_t count,
+                               const function<void(size_t, int)> &work) {
+    atomic<size_t> next(0);
+    auto worker = [&](int id) {
+        for (size_t i = next++; i < count; i = next++) {
+            work(i, id);
+        }
+    };
+    int threads = min((size_t)workerCount(), count);
+    vector<thread> pool;
+    for (int id = 1; id < threads; id++) {
+        pool.emplace_back(worker, id);
+    }
+    worker(0);
+    for (thread &t : pool) {
+        t.join();
+    }
+}
+/*
+ * name:      workerCount( )
+ * purpose:   number of threads runParallel( ) uses at most
+ * arguments: NADA
+ * returns:   the number of hardware threads, at least 1
+ * effects:   NADA
+ */
+int HuffmanCoder::workerCount() {
+    return max(1u, thread::hardware_concurrency());
 }
 /*
  * name:      count_frequency( )
@@ -97,10 +612,11 @@ void HuffmanCoder::decoder(const string &inputFile, const string &outputFile) {
  * returns:   NADA
  * effects:   NADA
  */
-void HuffmanCoder::count_frequency(string inputFile, int frequency[]) {
-    frequency[ASCII_SIZE] = {0};
-    for (char& c : inputFile) {
-        frequency[(int)c]++;
+void HuffmanCoder::count_frequency(const string &inputFile,
+                                   int frequency[]) {
+    for (const char &c : inputFile) {
+        //unsigned so bytes above 127 don't index before the array
+        frequency[(unsigned char)c]++;
     }
 }
 /*
@@ -196,23 +712,30 @@ string HuffmanCoder::serialize_tree(HuffmanTreeNode *root){
 HuffmanTreeNode* HuffmanCoder::deserialize_tree(const std::string &s){
     int index = 0;
     //calls helper function
-    return deserialize_helper(s, index);
+    return deserialize_helper(s, index, 0);
 }
 /*
  * name:      deserialize_helper( )
  * purpose:   Creates a HuffmanTreeNode for the curr node from the serialized
               string. If the node is a non-leaf, it recursively deserializes
               the node's left subtree, then its right.
- * arguments: an address to a string and an address to an int
+ * arguments: an address to a string, an address to an int and the depth
+ *            of the node being read
  * returns:   NADA
- * effects:   calls handle command with the content inside the rstring
+ * effects:   calls handle command with the content inside the rstring,
+ *            throws a runtime_error if the tree nests past MAX_TREE_DEPTH
+ *            (after freeing the nodes it made), so a damaged header can't
+ *            exhaust the stack
  */
 HuffmanTreeNode* HuffmanCoder::deserialize_helper(const std::string &s, 
-                                                  int &index) {
+                                                  int &index, int depth) {
     int stringLen = s.length();
     if (index >= stringLen) {
         return nullptr;
     }
+    if (depth > MAX_TREE_DEPTH) {
+        throw runtime_error("Huffman tree is nested too deeply.");
+    }
     char type = s[index++];
     if (type == 'L') {
         //If Leaf, create node with value
@@ -221,8 +744,14 @@ HuffmanTreeNode* HuffmanCoder::deserialize_helper(const std::string &s,
     }
     else if (type == 'I') {
         //internal node creation
-        HuffmanTreeNode *left = deserialize_helper(s, index);
-        HuffmanTreeNode *right = deserialize_helper(s, index); 
+        HuffmanTreeNode *left = deserialize_helper(s, index, depth + 1);
+        HuffmanTreeNode *right = nullptr;
+        try {
+            right = deserialize_helper(s, index, depth + 1);
+        } catch (const runtime_error &e) {
+            deleteNodes(left);
+            throw;
+        }
         HuffmanTreeNode *node = new HuffmanTreeNode('\0' , 0, left, right);
         return node;
     }
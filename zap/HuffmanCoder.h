@@ -12,9 +12,14 @@
 #ifndef _HUFFMAN_CODER
 #define _HUFFMAN_CODER
 
+#include <functional>
 #include <string>
 #include <unordered_map>
+#include <vector>
+#include "ByteCoding.h"
 #include "HuffmanTreeNode.h"
+#include "ZapBlocks.h"
+#include "ZapStats.h"
 #include "ZapUtil.h"
 using namespace std;
 
@@ -24,14 +29,42 @@ class HuffmanCoder {
     public:
     void encoder(const std::string &inputFile, const std::string &outputFile);
     void decoder(const std::string &inputFile, const std::string &outputFile);
+    bool tester(const string &inputFile);
+    string compress(const string &data, bool words, size_t *bits = nullptr);
+    string decompress(const string &zapped);
+    void wordEncoder(const string &inputFile, const string &outputFile);
+    void archive(const vector<string> &inputFiles, const string &outputFile);
+    void unarchive(const string &inputFile, const string &outputDir);
+    void deltaEncoder(const string &referenceFile, const string &inputFile,
+                      const string &outputFile);
+    void deltaDecoder(const string &referenceFile, const string &inputFile,
+                      const string &outputFile);
+    void setStats(ZapStats *zapStats);
     private:
+        ZapStats *stats = nullptr; //where to record phases, if anywhere
+
+        void startPhase(const string &phase);
+        void endPhase(size_t bytes);
+        string readWholeFile(const string &inputFile);
+        void writeWholeFile(const string &outputFile, const string &contents);
+        size_t zapString(const string &data, const string &outputFile);
+        string unzapString(const string &inputFile);
+        vector<size_t> decodeBlocks(const string &header,
+                                    const vector<ZapBlock> &blocks,
+                                    vector<string> *decoded);
+        void decodeTreeBlock(HuffmanTreeNode *root, const ZapBlock &block,
+                             string &out);
+        void runParallel(size_t count,
+                         const function<void(size_t, int)> &work);
+        int workerCount();
        void generateCodes(HuffmanTreeNode *root, const string &code, 
                        unordered_map<char, std::string> &codes);
         HuffmanTreeNode *build(int frequency[]);
-        void count_frequency(string inputFile, int frequency[]);
+        void count_frequency(const string &inputFile, int frequency[]);
         std::string serialize_tree(HuffmanTreeNode *root);
         HuffmanTreeNode *deserialize_tree(const std::string &s);
-        HuffmanTreeNode *deserialize_helper(const string &s, int &index);
+        HuffmanTreeNode *deserialize_helper(const string &s, int &index,
+                                            int depth);
         void deleteNodes(HuffmanTreeNode *root);
     
 };
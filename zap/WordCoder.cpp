@@ -0,0 +1,431 @@
+/*
+ *  WordCoder.cpp
+ *  Harrison Tun
+ *
+ *  COMP 15 Proj Zap
+ *
+ *  Purpose: This file is the implementation of the WordCoder class.
+ *
+ *           Header layout (integers are LEB128 varints):
+ *               "ZAPWRD1" dictionarySize
+ *               dictionarySize x (length bytes...)
+ *               dictionarySize + 1 token code lengths (the last is escape)
+ *               257 byte code lengths (the last ends an escaped token)
+ *
+ *           A block holds one token code per token. After the escape code
+ *           come the token's bytes in the byte code, then END_OF_TOKEN.
+ *
+ */
+
+#include "WordCoder.h"
+#include "ByteCoding.h"
+#include <cctype>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+
+static const string WORD_TAG = "ZAPWRD1";
+
+/*
+ * name:      buildModel( )
+ * purpose:   Counts the tokens of text, picks the dictionary, and builds the
+ *            token and byte codes used by encodeBlock( ).
+ * arguments: the whole text that will be encoded, and whether some block
+ *            bound falls inside a token. The pieces of a cut token are
+ *            escaped, so then every byte and the escape need a code.
+ * returns:   the header that loadModel( ) needs to decode the blocks
+ * effects:   replaces the model
+ */
+string WordCoder::buildModel(const string &text, bool splitTokens) {
+    vector<pair<size_t, size_t>> tokens;
+    tokenize(text, 0, text.size(), tokens);
+    //hash indexed token table: token -> distinct id, and each id's count
+    unordered_map<string, uint32_t> ids;
+    vector<uint64_t> counts;
+    vector<string> distinct;
+    for (auto &token : tokens) {
+        string word = text.substr(token.first, token.second);
+        auto found = ids.find(word);
+        if (found == ids.end()) {
+            found = ids.emplace(word, distinct.size()).first;
+            distinct.push_back(word);
+            counts.push_back(0);
+        }
+        counts[found->second]++;
+    }
+    //tokens seen more than once get a dictionary entry, the rest escape
+    dictionary.clear();
+    dictIds.clear();
+    vector<uint64_t> tokenFreq;
+    vector<uint64_t> byteFreq(END_OF_TOKEN + 1, 0);
+    uint64_t escapes = 0;
+    for (size_t i = 0; i < distinct.size(); i++) {
+        if (counts[i] > 1) {
+            dictIds[distinct[i]] = dictionary.size();
+            dictionary.push_back(distinct[i]);
+            tokenFreq.push_back(counts[i]);
+            continue;
+        }
+        escapes++;
+        for (const char &c : distinct[i]) {
+            byteFreq[(unsigned char)c]++;
+        }
+        byteFreq[END_OF_TOKEN]++;
+    }
+    tokenFreq.push_back(escapes);
+    if (splitTokens) {
+        tokenFreq.back() = max(tokenFreq.back(), (uint64_t)1);
+        for (uint64_t &freq : byteFreq) {
+            freq = max(freq, (uint64_t)1);
+        }
+    }
+    buildLengths(tokenFreq, tokenCode);
+    buildLengths(byteFreq, byteCode);
+    assignCodes(tokenCode);
+    assignCodes(byteCode);
+
+    string header = WORD_TAG;
+    writeVarint(header, dictionary.size());
+    for (string &word : dictionary) {
+        writeVarint(header, word.size());
+        header += word;
+    }
+    header.append(tokenCode.lengths.begin(), tokenCode.lengths.end());
+    header.append(byteCode.lengths.begin(), byteCode.lengths.end());
+    return header;
+}
+
+/*
+ * name:      loadModel( )
+ * purpose:   Rebuilds the dictionary and decoding tables from a header made
+ *            by buildModel( ).
+ * arguments: the header
+ * returns:   NADA
+ * effects:   replaces the model, throws a runtime_error if the header is
+ *            damaged
+ */
+void WordCoder::loadModel(const string &header) {
+    if (not isWordHeader(header)) {
+        throw runtime_error("Header is not a word model.");
+    }
+    size_t pos = WORD_TAG.size();
+    uint64_t dictSize = readVarint(header, pos);
+    dictionary.clear();
+    dictIds.clear();
+    longestToken = 1; //an escaped byte
+    for (uint64_t i = 0; i < dictSize; i++) {
+        uint64_t len = readVarint(header, pos);
+        if (len > header.size() - pos) {
+            throw runtime_error("Word model is truncated.");
+        }
+        dictionary.push_back(header.substr(pos, len));
+        pos += len;
+        longestToken = max(longestToken, (size_t)len);
+    }
+    if (header.size() - pos != dictSize + 1 + END_OF_TOKEN + 1) {
+        throw runtime_error("Word model is truncated.");
+    }
+    tokenCode.lengths.assign(header.begin() + pos,
+                             header.begin() + pos + dictSize + 1);
+    byteCode.lengths.assign(header.begin() + pos + dictSize + 1,
+                            header.end());
+    assignCodes(tokenCode);
+    assignCodes(byteCode);
+    buildDecoder(tokenCode);
+    buildDecoder(byteCode);
+}
+
+/*
+ * name:      tokenBoundary( )
+ * purpose:   moves pos forward to the end of the token it falls inside, so
+ *            a block cut there does not split a token
+ * arguments: the text and a position in it
+ * returns:   the first token boundary at or after pos
+ * effects:   NADA
+ */
+size_t WordCoder::tokenBoundary(const string &text, size_t pos) const {
+    if (pos == 0 or pos >= text.size()) {
+        return min(pos, text.size());
+    }
+    bool word = isalnum((unsigned char)text[pos - 1]);
+    while (pos < text.size() and
+           (bool)isalnum((unsigned char)text[pos]) == word) {
+        pos++;
+    }
+    return pos;
+}
+
+/*
+ * name:      encodeBlock( )
+ * purpose:   Huffman codes text[start, end) one token at a time.
+ * arguments: the text, the block's bounds, and the writer to add the codes
+ *            to. Bounds are token boundaries unless a token was too long for
+ *            one block; the model must then have been built with
+ *            splitTokens set.
+ * returns:   NADA
+ * effects:   NADA
+ */
+void WordCoder::encodeBlock(const string &text, size_t start, size_t end,
+                            BitWriter &out) const {
+    vector<pair<size_t, size_t>> tokens;
+    tokenize(text, start, end, tokens);
+    size_t escape = dictionary.size();
+    string word;
+    for (auto &token : tokens) {
+        word.assign(text, token.first, token.second);
+        auto found = dictIds.find(word);
+        if (found != dictIds.end()) {
+            out.put(tokenCode.codes[found->second],
+                    tokenCode.lengths[found->second]);
+            continue;
+        }
+        out.put(tokenCode.codes[escape], tokenCode.lengths[escape]);
+        for (const char &c : word) {
+            unsigned char b = c;
+            out.put(byteCode.codes[b], byteCode.lengths[b]);
+        }
+        out.put(byteCode.codes[END_OF_TOKEN], byteCode.lengths[END_OF_TOKEN]);
+    }
+}
+
+/*
+ * name:      decodeBlock( )
+ * purpose:   Decodes one block made by encodeBlock( ).
+ * arguments: the block's packed bits and their number, the number of bytes
+ *            the block decodes to, and the string to decode into
+ * returns:   NADA
+ * effects:   replaces out, throws a runtime_error if the bits don't match
+ *            the codes or are too few for rawLength
+ */
+void WordCoder::decodeBlock(const char *bits, size_t bitLength,
+                            size_t rawLength, string &out) const {
+    //every code is a bit at least and decodes to longestToken bytes at most
+    if (rawLength / longestToken > bitLength) {
+        throw runtime_error("Encoding did not match Huffman tree.");
+    }
+    BitReader in(bits, bitLength);
+    size_t dictSize = dictionary.size();
+    out.clear();
+    out.reserve(rawLength);
+    while (out.size() < rawLength) {
+        uint32_t symbol = decodeSymbol(in, tokenCode);
+        if (symbol < dictSize) {
+            out += dictionary[symbol];
+            continue;
+        }
+        for (symbol = decodeSymbol(in, byteCode); symbol != END_OF_TOKEN;
+             symbol = decodeSymbol(in, byteCode)) {
+            out += (char)symbol;
+        }
+    }
+    if (out.size() != rawLength) {
+        throw runtime_error("Encoding did not match Huffman tree.");
+    }
+}
+
+/*
+ * name:      isWordHeader( )
+ * purpose:   tells word model headers apart from serialized Huffman trees,
+ *            which always start with 'I' or 'L'
+ * arguments: the header read from a zap file
+ * returns:   true if the header was written by encode( )
+ * effects:   NADA
+ */
+bool WordCoder::isWordHeader(const string &header) {
+    return header.compare(0, WORD_TAG.size(), WORD_TAG) == 0;
+}
+
+/*
+ * code length of every dictionary token, then of the escape symbol (0 for
+ * tokens that never got a code)
+ */
+const vector<uint8_t> &WordCoder::tokenCodeLengths() const {
+    return tokenCode.lengths;
+}
+
+/*
+ * name:      tokenize( )
+ * purpose:   splits text[start, end) into alternating runs of letters/digits
+ *            and runs of everything else, so the tokens concatenate back to
+ *            the text
+ * arguments: the text, the range to split, and a vector to fill with
+ *            (start, length) of tokens
+ * returns:   NADA
+ * effects:   NADA
+ */
+void WordCoder::tokenize(const string &text, size_t start, size_t end,
+                         vector<pair<size_t, size_t>> &tokens) const {
+    while (start < end) {
+        bool word = isalnum((unsigned char)text[start]);
+        size_t stop = start + 1;
+        while (stop < end and
+               (bool)isalnum((unsigned char)text[stop]) == word) {
+            stop++;
+        }
+        tokens.push_back({start, stop - start});
+        start = stop;
+    }
+}
+
+/*
+ * name:      buildLengths( )
+ * purpose:   Computes Huffman code lengths with a min priority queue. If a
+ *            code would be longer than MAX_CODE_LEN, the frequencies are
+ *            halved and the lengths recomputed until every code fits.
+ * arguments: frequency of every symbol, and the code to fill in
+ * returns:   NADA
+ * effects:   sets code.lengths
+ */
+void WordCoder::buildLengths(const vector<uint64_t> &freq,
+                             CanonicalCode &code) {
+    vector<uint64_t> weights = freq;
+    while (true) {
+        code.lengths.assign(weights.size(), 0);
+        //nodes 0..n-1 are symbols, the rest are internal
+        vector<int> parent(weights.size(), -1);
+        priority_queue<pair<uint64_t, int>, vector<pair<uint64_t, int>>,
+                       greater<pair<uint64_t, int>>> my_pq;
+        for (size_t i = 0; i < weights.size(); i++) {
+            if (weights[i] > 0) {
+                my_pq.push({weights[i], i});
+            }
+        }
+        if (my_pq.size() == 1) {
+            code.lengths[my_pq.top().second] = 1;
+            return;
+        }
+        while (my_pq.size() > 1) {
+            auto left = my_pq.top(); my_pq.pop();
+            auto right = my_pq.top(); my_pq.pop();
+            parent.push_back(-1);
+            parent[left.second] = parent.size() - 1;
+            parent[right.second] = parent.size() - 1;
+            my_pq.push({left.first + right.first, (int)parent.size() - 1});
+        }
+        //depth of a leaf is the number of parents above it
+        vector<int> depth(parent.size(), 0);
+        int longest = 0;
+        for (int i = parent.size() - 1; i >= 0; i--) {
+            if (parent[i] >= 0) {
+                depth[i] = depth[parent[i]] + 1;
+            }
+            if (i < (int)weights.size() and weights[i] > 0) {
+                code.lengths[i] = depth[i];
+                longest = max(longest, depth[i]);
+            }
+        }
+        if (longest <= MAX_CODE_LEN) {
+            return;
+        }
+        for (uint64_t &w : weights) {
+            w = (w + 1) / 2;
+        }
+    }
+}
+
+/*
+ * name:      assignCodes( )
+ * purpose:   gives every used symbol its canonical code: shorter codes come
+ *            first, and codes of equal length are in symbol order
+ * arguments: a code whose lengths are set
+ * returns:   NADA
+ * effects:   sets codes, sorted, count, firstCode and firstIndex, throws a
+ *            runtime_error if the lengths can't form a prefix code (their
+ *            Kraft sum is over 1), as a damaged header's may not
+ */
+void WordCoder::assignCodes(CanonicalCode &code) {
+    for (int len = 0; len <= MAX_CODE_LEN; len++) {
+        code.count[len] = 0;
+    }
+    for (uint8_t len : code.lengths) {
+        if (len > MAX_CODE_LEN) {
+            throw runtime_error("Word model holds a bad code length.");
+        }
+        code.count[len]++;
+    }
+    code.count[0] = 0;
+    //64 bits, so the first code past 32 bit codes can be held and checked
+    uint64_t next = 0;
+    uint32_t index = 0;
+    for (int len = 1; len <= MAX_CODE_LEN; len++) {
+        next = (next + code.count[len - 1]) << 1;
+        //the codes of this length run from next, and must fit in len bits
+        if (next + code.count[len] > (1ULL << len)) {
+            throw runtime_error("Word model holds bad code lengths.");
+        }
+        code.firstCode[len] = next;
+        code.firstIndex[len] = index;
+        index += code.count[len];
+    }
+    code.sorted.assign(index, 0);
+    code.codes.assign(code.lengths.size(), 0);
+    vector<uint32_t> nextCode(code.firstCode, code.firstCode +
+                              MAX_CODE_LEN + 1);
+    vector<uint32_t> nextIndex(code.firstIndex, code.firstIndex +
+                               MAX_CODE_LEN + 1);
+    for (size_t symbol = 0; symbol < code.lengths.size(); symbol++) {
+        int len = code.lengths[symbol];
+        if (len > 0) {
+            code.codes[symbol] = nextCode[len]++;
+            code.sorted[nextIndex[len]++] = symbol;
+        }
+    }
+}
+
+/*
+ * name:      buildDecoder( )
+ * purpose:   fills the table that maps the next FAST_BITS bits of input to
+ *            the symbol they start with, for every code that short
+ * arguments: a code whose canonical codes are assigned
+ * returns:   NADA
+ * effects:   sets code.fast
+ */
+void WordCoder::buildDecoder(CanonicalCode &code) {
+    code.fast.assign(1 << FAST_BITS, 0);
+    for (size_t symbol = 0; symbol < code.lengths.size(); symbol++) {
+        int len = code.lengths[symbol];
+        if (len == 0 or len > FAST_BITS) {
+            continue;
+        }
+        uint32_t first = code.codes[symbol] << (FAST_BITS - len);
+        uint32_t span = 1 << (FAST_BITS - len);
+        for (uint32_t i = 0; i < span; i++) {
+            code.fast[first + i] = (symbol << 8) | len;
+        }
+    }
+}
+
+/*
+ * name:      decodeSymbol( )
+ * purpose:   Reads one symbol. Short codes are found with a single lookup
+ *            in the fast table; longer ones are resolved a bit at a time
+ *            with the canonical first code of each length.
+ * arguments: the reader and the code to decode with
+ * returns:   the symbol
+ * effects:   advances the reader, throws a runtime_error if the bits don't
+ *            form a code or run past the end of the input
+ */
+uint32_t WordCoder::decodeSymbol(BitReader &in,
+                                 const CanonicalCode &code) const {
+    uint32_t entry = code.fast[in.peek(FAST_BITS)];
+    uint32_t symbol = 0;
+    int len = entry & 0xff;
+    if (len != 0) {
+        symbol = entry >> 8;
+    } else {
+        uint32_t bits = in.peek(MAX_CODE_LEN);
+        for (len = 1; len <= MAX_CODE_LEN; len++) {
+            uint32_t value = bits >> (MAX_CODE_LEN - len);
+            if (value - code.firstCode[len] < code.count[len]) {
+                symbol = code.sorted[code.firstIndex[len] + value -
+                                     code.firstCode[len]];
+                break;
+            }
+        }
+    }
+    in.skip(len);
+    if (len > MAX_CODE_LEN or in.overran()) {
+        throw runtime_error("Encoding did not match Huffman tree.");
+    }
+    return symbol;
+}
@@ -0,0 +1,73 @@
+/*
+ *  WordCoder.h
+ *  Harrison Tun
+ *
+ *  COMP 15 Proj Zap
+ *
+ *  Purpose: This is the header file for the WordCoder class. WordCoder is a
+ *           Huffman coder whose alphabet is whole tokens (runs of letters
+ *           and digits, and the runs of other bytes between them) instead of
+ *           single characters. Tokens that show up only once are not worth a
+ *           dictionary entry, so they are sent through an escape symbol and
+ *           spelled out with a second, byte sized Huffman code.
+ *
+ *           The codes are canonical, so only code lengths are stored, and
+ *           the decoder finds symbols by indexing arrays rather than walking
+ *           a tree. One model codes every block of a file; blocks end on
+ *           token boundaries so each can be coded and decoded on its own,
+ *           except that a token longer than a block is cut and its pieces
+ *           are escaped.
+ *
+ */
+#ifndef _WORD_CODER
+#define _WORD_CODER
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ByteCoding.h"
+using namespace std;
+
+class WordCoder {
+    public:
+        string buildModel(const string &text, bool splitTokens = false);
+        void loadModel(const string &header);
+        size_t tokenBoundary(const string &text, size_t pos) const;
+        void encodeBlock(const string &text, size_t start, size_t end,
+                         BitWriter &out) const;
+        void decodeBlock(const char *bits, size_t bitLength,
+                         size_t rawLength, string &out) const;
+        static bool isWordHeader(const string &header);
+        const vector<uint8_t> &tokenCodeLengths() const;
+    private:
+        static const int MAX_CODE_LEN = 32;
+        static const int FAST_BITS = 11;
+        static const int END_OF_TOKEN = 256; //last symbol of the byte code
+
+        struct CanonicalCode {
+            vector<uint8_t> lengths;  //code length of each symbol, 0 = unused
+            vector<uint32_t> codes;   //the code of each symbol
+            vector<uint32_t> sorted;  //symbols ordered by (length, symbol)
+            uint32_t count[MAX_CODE_LEN + 1];
+            uint32_t firstCode[MAX_CODE_LEN + 1];
+            uint32_t firstIndex[MAX_CODE_LEN + 1];
+            //FAST_BITS of input -> symbol << 8 | length, 0 if code is longer
+            vector<uint32_t> fast;
+        };
+
+        vector<string> dictionary;
+        size_t longestToken = 1; //bytes one token code can decode to
+        unordered_map<string, uint32_t> dictIds; //token -> dictionary index
+        CanonicalCode tokenCode;
+        CanonicalCode byteCode;
+
+        void tokenize(const string &text, size_t start, size_t end,
+                      vector<pair<size_t, size_t>> &tokens) const;
+        void buildLengths(const vector<uint64_t> &freq, CanonicalCode &code);
+        void assignCodes(CanonicalCode &code);
+        void buildDecoder(CanonicalCode &code);
+        uint32_t decodeSymbol(BitReader &in, const CanonicalCode &code) const;
+};
+
+#endif
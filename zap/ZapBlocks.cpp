@@ -0,0 +1,142 @@
+/*
+ *  ZapBlocks.cpp
+ *  Harrison Tun
+ *
+ *  COMP 15 Proj Zap
+ *
+ *  Purpose: Implementation of the block file functions in ZapBlocks.h.
+ *
+ */
+
+#include "ZapBlocks.h"
+#include "ByteCoding.h"
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+static const string BLOCK_MAGIC = string("ZAPBLK1\n");
+
+/*
+ * name:      packBlocks( )
+ * purpose:   lays out a block file in memory: magic, header, block table,
+ *            then every block's bits
+ * arguments: the model header and the coded blocks
+ * returns:   the bytes of the block file
+ * effects:   NADA
+ */
+string packBlocks(const string &header, const vector<ZapBlock> &blocks) {
+    string data = BLOCK_MAGIC;
+    writeVarint(data, header.size());
+    data += header;
+    writeVarint(data, blocks.size());
+    for (const ZapBlock &block : blocks) {
+        writeVarint(data, block.rawLength);
+        writeVarint(data, block.bitLength);
+        writeU32(data, block.crc);
+    }
+    for (const ZapBlock &block : blocks) {
+        data += block.bits;
+    }
+    return data;
+}
+
+/*
+ * name:      unpackBlocks( )
+ * purpose:   parses the bytes of a block file, checking every length
+ *            against what is left before using it
+ * arguments: the bytes, and the header and blocks to fill in
+ * returns:   NADA
+ * effects:   replaces header and blocks, throws a runtime_error if the
+ *            data is truncated or a block is longer than MAX_BLOCK_LENGTH
+ */
+void unpackBlocks(const string &data, string &header,
+                  vector<ZapBlock> &blocks) {
+    if (data.compare(0, BLOCK_MAGIC.size(), BLOCK_MAGIC) != 0) {
+        throw runtime_error("Data is not a zap block file.");
+    }
+    size_t pos = BLOCK_MAGIC.size();
+    uint64_t headerLength = readVarint(data, pos);
+    if (headerLength > data.size() - pos) {
+        throw runtime_error("Zap data is truncated.");
+    }
+    header = data.substr(pos, headerLength);
+    pos += headerLength;
+    uint64_t blockCount = readVarint(data, pos);
+    //every block needs at least 6 bytes of table, so a damaged count
+    //can't make us allocate more than the file could describe
+    if (blockCount > (data.size() - pos) / 6) {
+        throw runtime_error("Zap data is truncated.");
+    }
+    blocks.assign(blockCount, ZapBlock());
+    for (ZapBlock &block : blocks) {
+        block.rawLength = readVarint(data, pos);
+        block.bitLength = readVarint(data, pos);
+        block.crc = readU32(data, pos);
+        if (block.rawLength > MAX_BLOCK_LENGTH) {
+            throw runtime_error("Zap data is damaged: a block is too long.");
+        }
+    }
+    for (ZapBlock &block : blocks) {
+        uint64_t bytes = (block.bitLength + 7) / 8;
+        if (block.bitLength > 8 * (data.size() - pos) or
+            bytes > data.size() - pos) {
+            throw runtime_error("Zap data is truncated.");
+        }
+        block.bits = data.substr(pos, bytes);
+        pos += bytes;
+    }
+}
+
+/*
+ * name:      writeBlockFile( )
+ * purpose:   writes a block file made by packBlocks( ) to disk
+ * arguments: the file to write, the model header and the coded blocks
+ * returns:   NADA
+ * effects:   throws a runtime_error if the file can't be opened
+ */
+void writeBlockFile(const string &filename, const string &header,
+                    const vector<ZapBlock> &blocks) {
+    ofstream output(filename, ios::binary);
+    if (not output) {
+        throw runtime_error("Unable to open file " + filename);
+    }
+    output << packBlocks(header, blocks);
+}
+
+/*
+ * name:      readBlockFile( )
+ * purpose:   reads a block file from disk and parses it with
+ *            unpackBlocks( )
+ * arguments: the file to read, and the header and blocks to fill in
+ * returns:   NADA
+ * effects:   replaces header and blocks, throws a runtime_error if the
+ *            file can't be opened or is not a well formed block file
+ */
+void readBlockFile(const string &filename, string &header,
+                   vector<ZapBlock> &blocks) {
+    ifstream input(filename, ios::binary);
+    if (not input) {
+        throw runtime_error("Unable to open file " + filename);
+    }
+    string data { istreambuf_iterator<char>(input),
+                  istreambuf_iterator<char>() };
+    if (data.compare(0, BLOCK_MAGIC.size(), BLOCK_MAGIC) != 0) {
+        throw runtime_error(filename + " is not a zap block file.");
+    }
+    unpackBlocks(data, header, blocks);
+}
+
+/*
+ * name:      isBlockFile( )
+ * purpose:   tells block files apart from zap files made before blocks
+ *            existed, by their magic
+ * arguments: the file to check
+ * returns:   true if the file starts with the block file magic
+ * effects:   NADA
+ */
+bool isBlockFile(const string &filename) {
+    ifstream input(filename, ios::binary);
+    string magic(BLOCK_MAGIC.size(), '\0');
+    input.read(&magic[0], magic.size());
+    return input and magic == BLOCK_MAGIC;
+}
@@ -0,0 +1,71 @@
+/*
+ *  ZapBlocks.h
+ *  Harrison Tun
+ *
+ *  COMP 15 Proj Zap
+ *
+ *  Purpose: Reads and writes the block based zap file format. The input is
+ *           cut into blocks that are coded on their own with one shared
+ *           model (a serialized Huffman tree or a word model), so blocks can
+ *           be decoded in parallel. Every block carries the CRC-32C of its
+ *           decoded bytes, so damage is caught block by block.
+ *
+ *           File layout (integers are LEB128 varints unless noted):
+ *               "ZAPBLK1\n"
+ *               headerLength header
+ *               blockCount
+ *               blockCount x (rawLength bitLength crc32c as 4 bytes)
+ *               the packed bits of every block, each padded to a byte
+ *
+ */
+#ifndef _ZAP_BLOCKS
+#define _ZAP_BLOCKS
+
+#include <cstdint>
+#include <string>
+#include <vector>
+using namespace std;
+
+//most bytes one block may decode to; writers cut blocks no longer, so
+//readers can refuse a damaged length before allocating for it
+const uint64_t MAX_BLOCK_LENGTH = 1 << 22;
+
+struct ZapBlock {
+    uint64_t rawLength; //number of bytes the block decodes to
+    uint64_t bitLength; //number of meaningful bits in bits
+    uint32_t crc;       //CRC-32C of the decoded bytes
+    string bits;        //packed code bits, most significant bit first
+};
+
+/* Lays out ++header++ and ++blocks++ exactly as writeBlockFile writes them
+ * and returns the bytes, for callers that keep zap data in memory.
+ */
+string packBlocks(const string &header, const vector<ZapBlock> &blocks);
+
+/* Parses bytes made by packBlocks into ++header++ and ++blocks++.
+ * Possible exception: throws a runtime_error if ++data++ is not a well
+ * formed block file, or a block is longer than MAX_BLOCK_LENGTH.
+ */
+void unpackBlocks(const string &data, string &header,
+                  vector<ZapBlock> &blocks);
+
+/* Writes a block file named ++filename++ holding ++header++ (the model the
+ * blocks were coded with) and ++blocks++.
+ * Possible exception: throws a runtime_error if the file can't be opened.
+ */
+void writeBlockFile(const string &filename, const string &header,
+                    const vector<ZapBlock> &blocks);
+
+/* Reads a block file named ++filename++ into ++header++ and ++blocks++.
+ * Possible exception: throws a runtime_error if the file can't be opened or
+ * is not a well formed block file.
+ */
+void readBlockFile(const string &filename, string &header,
+                   vector<ZapBlock> &blocks);
+
+/* Returns true if ++filename++ starts like a block file. Files written
+ * with writeZapFile before blocks existed return false.
+ */
+bool isBlockFile(const string &filename);
+
+#endif
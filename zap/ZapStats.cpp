@@ -0,0 +1,201 @@
+/*
+ *  ZapStats.cpp
+ *  Harrison Tun
+ *
+ *  COMP 15 Proj Zap
+ *
+ *  Purpose: This file is the implementation of the ZapStats class, and of
+ *           the counting operator new and delete it relies on.
+ *
+ */
+
+#include "ZapStats.h"
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+
+//relaxed counters: they are only read between phases, never to order work
+static atomic<uint64_t> allocations(0);
+static atomic<uint64_t> allocationBytes(0);
+//set by the first begin( ), so runs without stats never touch the shared
+//counters and their threads don't contend on them
+static atomic<bool> counting(false);
+
+/*
+ * Global operator new and delete, replaced so that heap allocations can be
+ * counted once stats are on. The array and nothrow forms forward to these.
+ * They are kept out of line so the compiler never pairs an inlined free( )
+ * with new.
+ */
+[[gnu::noinline]] void *operator new(size_t size) {
+    if (counting.load(memory_order_relaxed)) {
+        allocations.fetch_add(1, memory_order_relaxed);
+        allocationBytes.fetch_add(size, memory_order_relaxed);
+    }
+    void *p = malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        throw bad_alloc();
+    }
+    return p;
+}
+
+[[gnu::noinline]] void operator delete(void *p) noexcept {
+    free(p);
+}
+
+[[gnu::noinline]] void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+/*
+ * total number and size of heap allocations made since stats were first
+ * used
+ */
+uint64_t ZapStats::allocationCount() {
+    return allocations.load(memory_order_relaxed);
+}
+
+uint64_t ZapStats::allocatedBytes() {
+    return allocationBytes.load(memory_order_relaxed);
+}
+
+/*
+ * name:      begin( )
+ * purpose:   starts timing a phase
+ * arguments: the phase's name
+ * returns:   NADA
+ * effects:   remembers the clock and allocation counters, and turns on
+ *            allocation counting for the rest of the run
+ */
+void ZapStats::begin(const string &phase) {
+    counting.store(true, memory_order_relaxed);
+    current.name = phase;
+    current.allocations = allocationCount();
+    current.allocBytes = allocatedBytes();
+    started = chrono::steady_clock::now();
+}
+
+/*
+ * name:      end( )
+ * purpose:   finishes the phase started by begin( ) and records it
+ * arguments: how many bytes of data the phase read or wrote (0 for phases
+ *            that only work on the model)
+ * returns:   NADA
+ * effects:   adds a phase; a phase that runs twice gets two entries
+ */
+void ZapStats::end(size_t bytes) {
+    chrono::duration<double> took = chrono::steady_clock::now() - started;
+    current.seconds = took.count();
+    current.bytes = bytes;
+    current.allocations = allocationCount() - current.allocations;
+    current.allocBytes = allocatedBytes() - current.allocBytes;
+    phases.push_back(current);
+}
+
+/*
+ * name:      addCodeLength( )
+ * purpose:   counts one symbol of the code in the code length histogram
+ * arguments: the symbol's code length in bits
+ * returns:   NADA
+ * effects:   NADA
+ */
+void ZapStats::addCodeLength(int length) {
+    lengths[length]++;
+}
+
+/*
+ * name:      setSymbols( )
+ * purpose:   records how often each byte occurs in the input, from which
+ *            the order 0 Shannon entropy is computed, and the number of code
+ *            bits the input took
+ * arguments: count of each byte value and the total code bits
+ * returns:   NADA
+ * effects:   replaces the entropy figures
+ */
+void ZapStats::setSymbols(const uint64_t counts[256], uint64_t codeBits) {
+    symbols = 0;
+    for (int i = 0; i < 256; i++) {
+        symbols += counts[i];
+    }
+    entropy = 0;
+    for (int i = 0; i < 256; i++) {
+        if (counts[i] > 0) {
+            double p = (double)counts[i] / symbols;
+            entropy -= p * log2(p);
+        }
+    }
+    bits = codeBits;
+}
+
+/*
+ * name:      print( )
+ * purpose:   prints every phase, the totals, the code length histogram and
+ *            the entropy figures, as a table or as one JSON object
+ * arguments: the stream to print to and which format to use
+ * returns:   NADA
+ * effects:   NADA
+ */
+void ZapStats::print(ostream &out, bool json) const {
+    double seconds = 0;
+    uint64_t allocs = 0, allocBytes = 0;
+    for (const Phase &phase : phases) {
+        seconds += phase.seconds;
+        allocs += phase.allocations;
+        allocBytes += phase.allocBytes;
+    }
+    double achieved = symbols == 0 ? 0 : (double)bits / symbols;
+    if (json) {
+        out << "{\"phases\":[";
+        for (size_t i = 0; i < phases.size(); i++) {
+            const Phase &p = phases[i];
+            out << (i ? "," : "") << "{\"name\":\"" << p.name
+                << "\",\"seconds\":" << p.seconds << ",\"bytes\":" << p.bytes
+                << ",\"allocations\":" << p.allocations
+                << ",\"allocated_bytes\":" << p.allocBytes << "}";
+        }
+        out << "],\"seconds\":" << seconds << ",\"allocations\":" << allocs
+            << ",\"allocated_bytes\":" << allocBytes
+            << ",\"code_lengths\":{";
+        bool first = true;
+        for (auto &length : lengths) {
+            out << (first ? "" : ",") << "\"" << length.first << "\":"
+                << length.second;
+            first = false;
+        }
+        out << "},\"symbols\":" << symbols << ",\"entropy_bits_per_byte\":"
+            << entropy << ",\"achieved_bits_per_byte\":" << achieved << "}"
+            << endl;
+        return;
+    }
+    out << left << setw(16) << "phase" << right << setw(12) << "seconds"
+        << setw(14) << "bytes" << setw(12) << "allocs" << setw(14)
+        << "alloc bytes" << endl;
+    for (const Phase &p : phases) {
+        out << left << setw(16) << p.name << right << setw(12) << fixed
+            << setprecision(6) << p.seconds << setw(14) << p.bytes
+            << setw(12) << p.allocations << setw(14) << p.allocBytes << endl;
+    }
+    out << left << setw(16) << "total" << right << setw(12) << seconds
+        << setw(14) << "" << setw(12) << allocs << setw(14) << allocBytes
+        << endl;
+    if (not lengths.empty()) {
+        out << "code lengths (bits: symbols):";
+        for (auto &length : lengths) {
+            out << " " << length.first << ":" << length.second;
+        }
+        out << endl;
+    }
+    if (symbols > 0) {
+        out << setprecision(4) << "entropy " << entropy
+            << " bits/byte, achieved " << achieved << " bits/byte";
+        if (entropy > 0) {
+            out << " (" << setprecision(1) << 100 * achieved / entropy
+                << "% of entropy)";
+        }
+        out << endl;
+    }
+    out.unsetf(ios::fixed);
+    out << setprecision(6);
+}
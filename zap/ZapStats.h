@@ -0,0 +1,58 @@
+/*
+ *  ZapStats.h
+ *  Harrison Tun
+ *
+ *  COMP 15 Proj Zap
+ *
+ *  Purpose: This is the header file for the ZapStats class. ZapStats
+ *           records where zap and unzap spend their time: the seconds, bytes
+ *           and heap allocations of each phase (read, count_frequency, build,
+ *           generateCodes, encode, serialize, write and their unzap
+ *           counterparts), the code length histogram, and the Shannon entropy
+ *           of the input next to the bits per byte the code achieved.
+ *
+ *           Allocations are counted by replacing the global operator new
+ *           (see ZapStats.cpp), so the counts cover every allocation the
+ *           program makes while a phase is open. Counting starts with the
+ *           first phase, so runs without stats pay only a flag check.
+ *
+ */
+#ifndef _ZAP_STATS
+#define _ZAP_STATS
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+using namespace std;
+
+class ZapStats {
+    public:
+        void begin(const string &phase);
+        void end(size_t bytes);
+        void addCodeLength(int length);
+        void setSymbols(const uint64_t counts[256], uint64_t codeBits);
+        void print(ostream &out, bool json) const;
+        static uint64_t allocationCount();
+        static uint64_t allocatedBytes();
+    private:
+        struct Phase {
+            string name;
+            double seconds;
+            size_t bytes;          //data the phase read or wrote
+            uint64_t allocations;
+            uint64_t allocBytes;
+        };
+
+        vector<Phase> phases;
+        Phase current;
+        chrono::steady_clock::time_point started;
+        map<int, uint64_t> lengths;  //code length -> number of symbols
+        uint64_t symbols = 0;        //bytes of input that were coded
+        uint64_t bits = 0;           //code bits used for them
+        double entropy = 0;          //order 0 entropy, bits per byte
+};
+
+#endif
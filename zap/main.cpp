@@ -9,7 +9,9 @@
  *           keyword zap. When running zap, a given ASCII text file is encoded
  *           into compressed binary code. The other componenet of zap is the
  *           unzap keyword. The unzap keyword takes a file that contains 
- *           compressed binary code and turns it back into text.
+ *           compressed binary code and turns it back into text. The archive
+ *           and unarchive keywords pack many files into one zap file,
+ *           storing regions the files share only once.
  *
  */
 
@@ -18,23 +20,97 @@
 #include <iostream>
 using namespace std;
 
+static int run(int argc, char *argv[], HuffmanCoder &coder);
+
 int main(int argc, char *argv[]) {
-    if (argc != 4) {
+    //--stats or --stats=json may go anywhere; pull it out before dispatch
+    ZapStats stats;
+    bool wantStats = false, json = false;
+    vector<char *> args;
+    for (int i = 0; i < argc; i++) {
+        string arg = argv[i];
+        if (i > 0 and (arg == "--stats" or arg == "--stats=json")) {
+            wantStats = true;
+            json = arg == "--stats=json";
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    HuffmanCoder coder;
+    if (wantStats) {
+        coder.setStats(&stats);
+    }
+    int status = run(args.size(), args.data(), coder);
+    if (wantStats) {
+        stats.print(cerr, json); //stderr, so stdout stays as it was
+    }
+    return status;
+}
+
+/*
+ * name:      run( )
+ * purpose:   runs the command named by the arguments
+ * arguments: the arguments without --stats, and the coder to run them with
+ * returns:   the exit status
+ * effects:   NADA
+ */
+static int run(int argc, char *argv[], HuffmanCoder &coder) {
+    string usage = "Usage: ./zap [zap | unzap] inputFile outputFile\n"
+                   "       ./zap [zap | unzap] --ref oldFile inputFile "
+                   "outputFile\n"
+                   "       ./zap zap --words inputFile outputFile\n"
+                   "       ./zap unzap --test inputFile\n"
+                   "       ./zap archive outputFile inputFile...\n"
+                   "       ./zap unarchive inputFile outputDirectory\n"
+                   "Add --stats or --stats=json to any command to print "
+                   "where the time went.";
+    if (argc < 4) {
         //Incorrect argument count
-        cerr << "Usage: ./zap [zap | unzap] inputFile outputFile" << endl;
+        cerr << usage << endl;
         return EXIT_FAILURE;
     }
     string command = argv[1];
+    //runs program
+    if (command == "archive") {
+        //every argument after the archive name is a file to archive
+        vector<string> inputFiles(argv + 3, argv + argc);
+        coder.archive(inputFiles, argv[2]);
+        return 0;
+    }
+    if (argc == 6 and string(argv[2]) == "--ref") {
+        //delta against an older version of the file
+        if (command == "zap") {
+            coder.deltaEncoder(argv[3], argv[4], argv[5]);
+        } else if (command == "unzap") {
+            coder.deltaDecoder(argv[3], argv[4], argv[5]);
+        } else {
+            cerr << usage << endl;
+            return EXIT_FAILURE;
+        }
+        return 0;
+    }
+    if (argc == 5 and command == "zap" and string(argv[2]) == "--words") {
+        coder.wordEncoder(argv[3], argv[4]); //token alphabet for prose
+        return 0;
+    }
+    if (argc == 4 and command == "unzap" and string(argv[2]) == "--test") {
+        //checks every block's checksum without writing anything
+        return coder.tester(argv[3]) ? 0 : EXIT_FAILURE;
+    }
+    if (argc != 4) {
+        cerr << usage << endl;
+        return EXIT_FAILURE;
+    }
     string inputFile = argv[2];
     string outputFile = argv[3];
-    HuffmanCoder coder;
-    //runs program
     if(command == "zap") {
         coder.encoder(inputFile, outputFile); //encodes text to binary
     } else if(command == "unzap") {
         coder.decoder(inputFile, outputFile); //decodes text from binary
+    } else if(command == "unarchive") {
+        coder.unarchive(inputFile, outputFile); //restores archived files
     } else {
-        cerr << "Usage: ./zap [zap | unzap] inputFile outputFile" << endl;
+        cerr << usage << endl;
         return EXIT_FAILURE;
     }
     return 0;
@@ -7,13 +7,23 @@
  *  Purpose: Test functionality of Zap's functions
  *
  */
-#include "phaseOne.h"
+#include "ByteCoding.h"
+#include "ChunkStore.h"
+#include "Crc32c.h"
+#include "DeltaCoder.h"
 #include "HuffmanTreeNode.h"
 #include "HuffmanCoder.h"
+#include "WordCoder.h"
+#include "ZapBlocks.h"
 #include "ZapUtil.h"
 #include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <random>
 #include <sstream>
+#include <stdexcept>
 #include <vector>
 
 using namespace std;
@@ -251,4 +261,397 @@ void empty_encoder(){
 //         cout << e.what() << endl;
 //     }
     
-// }
\ No newline at end of file
+// }
+
+
+/*
+ * Helpers for the tests below. Inputs are made from fixed seeds, so a
+ * failure happens again on the next run
+ */
+string random_bytes(size_t len, unsigned seed) {
+    mt19937 gen(seed);
+    string data(len, '\0');
+    for (char &c : data) {
+        c = (char)(gen() & 0xff);
+    }
+    return data;
+}
+
+string sample_prose(size_t len) {
+    const char *words[] = {"the", "quick", "brown", "fox", "jumps", "over",
+                           "lazy", "dog,", "and", "then", "sleeps.\n"};
+    mt19937 gen(15);
+    string text;
+    while (text.size() < len) {
+        text += words[gen() % 11];
+        text += ' ';
+    }
+    return text;
+}
+
+void write_file(const string &name, const string &contents) {
+    ofstream output(name, ios::binary);
+    output << contents;
+}
+
+string read_file(const string &name) {
+    ifstream input(name, ios::binary);
+    return string { istreambuf_iterator<char>(input),
+                    istreambuf_iterator<char>() };
+}
+
+//the lengths of a file's chunks, in order, read out of ChunkStore's
+//serialized form (see ChunkStore::serialize)
+vector<size_t> chunk_lengths(ChunkStore &store, int file) {
+    string payload = store.serialize();
+    size_t pos = 0;
+    vector<vector<uint32_t>> refs(readU32(payload, pos));
+    for (vector<uint32_t> &fileRefs : refs) {
+        pos += readU32(payload, pos); //the name
+        fileRefs.resize(readU32(payload, pos));
+        for (uint32_t &ref : fileRefs) {
+            ref = readU32(payload, pos);
+        }
+    }
+    vector<uint32_t> lengths(readU32(payload, pos));
+    for (uint32_t &len : lengths) {
+        len = readU32(payload, pos);
+    }
+    vector<size_t> result;
+    for (uint32_t ref : refs[file]) {
+        result.push_back(lengths[ref]);
+    }
+    return result;
+}
+
+//attempt must throw a runtime_error, as reading damaged input should
+void expect_refused(function<void()> attempt) {
+    bool refused = false;
+    try {
+        attempt();
+    } catch (const runtime_error &e) {
+        refused = true;
+    }
+    assert(refused);
+}
+
+//every proper prefix of data must make decode throw a runtime_error, so a
+//cut off input is refused rather than read past its end
+void expect_prefixes_refused(const string &data,
+                             function<void(const string &)> decode) {
+    for (size_t len = 0; len < data.size(); len++) {
+        expect_refused([&]() { decode(data.substr(0, len)); });
+    }
+}
+
+/*
+ * ZAPARC1: archive and unarchive give back every file, including an
+ * empty one, and files that share content share chunks
+ */
+void archive_round_trip() {
+    filesystem::path dir = filesystem::temp_directory_path() /
+                           "zap_unit_tests";
+    filesystem::remove_all(dir);
+    filesystem::create_directories(dir / "in");
+    string common = random_bytes(300000, 5);
+    vector<string> names = {(dir / "in" / "a").string(),
+                            (dir / "in" / "b").string(),
+                            (dir / "in" / "empty").string()};
+    vector<string> contents = {common, "prefix" + common, ""};
+    for (size_t i = 0; i < names.size(); i++) {
+        write_file(names[i], contents[i]);
+    }
+    string archive = (dir / "files.zap").string();
+    HuffmanCoder coder;
+    coder.archive(names, archive);
+    assert(coder.decompress(read_file(archive)).compare(0, 7,
+                                                        "ZAPARC1") == 0);
+    coder.unarchive(archive, (dir / "out").string());
+    for (size_t i = 0; i < names.size(); i++) {
+        //absolute names are restored under the output directory
+        filesystem::path restored = dir / "out" /
+                                    filesystem::path(names[i]).relative_path();
+        assert(filesystem::exists(restored));
+        assert(read_file(restored.string()) == contents[i]);
+    }
+    filesystem::remove_all(dir);
+
+    ChunkStore store;
+    store.addFile("a", contents[0]);
+    size_t unique = store.numChunks();
+    store.addFile("b", contents[1]);
+    assert(store.numChunks() <= unique + 2);
+}
+
+/*
+ * FastCDC cuts: every chunk but a file's last is longer than MIN_CHUNK,
+ * none is longer than MAX_CHUNK, and the chunks add up to the file. A run
+ * of zero bytes never matches the cut masks, so it is cut every MAX_CHUNK
+ */
+void chunk_boundaries() {
+    vector<string> inputs = {"", "x", string(ChunkStore::MIN_CHUNK, 'y'),
+                             random_bytes(ChunkStore::MIN_CHUNK + 1, 6),
+                             random_bytes(1000000, 7),
+                             string(5 * ChunkStore::MAX_CHUNK + 10, '\0')};
+    for (size_t i = 0; i < inputs.size(); i++) {
+        ChunkStore store;
+        store.addFile("f", inputs[i]);
+        vector<size_t> lengths = chunk_lengths(store, 0);
+        size_t total = 0;
+        for (size_t n = 0; n < lengths.size(); n++) {
+            assert(lengths[n] <= ChunkStore::MAX_CHUNK);
+            assert(n + 1 == lengths.size() or
+                   lengths[n] > ChunkStore::MIN_CHUNK);
+            total += lengths[n];
+        }
+        assert(total == inputs[i].size());
+        assert(store.getFileContents(0) == inputs[i]);
+        if (inputs[i].size() <= ChunkStore::MIN_CHUNK) {
+            assert(lengths.size() == (inputs[i].empty() ? 0 : 1));
+        }
+    }
+    ChunkStore zeros;
+    zeros.addFile("f", inputs.back());
+    assert(chunk_lengths(zeros, 0).size() == 6);
+    assert(zeros.numChunks() == 2); //five full chunks are one chunk
+}
+
+/*
+ * FastCDC cuts: an insertion near the start only changes the chunks
+ * around it, so the rest of the file is deduplicated
+ */
+void chunk_shift() {
+    string data = random_bytes(2000000, 8);
+    ChunkStore store;
+    store.addFile("old", data);
+    size_t unique = store.numChunks();
+    store.addFile("new", data.substr(0, 5000) + "inserted" +
+                         data.substr(5000));
+    assert(store.numChunks() <= unique + 2);
+    assert(store.getFileContents(1).size() == data.size() + 8);
+}
+
+/*
+ * Truncated input: a cut off chunk store is refused
+ */
+void truncated_inputs() {
+    ChunkStore store;
+    store.addFile("a", random_bytes(30000, 9));
+    expect_prefixes_refused(store.serialize(), [](const string &prefix) {
+        ChunkStore copy;
+        copy.deserialize(prefix);
+    });
+}
+
+/*
+ * ZAPDLT1: a delta rebuilds the target from its reference, alone and
+ * after being zapped, and refuses a different reference
+ */
+void delta_round_trip() {
+    DeltaCoder delta;
+    string reference = sample_prose(200000);
+    string target = reference;
+    target.insert(1000, "an insertion near the start");
+    target.erase(50000, 700);
+    target += random_bytes(3000, 4);
+    string ops = delta.diff(reference, target);
+    assert(ops.compare(0, 7, "ZAPDLT1") == 0);
+    assert(ops.size() < target.size() / 10);
+    assert(delta.apply(reference, ops) == target);
+    assert(delta.apply(reference, delta.diff(reference, "")) == "");
+    assert(delta.apply("", delta.diff("", target)) == target);
+
+    HuffmanCoder coder;
+    assert(delta.apply(reference, coder.decompress(coder.compress(ops,
+                                                   false))) == target);
+    bool refused = false;
+    try {
+        delta.apply(reference + "x", ops);
+    } catch (const runtime_error &e) {
+        refused = true;
+    }
+    assert(refused);
+}
+
+/*
+ * Truncated input: a cut off delta is refused
+ */
+void truncated_delta() {
+    DeltaCoder delta;
+    string reference = sample_prose(20000);
+    string ops = delta.diff(reference, "new " + reference.substr(100));
+    expect_prefixes_refused(ops, [&](const string &prefix) {
+        delta.apply(reference, prefix);
+    });
+}
+
+/*
+ * ZAPWRD1: a word model rebuilt from its header decodes what the model
+ * coded, tokens seen once included, and zapped word files round trip
+ */
+void word_round_trip() {
+    vector<string> inputs = {"hello", sample_prose(300000),
+                             sample_prose(300000) + random_bytes(5000, 3)};
+    for (const string &input : inputs) {
+        WordCoder model;
+        string header = model.buildModel(input);
+        assert(WordCoder::isWordHeader(header));
+        BitWriter out;
+        model.encodeBlock(input, 0, input.size(), out);
+        out.finish();
+        WordCoder loaded;
+        loaded.loadModel(header);
+        string decoded;
+        loaded.decodeBlock(out.bytes().data(), out.bitCount(), input.size(),
+                           decoded);
+        assert(decoded == input);
+
+        HuffmanCoder coder;
+        assert(coder.decompress(coder.compress(input, true)) == input);
+    }
+}
+
+/*
+ * Damaged input: every prefix of a word model header is refused with an
+ * exception, never read past its end, and so are code lengths that over-fill
+ * the code space (all 257 byte codes one bit long)
+ */
+void truncated_word_model() {
+    WordCoder model;
+    string header = model.buildModel(sample_prose(3000));
+    expect_prefixes_refused(header, [](const string &prefix) {
+        WordCoder copy;
+        copy.loadModel(prefix);
+    });
+
+    string damaged = header;
+    damaged.replace(damaged.size() - 257, 257, 257, '\1');
+    expect_refused([&]() {
+        WordCoder copy;
+        copy.loadModel(damaged);
+    });
+}
+
+/*
+ * CRC-32C: "123456789" must give the Castagnoli check value whether the
+ * crc32 instruction or the tables compute it
+ */
+void crc32c_known_answer() {
+    assert(crc32c("123456789", 9) == 0xE3069283);
+    assert(crc32cPortable("123456789", 9) == 0xE3069283);
+    assert(crc32c("", 0) == 0);
+    assert(crc32cPortable("", 0) == 0);
+}
+
+/*
+ * CRC-32C: both versions agree at every alignment and on every length
+ * around their eight byte steps
+ */
+void crc32c_paths_agree() {
+    string data = random_bytes(300, 1);
+    for (size_t start = 0; start < 8; start++) {
+        for (size_t len = 0; len + start <= data.size(); len++) {
+            assert(crc32c(data.data() + start, len) ==
+                   crc32cPortable(data.data() + start, len));
+        }
+    }
+}
+
+/*
+ * ZAPBLK1: byte Huffman blocks round trip, including a one symbol input
+ * (its one code is a single bit), every byte value, and an input long
+ * enough to be cut into several blocks
+ */
+void block_round_trip() {
+    HuffmanCoder coder;
+    string all_bytes;
+    for (int i = 0; i < 256; i++) {
+        all_bytes += (char)i;
+    }
+    vector<string> inputs = {"a", string(5000, 'z'), all_bytes,
+                             random_bytes(100000, 2),
+                             sample_prose(2500000)};
+    for (const string &input : inputs) {
+        string zapped = coder.compress(input, false);
+        assert(zapped.compare(0, 8, "ZAPBLK1\n") == 0);
+        assert(coder.decompress(zapped) == input);
+    }
+}
+
+/*
+ * ZAPWRD1 blocks: a token longer than MAX_BLOCK_LENGTH is cut across
+ * blocks, and its pieces decode even when the whole token is a dictionary
+ * word and nothing else in the text uses its bytes
+ */
+void word_long_token_blocks() {
+    string run(5000000, 'a');
+    string input = run + " " + run + " x";
+    HuffmanCoder coder;
+    string zapped = coder.compress(input, true);
+    string header;
+    vector<ZapBlock> blocks;
+    unpackBlocks(zapped, header, blocks);
+    assert(WordCoder::isWordHeader(header));
+    assert(blocks.size() > 2);
+    assert(coder.decompress(zapped) == input);
+}
+
+/*
+ * Truncated input: every prefix of a zap block file, byte or word coded,
+ * is refused with an exception, never read past its end
+ */
+void truncated_blocks() {
+    HuffmanCoder coder;
+    vector<string> zapped = {coder.compress(sample_prose(3000), false),
+                             coder.compress(sample_prose(3000), true)};
+    for (const string &data : zapped) {
+        expect_prefixes_refused(data, [&](const string &prefix) {
+            coder.decompress(prefix);
+        });
+    }
+}
+
+/*
+ * Truncated input: --test reports a cut off file as damaged, and a block
+ * claiming more than MAX_BLOCK_LENGTH bytes is refused before decoding
+ */
+void truncated_file_test() {
+    HuffmanCoder coder;
+    string zapped = coder.compress(sample_prose(50000), false);
+    string name = (filesystem::temp_directory_path() /
+                   "zap_unit_truncated.zap").string();
+    write_file(name, zapped);
+    assert(coder.tester(name));
+    write_file(name, zapped.substr(0, zapped.size() - 10));
+    assert(not coder.tester(name));
+    filesystem::remove(name);
+
+    ZapBlock block;
+    block.rawLength = MAX_BLOCK_LENGTH + 1;
+    block.bitLength = 8;
+    block.crc = 0;
+    block.bits = "x";
+    string header;
+    vector<ZapBlock> blocks;
+    expect_refused([&]() {
+        unpackBlocks(packBlocks("header", {block}), header, blocks);
+    });
+}
+
+/*
+ * Damaged input: a tree header nested far deeper than any byte tree is
+ * reported as damaged by --test, not followed until the stack runs out
+ */
+void deep_tree_test() {
+    HuffmanCoder coder;
+    ZapBlock block;
+    block.rawLength = 1;
+    block.bitLength = 1;
+    block.crc = 0;
+    block.bits = "x";
+    string name = (filesystem::temp_directory_path() /
+                   "zap_unit_deep.zap").string();
+    write_file(name, packBlocks(string(2000000, 'I'), {block}));
+    assert(not coder.tester(name));
+    filesystem::remove(name);
+}
@@ -0,0 +1,344 @@
+/*
+ *  zap_bench.cpp
+ *  Harrison Tun
+ *
+ *  COMP 15 Proj Zap
+ *
+ *  Purpose: Benchmark driver for zap. Encodes and decodes a built in
+ *           synthetic corpus (text, skewed, random, single symbol and large)
+ *           and any files named on the command line, in both byte and word
+ *           mode, and prints one CSV row (or JSON object) per phase:
+ *
+ *               input,mode,phase,input_bytes,output_bytes,seconds,mb_per_s,
+ *               ratio,peak_rss_kb
+ *
+ *           seconds is the best of --repeat runs, mb_per_s is measured on
+ *           the uncompressed size, ratio is uncompressed / compressed bytes
+ *           and peak_rss_kb is the high water mark of resident memory during
+ *           the phase (the whole run on kernels that can't reset it).
+ *
+ *           With --baseline FILE the results are compared against an
+ *           earlier CSV run; a phase that got slower by more than
+ *           --tolerance (default 0.10) or a ratio that got worse makes the
+ *           program exit with failure, so it can gate upgrades.
+ *
+ *           Build it with optimization, e.g. make clean && make zap_bench.
+ *
+ */
+
+#include "HuffmanCoder.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <sstream>
+#include <sys/resource.h>
+using namespace std;
+
+struct BenchInput {
+    string name;
+    string data;
+};
+
+struct BenchResult {
+    string input;
+    string mode;
+    string phase;
+    size_t inputBytes;
+    size_t outputBytes;
+    double seconds;
+    double mbPerSec;
+    double ratio;
+    long peakRssKb;
+};
+
+static string makeText(size_t bytes, uint64_t seed);
+static string makeSkewed(size_t bytes, uint64_t seed);
+static string makeRandom(size_t bytes, uint64_t seed);
+static void resetPeakRss();
+static long peakRssKb();
+static void printResult(const BenchResult &r, bool json);
+static bool checkBaseline(const string &baselineFile,
+                          const vector<BenchResult> &results,
+                          double tolerance);
+
+int main(int argc, char *argv[]) {
+    int repeat = 3;
+    size_t scale = 4 << 20;
+    bool json = false;
+    double tolerance = 0.10;
+    string baselineFile;
+    vector<string> files;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--repeat" and i + 1 < argc) {
+            repeat = max(1, atoi(argv[++i]));
+        } else if (arg == "--scale" and i + 1 < argc) {
+            scale = max(1, atoi(argv[++i])) * (size_t)(1 << 20);
+        } else if (arg == "--json") {
+            json = true;
+        } else if (arg == "--baseline" and i + 1 < argc) {
+            baselineFile = argv[++i];
+        } else if (arg == "--tolerance" and i + 1 < argc) {
+            tolerance = atof(argv[++i]);
+        } else if (arg.compare(0, 2, "--") == 0) {
+            cerr << "Usage: ./zap_bench [--repeat N] [--scale MB] [--json] "
+                 << "[--baseline FILE] [--tolerance F] [file...]" << endl;
+            return EXIT_FAILURE;
+        } else {
+            files.push_back(arg);
+        }
+    }
+
+    vector<BenchInput> inputs = {
+        {"text", makeText(scale, 1)},
+        {"skewed", makeSkewed(scale, 2)},
+        {"random", makeRandom(scale, 3)},
+        {"single", string(scale, 'a')},
+        {"large", makeText(16 * scale, 4)},
+    };
+    for (string &file : files) {
+        ifstream input(file, ios::binary);
+        if (not input) {
+            cerr << "Unable to open file " << file << endl;
+            return EXIT_FAILURE;
+        }
+        inputs.push_back({file, string { istreambuf_iterator<char>(input),
+                                         istreambuf_iterator<char>() }});
+    }
+
+    if (not json) {
+        cout << "input,mode,phase,input_bytes,output_bytes,seconds,mb_per_s,"
+             << "ratio,peak_rss_kb" << endl;
+    }
+    HuffmanCoder coder;
+    vector<BenchResult> results;
+    for (BenchInput &in : inputs) {
+        for (bool words : {false, true}) {
+            string mode = words ? "words" : "bytes";
+            string zapped, unzapped;
+            double best[2] = {1e300, 1e300};
+            long rss[2] = {0, 0};
+            for (int phase = 0; phase < 2; phase++) {
+                resetPeakRss();
+                for (int run = 0; run < repeat; run++) {
+                    auto start = chrono::steady_clock::now();
+                    if (phase == 0) {
+                        zapped = coder.compress(in.data, words);
+                    } else {
+                        unzapped = coder.decompress(zapped);
+                    }
+                    chrono::duration<double> took =
+                        chrono::steady_clock::now() - start;
+                    best[phase] = min(best[phase], took.count());
+                }
+                rss[phase] = peakRssKb();
+            }
+            if (unzapped != in.data) {
+                cerr << in.name << " (" << mode << ") did not round trip"
+                     << endl;
+                return EXIT_FAILURE;
+            }
+            double mb = in.data.size() / (1024.0 * 1024.0);
+            double ratio = zapped.empty() ? 0 :
+                           (double)in.data.size() / zapped.size();
+            results.push_back({in.name, mode, "encode", in.data.size(),
+                               zapped.size(), best[0], mb / best[0], ratio,
+                               rss[0]});
+            results.push_back({in.name, mode, "decode", zapped.size(),
+                               in.data.size(), best[1], mb / best[1], ratio,
+                               rss[1]});
+            printResult(results[results.size() - 2], json);
+            printResult(results.back(), json);
+        }
+    }
+    if (not baselineFile.empty() and
+        not checkBaseline(baselineFile, results, tolerance)) {
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
+
+/*
+ * name:      makeText( )
+ * purpose:   English-like text: words drawn from a fixed vocabulary with a
+ *            Zipf distribution, with punctuation and line breaks
+ * arguments: number of bytes to make and the random seed
+ * returns:   the text
+ * effects:   NADA
+ */
+static string makeText(size_t bytes, uint64_t seed) {
+    mt19937_64 rng(seed);
+    vector<string> vocabulary;
+    vector<double> weights;
+    uniform_int_distribution<int> length(1, 10), letter('a', 'z');
+    for (int i = 0; i < 20000; i++) {
+        string word;
+        for (int k = length(rng); k > 0; k--) {
+            word += (char)letter(rng);
+        }
+        vocabulary.push_back(word);
+        weights.push_back(1.0 / (i + 1));
+    }
+    discrete_distribution<int> pick(weights.begin(), weights.end());
+    uniform_int_distribution<int> punctuation(0, 15);
+    string text;
+    text.reserve(bytes + 16);
+    while (text.size() < bytes) {
+        text += vocabulary[pick(rng)];
+        int p = punctuation(rng);
+        text += p == 0 ? ".\n" : p == 1 ? ", " : " ";
+    }
+    text.resize(bytes);
+    return text;
+}
+
+/*
+ * name:      makeSkewed( )
+ * purpose:   bytes with a geometric distribution, so a few symbols are very
+ *            common and the rest are rare
+ * arguments: number of bytes to make and the random seed
+ * returns:   the data
+ * effects:   NADA
+ */
+static string makeSkewed(size_t bytes, uint64_t seed) {
+    mt19937_64 rng(seed);
+    geometric_distribution<int> symbol(0.3);
+    string data(bytes, '\0');
+    for (char &c : data) {
+        c = (char)min(255, symbol(rng));
+    }
+    return data;
+}
+
+/*
+ * name:      makeRandom( )
+ * purpose:   uniformly random bytes, which Huffman coding can't shrink
+ * arguments: number of bytes to make and the random seed
+ * returns:   the data
+ * effects:   NADA
+ */
+static string makeRandom(size_t bytes, uint64_t seed) {
+    mt19937_64 rng(seed);
+    string data(bytes, '\0');
+    for (char &c : data) {
+        c = (char)(rng() & 0xff);
+    }
+    return data;
+}
+
+/*
+ * name:      resetPeakRss( )
+ * purpose:   starts a new resident memory high water mark (Linux 4.0+), so
+ *            peakRssKb( ) reports the peak of the phase that follows
+ * arguments: NADA
+ * returns:   NADA
+ * effects:   writes to /proc/self/clear_refs, does nothing elsewhere
+ */
+static void resetPeakRss() {
+    ofstream clear("/proc/self/clear_refs");
+    if (clear) {
+        clear << "5" << endl;
+    }
+}
+
+/*
+ * name:      peakRssKb( )
+ * purpose:   resident memory high water mark in kilobytes, from VmHWM when
+ *            /proc is available and getrusage otherwise
+ * arguments: NADA
+ * returns:   the peak in kilobytes
+ * effects:   NADA
+ */
+static long peakRssKb() {
+    ifstream status("/proc/self/status");
+    string line;
+    while (getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return atol(line.c_str() + 6);
+        }
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/*
+ * name:      printResult( )
+ * purpose:   prints one result as a CSV row or a JSON object on one line
+ * arguments: the result and which format to use
+ * returns:   NADA
+ * effects:   writes to stdout
+ */
+static void printResult(const BenchResult &r, bool json) {
+    if (json) {
+        cout << "{\"input\":\"" << r.input << "\",\"mode\":\"" << r.mode
+             << "\",\"phase\":\"" << r.phase << "\",\"input_bytes\":"
+             << r.inputBytes << ",\"output_bytes\":" << r.outputBytes
+             << ",\"seconds\":" << r.seconds << ",\"mb_per_s\":"
+             << r.mbPerSec << ",\"ratio\":" << r.ratio
+             << ",\"peak_rss_kb\":" << r.peakRssKb << "}" << endl;
+        return;
+    }
+    cout << r.input << "," << r.mode << "," << r.phase << ","
+         << r.inputBytes << "," << r.outputBytes << "," << r.seconds << ","
+         << r.mbPerSec << "," << r.ratio << "," << r.peakRssKb << endl;
+}
+
+/*
+ * name:      checkBaseline( )
+ * purpose:   compares results against a CSV written by an earlier run and
+ *            reports every phase that regressed
+ * arguments: the baseline CSV, this run's results, and the fraction of
+ *            throughput a phase may lose before it counts as a regression
+ * returns:   true if nothing regressed
+ * effects:   prints regressions to stderr
+ */
+static bool checkBaseline(const string &baselineFile,
+                          const vector<BenchResult> &results,
+                          double tolerance) {
+    ifstream baseline(baselineFile);
+    if (not baseline) {
+        cerr << "Unable to open file " << baselineFile << endl;
+        return false;
+    }
+    //input,mode,phase -> (mb_per_s, ratio)
+    map<string, pair<double, double>> previous;
+    string line;
+    getline(baseline, line); //column names
+    while (getline(baseline, line)) {
+        stringstream row(line);
+        vector<string> cells;
+        string cell;
+        while (getline(row, cell, ',')) {
+            cells.push_back(cell);
+        }
+        if (cells.size() == 9) {
+            previous[cells[0] + "," + cells[1] + "," + cells[2]] =
+                {atof(cells[6].c_str()), atof(cells[7].c_str())};
+        }
+    }
+    bool ok = true;
+    for (const BenchResult &r : results) {
+        auto found = previous.find(r.input + "," + r.mode + "," + r.phase);
+        if (found == previous.end()) {
+            continue;
+        }
+        if (r.mbPerSec < found->second.first * (1 - tolerance)) {
+            cerr << "REGRESSION " << r.input << " " << r.mode << " "
+                 << r.phase << ": " << r.mbPerSec << " MB/s, was "
+                 << found->second.first << endl;
+            ok = false;
+        }
+        //ratios are deterministic, allow only rounding in the CSV
+        if (r.ratio < found->second.second * 0.999) {
+            cerr << "REGRESSION " << r.input << " " << r.mode << " "
+                 << r.phase << ": ratio " << r.ratio << ", was "
+                 << found->second.second << endl;
+            ok = false;
+        }
+    }
+    return ok;
+}